@@ -0,0 +1,130 @@
+#include <cstdlib>
+#include <new>
+#include <iostream>
+#include "AllocationTracker.h"
+
+using namespace std;
+
+#define ALLOCATION_HEADER 16 // Bytes in front of each block, holding its size and whether it was counted;
+                             // as many as malloc aligns to, so the block is aligned as malloc's are.
+
+const char *allocationPhaseNames[NUM_ALLOCATION_PHASES] = { "setup", "build", "frames" };
+
+atomic<int> isAllocationTrackingOn(0);
+static atomic<int> currentPhase(ALLOCATION_SETUP);
+static atomic<long long> liveBytes(0); // Bytes allocated while tracking and not yet freed.
+
+// Counts of a phase; they are of static storage, so zero before anything can allocate.
+struct PhaseCounters
+{
+   atomic<long long> allocations, frees, bytes, peakBytes;
+};
+
+static PhaseCounters phases[NUM_ALLOCATION_PHASES];
+
+// Raise the peak of the phase to the bytes live, if they are more.
+static void raisePeak(PhaseCounters &counters, long long live)
+{
+   long long peak = counters.peakBytes.load(memory_order_relaxed);
+   while (live > peak && !counters.peakBytes.compare_exchange_weak(peak, live, memory_order_relaxed));
+}
+
+// Return a block of the size, with its header filled in, or NULL if there is no memory.
+static void *allocate(size_t size)
+{
+   size_t *header = (size_t *)malloc(size + ALLOCATION_HEADER);
+   if (header == NULL) return NULL;
+   header[0] = size;
+   header[1] = isAllocationTrackingOn.load(memory_order_relaxed);
+   if (header[1])
+   {
+      PhaseCounters &counters = phases[currentPhase.load(memory_order_relaxed)];
+	  counters.allocations.fetch_add(1, memory_order_relaxed);
+	  counters.bytes.fetch_add(size, memory_order_relaxed);
+	  raisePeak(counters, liveBytes.fetch_add(size, memory_order_relaxed) + size);
+   }
+   return (char *)header + ALLOCATION_HEADER;
+}
+
+static void release(void *block)
+{
+   if (block == NULL) return;
+   size_t *header = (size_t *)((char *)block - ALLOCATION_HEADER);
+   if (header[1])
+   {
+      phases[currentPhase.load(memory_order_relaxed)].frees.fetch_add(1, memory_order_relaxed);
+	  liveBytes.fetch_sub(header[0], memory_order_relaxed);
+   }
+   free(header);
+}
+
+void *operator new(size_t size)
+{
+   void *block = allocate(size);
+   if (block == NULL) throw bad_alloc();
+   return block;
+}
+
+void *operator new[](size_t size)
+{
+   void *block = allocate(size);
+   if (block == NULL) throw bad_alloc();
+   return block;
+}
+
+void *operator new(size_t size, const nothrow_t &) noexcept { return allocate(size); }
+void *operator new[](size_t size, const nothrow_t &) noexcept { return allocate(size); }
+void operator delete(void *block) noexcept { release(block); }
+void operator delete[](void *block) noexcept { release(block); }
+void operator delete(void *block, size_t) noexcept { release(block); }
+void operator delete[](void *block, size_t) noexcept { release(block); }
+void operator delete(void *block, const nothrow_t &) noexcept { release(block); }
+void operator delete[](void *block, const nothrow_t &) noexcept { release(block); }
+
+void startAllocationTracking()
+{
+   beginAllocationPhase(ALLOCATION_SETUP);
+   isAllocationTrackingOn.store(1);
+}
+
+int beginAllocationPhase(AllocationPhase phase)
+{
+   PhaseCounters &counters = phases[phase];
+   counters.allocations.store(0);
+   counters.frees.store(0);
+   counters.bytes.store(0);
+   counters.peakBytes.store(liveBytes.load());
+   return currentPhase.exchange(phase);
+}
+
+void setAllocationPhase(int phase)
+{
+   currentPhase.store(phase);
+   raisePeak(phases[phase], liveBytes.load());
+}
+
+AllocationCounts allocationCounts(AllocationPhase phase)
+{
+   AllocationCounts counts;
+   counts.allocations = phases[phase].allocations.load();
+   counts.frees = phases[phase].frees.load();
+   counts.bytes = phases[phase].bytes.load();
+   counts.peakBytes = phases[phase].peakBytes.load();
+   return counts;
+}
+
+void printAllocations(int numFrames)
+{
+   int i;
+   cout << "Allocations:" << endl;
+   for (i = 0; i < NUM_ALLOCATION_PHASES; i++)
+   {
+      AllocationCounts counts = allocationCounts((AllocationPhase)i);
+	  cout << "   " << allocationPhaseNames[i] << ": " << counts.allocations << " blocks, " << counts.bytes / 1024.0
+		   << " KB, " << counts.frees << " freed, peak " << counts.peakBytes / 1024.0 << " KB live";
+	  if (i == ALLOCATION_FRAMES && numFrames > 0)
+	     cout << "; " << (double)counts.allocations / numFrames << " blocks, " << counts.bytes / 1024.0 / numFrames
+			  << " KB a frame over " << numFrames << " frames";
+	  cout << endl;
+   }
+}
@@ -0,0 +1,45 @@
+#ifndef AllocationTracker_52904
+#define AllocationTracker_52904
+
+#include <atomic>
+
+using namespace std;
+
+// Allocation tracking. The program's global operator new and delete are replaced by ones that keep
+// the size of each block in a header in front of it, so that when tracking is on, the blocks and
+// bytes allocated and freed, and the most bytes live at once, are counted for the phase of the run
+// under way, whichever thread allocates. Blocks allocated before tracking started are not counted
+// when freed. When tracking is off a new or delete costs a relaxed atomic load and a branch beyond
+// malloc or free.
+
+// Phases of a run that allocations are counted for.
+enum AllocationPhase
+{
+   ALLOCATION_SETUP,  // Generating or loading the field, and setting up everything else.
+   ALLOCATION_BUILD,  // Building the quadtree.
+   ALLOCATION_FRAMES, // The frames, or the ticks of a run without a window.
+   NUM_ALLOCATION_PHASES
+};
+
+extern const char *allocationPhaseNames[NUM_ALLOCATION_PHASES];
+extern atomic<int> isAllocationTrackingOn; // Set while tracking.
+
+// Allocations counted for a phase.
+struct AllocationCounts
+{
+   long long allocations; // Blocks allocated.
+   long long frees;       // Blocks freed during the phase, of those allocated while tracking.
+   long long bytes;       // Bytes allocated.
+   long long peakBytes;   // Most bytes live at once during the phase, of those allocated while tracking.
+};
+
+void startAllocationTracking(); // Start counting allocations, for the setup phase.
+int beginAllocationPhase(AllocationPhase phase); // Count allocations for the phase from now, afresh;
+                                                 // return the phase they were counted for before.
+void setAllocationPhase(int phase); // Count allocations for the phase from now, added to what it has.
+AllocationCounts allocationCounts(AllocationPhase phase); // Counts of the phase so far.
+
+// Print the counts of each phase; the frames phase is also given per frame over numFrames frames.
+void printAllocations(int numFrames);
+
+#endif
@@ -0,0 +1,136 @@
+#include <cstdlib>
+#include <algorithm>
+#include <climits>
+#include <GL/glew.h>
+#include <GL/glfw3.h>
+#include "AsteroidStore.h"
+
+using namespace std;
+
+void AsteroidStore::reset(int columns)
+{
+   this->columns = columns;
+   ownX.clear(); ownY.clear(); ownZ.clear(); ownR.clear();
+   ownRGB.clear();
+   ownSlot.clear();
+   cx = cy = cz = r = NULL; rgb = NULL; slot = NULL;
+   numAsteroids = 0;
+}
+
+void AsteroidStore::attach(int n, int columns, float *cx, float *cy, float *cz, float *r, unsigned char *rgb, int *slot)
+{
+   reset(columns);
+   numAsteroids = n;
+   this->cx = cx; this->cy = cy; this->cz = cz; this->r = r;
+   this->rgb = rgb;
+   this->slot = slot;
+}
+
+int AsteroidStore::add(int row, int column, float x, float y, float z, float radius,
+					   unsigned char valueR, unsigned char valueG, unsigned char valueB)
+{
+   ownX.push_back(x); ownY.push_back(y); ownZ.push_back(z); ownR.push_back(radius);
+   ownRGB.push_back(valueR); ownRGB.push_back(valueG); ownRGB.push_back(valueB);
+   ownSlot.push_back(row * columns + column);
+
+   // The arrays may have moved as they grew.
+   cx = ownX.data(); cy = ownY.data(); cz = ownZ.data(); r = ownR.data();
+   rgb = ownRGB.data();
+   slot = ownSlot.data();
+   return numAsteroids++;
+}
+
+void AsteroidStore::allocate(int n)
+{
+   reset(columns);
+   ownX.resize(n); ownY.resize(n); ownZ.resize(n); ownR.resize(n);
+   ownRGB.resize(3 * n);
+   ownSlot.resize(n);
+   cx = ownX.data(); cy = ownY.data(); cz = ownZ.data(); r = ownR.data();
+   rgb = ownRGB.data();
+   slot = ownSlot.data();
+   numAsteroids = n;
+}
+
+void AsteroidStore::set(int id, int row, int column, float x, float y, float z, float radius,
+					   unsigned char valueR, unsigned char valueG, unsigned char valueB)
+{
+   cx[id] = x; cy[id] = y; cz[id] = z; r[id] = radius;
+   rgb[3 * id] = valueR; rgb[3 * id + 1] = valueG; rgb[3 * id + 2] = valueB;
+   slot[id] = row * columns + column;
+}
+
+int AsteroidStore::idAt(int row, int column)
+{
+   int *found = lower_bound(slot, slot + numAsteroids, row * columns + column);
+   if (found == slot + numAsteroids || *found != row * columns + column) return -1;
+   return found - slot;
+}
+
+size_t AsteroidStore::memoryUsed()
+{
+   return (ownX.capacity() + ownY.capacity() + ownZ.capacity() + ownR.capacity()) * sizeof(float) + 
+          ownRGB.capacity() + ownSlot.capacity() * sizeof(int);
+}
+
+// Append a command for each of the asteroids, taking its center and color. An asteroid straddling
+// squares is listed by culling once for each, so each call takes a new mark and stamps the ids it
+// draws with it, skipping those stamped already; the marks are cleared only when the mark runs out.
+void AsteroidStore::appendDrawCommands(const int *ids, int n, vector<int> &marks, int &mark,
+									   vector<AsteroidDrawCommand> &commands)
+{
+   int i;
+   AsteroidDrawCommand command;
+   if ((int)marks.size() < numAsteroids) marks.resize(numAsteroids, 0);
+   if (mark == INT_MAX)
+   {
+      fill(marks.begin(), marks.end(), 0);
+	  mark = 0;
+   }
+   mark++;
+   for (i = 0; i < n; i++)
+   {
+      int id = ids[i];
+	  if (marks[id] == mark) continue;
+	  marks[id] = mark;
+	  command.x = cx[id]; command.y = cy[id]; command.z = cz[id];
+	  command.rgb[0] = rgb[3 * id]; command.rgb[1] = rgb[3 * id + 1]; command.rgb[2] = rgb[3 * id + 2];
+	  commands.push_back(command);
+   }
+}
+
+void AsteroidStore::appendAllDrawCommands(vector<AsteroidDrawCommand> &commands)
+{
+   int id, first = commands.size();
+   commands.resize(first + numAsteroids);
+   for (id = 0; id < numAsteroids; id++)
+   {
+      AsteroidDrawCommand &command = commands[first + id];
+	  command.x = cx[id]; command.y = cy[id]; command.z = cz[id];
+	  command.rgb[0] = rgb[3 * id]; command.rgb[1] = rgb[3 * id + 1]; command.rgb[2] = rgb[3 * id + 2];
+   }
+}
+
+// Function to draw asteroids: the sphere translated to the center of each, in its color. The
+// wireframe mode is set once for all of them.
+void AsteroidStore::draw(RenderBackend &backend, const vector<AsteroidDrawCommand> &commands, int vertexIndex)
+{
+   int i, n = commands.size();
+
+   // Turn on wireframe mode
+   backend.polygonMode(GL_FRONT, GL_LINE);
+   backend.polygonMode(GL_BACK, GL_LINE);
+
+   for (i = 0; i < n; i++)
+   {
+      backend.pushMatrix();
+	  backend.translate(commands[i].x, commands[i].y, commands[i].z);
+	  backend.color3ubv(commands[i].rgb);
+	  backend.drawArrays(GL_TRIANGLE_FAN, vertexIndex, SPHERE_VERTEX_COUNT);
+	  backend.popMatrix();
+   }
+
+   // Turn off wireframe mode
+   backend.polygonMode(GL_FRONT, GL_FILL);
+   backend.polygonMode(GL_BACK, GL_FILL);
+}
@@ -0,0 +1,73 @@
+#ifndef AsteroidStore_51872
+#define AsteroidStore_51872
+#define PI 3.14159265
+#include <vector>
+#include <glm/glm.hpp>
+#include "Meshes.h"
+#include "RenderBackend.h"
+
+using namespace std;
+
+#define SPHERE_VERTEX_COUNT (SphereLod<0>::Mesh::VERTEX_COUNT)
+#define SPHERE_SIZE 5.0f
+#define ASTEROID_RADIUS 3.0 // Radius of an asteroid for collisions and culling.
+
+// Everything needed to draw an asteroid, copied out of a store, so that it can be drawn on one
+// thread while the store is read or changed on another.
+struct AsteroidDrawCommand
+{
+   float x, y, z;
+   unsigned char rgb[3];
+};
+
+// Store of the asteroids of the field as a structure of arrays: the asteroid with id i is centered
+// at (cx[i], cy[i], cz[i]) with radius r[i] and color rgb[3*i], rgb[3*i+1], rgb[3*i+2]. Only the 
+// slots of the field that hold an asteroid are given an id, so loops over the asteroids run over
+// contiguous arrays without touching or testing empty slots, and a sparse field costs in proportion
+// to the asteroids in it. Ids are given in row-major order of the slots, so the slots of the ids 
+// are in ascending order and the id of a slot is found by binary search. The arrays are those of
+// the store itself, or those of a store held elsewhere, e.g. in a mapped file, and attached.
+class AsteroidStore
+{
+public:
+   AsteroidStore() { cx = cy = cz = r = NULL; rgb = NULL; slot = NULL; numAsteroids = columns = 0; }
+   void reset(int columns); // Empty the store for a field of rows of columns slots.
+   void attach(int n, int columns, float *cx, float *cy, float *cz, // Use the arrays of a store of n
+               float *r, unsigned char *rgb, int *slot);            // asteroids held elsewhere in place;
+                                                                    // they must stay there while in use.
+   int add(int row, int column, float x, float y, float z, float radius,  // Add the asteroid in the slot,
+           unsigned char valueR, unsigned char valueG, unsigned char valueB); // which must come after the slot
+                                                                            // of every asteroid added so far
+                                                                            // in row-major order; return its id.
+   void allocate(int n); // Make room for n asteroids, emptying the store, to be given by set.
+   void set(int id, int row, int column, float x, float y, float z, float radius, // Set asteroid id of an
+            unsigned char valueR, unsigned char valueG, unsigned char valueB);  // allocated store, keeping
+                                                                              // ids in row-major order of the slots.
+   int size() { return numAsteroids; } // Number of asteroids.
+   int getColumns() { return columns; }
+   const int *getSlots() { return slot; } // Slot (row * columns + column) of each asteroid.
+   int idAt(int row, int column); // Return the id of the asteroid in the slot, -1 if the slot is empty.
+   float getMass(int id) { return r[id] * r[id] * r[id]; } // Mass taken as proportional to volume.
+   void appendDrawCommands(const int *ids, int n,                  // Append the commands to draw the n asteroids
+                           vector<int> &marks, int &mark,          // with the given ids, each once however often
+                           vector<AsteroidDrawCommand> &commands); // it is listed; marks and mark, kept by the
+                                                                   // caller from call to call, stamp the ids drawn.
+   void appendAllDrawCommands(vector<AsteroidDrawCommand> &commands); // Append the commands to draw every asteroid.
+   static void draw(RenderBackend &backend,                      // Draw the asteroids of the commands with the
+                    const vector<AsteroidDrawCommand> &commands, // sphere at vertexIndex, through the backend.
+                    int vertexIndex);
+   size_t memoryUsed(); // Return the bytes held by the store's own arrays.
+
+   float *cx, *cy, *cz, *r; // The arrays in use.
+   unsigned char *rgb;
+
+private:
+   vector<float> ownX, ownY, ownZ, ownR; // The store's own arrays.
+   vector<unsigned char> ownRGB;
+   vector<int> ownSlot;
+   int *slot; // Slot of each asteroid, in ascending order.
+   int numAsteroids;
+   int columns;
+};
+
+#endif
@@ -0,0 +1,344 @@
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include "Benchmark.h"
+#include "AsteroidStore.h"
+#include "FieldGenerator.h"
+#include "QuadTree.h"
+
+using namespace std;
+
+void scriptedFlight(int numFrames, vector<ViewState> &views)
+{
+   int i;
+   ViewState view = { 0.0, 0.0, 0.0, 1, 0 };
+   views.clear();
+   for (i = 0; i < numFrames; i++)
+   {
+      view.angle = BENCHMARK_WEAVE_ANGLE * sin(2.0 * PI * i / BENCHMARK_WEAVE_FRAMES);
+	  view.x -= BENCHMARK_STEP * sin(view.angle * PI / 180.0);
+	  view.z -= BENCHMARK_STEP * cos(view.angle * PI / 180.0);
+	  views.push_back(view);
+   }
+}
+
+// Return the milliseconds since start.
+static double millisecondsSince(chrono::steady_clock::time_point start)
+{
+   return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int numberUnique(const vector<int> &ids, vector<int> &marks, int mark)
+{
+   int i, n = 0;
+   for (i = 0; i < (int)ids.size(); i++)
+      if (marks[ids[i]] != mark)
+	  {
+	     marks[ids[i]] = mark;
+		 n++;
+	  }
+   return n;
+}
+
+// Each mode culls into the same lists, kept from frame to frame and made room in at the start for
+// every asteroid, so that the time measured is that of culling and not of allocating, and a frame
+// after the warm-up allocates nothing at all; the quadtree's parallel traversal runs on threads it
+// keeps, so there is no exception for it. The quadtree's check of a brute-force frame is on the
+// calling thread, which allocates nothing.
+void runBenchmark(const Config &config, int numThreads, BenchmarkReport &report)
+{
+   AsteroidStore asteroids;
+   Quadtree quadtree;
+   vector<ViewState> views;
+   Frustum frusta[FRAME_VIEWPORTS];
+   vector<int> visible[FRAME_VIEWPORTS];
+   vector<int> listedByQuadtree[FRAME_VIEWPORTS];
+   vector<AsteroidDrawCommand> commands[FRAME_VIEWPORTS];
+   vector<int> marks, drawnMarks;
+   float firstX, firstZ, squareX, squareZ, squareSize;
+   int mode, i, j, k, mark = 0, drawnMark = 0;
+
+   report.rows = config.rows; report.columns = config.columns; report.fillProbability = config.fillProbability;
+   report.spacing = config.spacing; report.seed = config.seed;
+   report.numThreads = numThreads;
+   report.modes.clear();
+
+   startAllocationTracking();
+   chrono::steady_clock::time_point start = chrono::steady_clock::now();
+   layOutField(config.rows, config.columns, config.spacing, ASTEROID_RADIUS, firstX, firstZ, squareX, squareZ, squareSize);
+   generateField(asteroids, config.rows, config.columns, config.fillProbability, config.seed, firstX, firstZ,
+				 config.spacing, ASTEROID_RADIUS, numThreads);
+   report.generateTime = millisecondsSince(start);
+   report.generateAllocations = allocationCounts(ALLOCATION_SETUP);
+   report.numAsteroids = asteroids.size();
+
+   scriptedFlight(config.benchmarkFrames, views);
+   for (k = 0; k < FRAME_VIEWPORTS; k++)
+   {
+      visible[k].reserve(asteroids.size());
+	  listedByQuadtree[k].reserve(asteroids.size());
+	  commands[k].reserve(asteroids.size());
+   }
+   marks.assign(asteroids.size(), -1);
+   drawnMarks.assign(asteroids.size(), 0);
+
+   for (mode = 0; mode < 2; mode++)
+   {
+      BenchmarkMode result;
+	  result.name = (mode == 0) ? "quadtree" : "bruteforce";
+	  result.buildTime = 0.0;
+	  result.numMissed = 0;
+	  result.frames.reserve(views.size());
+	  beginAllocationPhase(ALLOCATION_BUILD);
+	  if (mode == 0)
+	  {
+	     start = chrono::steady_clock::now();
+		 quadtree.setStore(&asteroids);
+		 quadtree.initialize(squareX, squareZ, squareSize);
+		 result.buildTime = millisecondsSince(start);
+		 report.numNodes = quadtree.numberNodes();
+	  }
+	  result.buildAllocations = allocationCounts(ALLOCATION_BUILD);
+	  result.allowedAllocations = 0;
+	  beginAllocationPhase(ALLOCATION_FRAMES);
+
+	  for (i = 0; i < (int)views.size(); i++)
+	  {
+	     BenchmarkFrame frame;
+		 CullStats stats = { 0, 0 };
+		 viewFrusta(views[i], frusta);
+		 quadtree.resetCullStats();
+		 AllocationCounts before = allocationCounts(ALLOCATION_FRAMES);
+
+		 start = chrono::steady_clock::now();
+		 for (k = 0; k < FRAME_VIEWPORTS; k++)
+		 {
+		    visible[k].clear();
+			commands[k].clear();
+		 }
+		 if (mode == 0) quadtree.collectAsteroids(frusta, FRAME_VIEWPORTS, visible, numThreads);
+		 else collectAsteroidsBruteForce(asteroids, frusta, FRAME_VIEWPORTS, visible, &stats);
+		 for (k = 0; k < FRAME_VIEWPORTS; k++)
+		    asteroids.appendDrawCommands(visible[k].data(), visible[k].size(), drawnMarks, drawnMark, commands[k]);
+		 frame.latency = millisecondsSince(start);
+		 AllocationCounts after = allocationCounts(ALLOCATION_FRAMES);
+		 frame.allocations = after.allocations - before.allocations;
+		 frame.bytes = after.bytes - before.bytes;
+
+		 if (mode == 0) stats = quadtree.getCullStats();
+		 frame.nodesVisited = stats.nodesVisited;
+		 frame.tests = stats.tests;
+		 frame.visible = frame.drawn = 0;
+		 for (k = 0; k < FRAME_VIEWPORTS; k++)
+		 {
+		    frame.drawn += commands[k].size();
+			frame.visible += numberUnique(visible[k], marks, mark++);
+		 }
+
+		 if (mode == 1)
+		 {
+		    for (k = 0; k < FRAME_VIEWPORTS; k++) listedByQuadtree[k].clear();
+			quadtree.collectAsteroids(frusta, FRAME_VIEWPORTS, listedByQuadtree, 1);
+			for (k = 0; k < FRAME_VIEWPORTS; k++)
+			{
+			   numberUnique(listedByQuadtree[k], marks, mark);
+			   for (j = 0; j < (int)visible[k].size(); j++)
+			      if (marks[visible[k][j]] != mark) result.numMissed++;
+			   mark++;
+			}
+		 }
+		 result.frames.push_back(frame);
+	  }
+	  result.frameAllocations = allocationCounts(ALLOCATION_FRAMES);
+	  setAllocationPhase(ALLOCATION_SETUP);
+	  report.modes.push_back(result);
+   }
+}
+
+double percentile(const vector<double> &sorted, double fraction)
+{
+   if (sorted.empty()) return 0.0;
+   // Nearest rank.
+   int rank = (int)ceil(fraction * sorted.size());
+   if (rank < 1) rank = 1;
+   return sorted[rank - 1];
+}
+
+void summarize(const BenchmarkMode &mode, BenchmarkSummary &summary)
+{
+   int i, n = mode.frames.size();
+   vector<double> latencies;
+   double latency = 0.0, nodes = 0.0, tests = 0.0, visible = 0.0, drawn = 0.0;
+
+   for (i = 0; i < n; i++)
+   {
+      latencies.push_back(mode.frames[i].latency);
+	  latency += mode.frames[i].latency;
+	  nodes += mode.frames[i].nodesVisited;
+	  tests += mode.frames[i].tests;
+	  visible += mode.frames[i].visible;
+	  drawn += mode.frames[i].drawn;
+   }
+   sort(latencies.begin(), latencies.end());
+   if (n == 0) n = 1;
+   summary.meanLatency = latency / n;
+   summary.p50Latency = percentile(latencies, 0.50);
+   summary.p90Latency = percentile(latencies, 0.90);
+   summary.p99Latency = percentile(latencies, 0.99);
+   summary.maxLatency = latencies.empty() ? 0.0 : latencies.back();
+   summary.meanNodesVisited = nodes / n;
+   summary.meanTests = tests / n;
+   summary.meanVisible = visible / n;
+   summary.meanDrawn = drawn / n;
+}
+
+// Return the most blocks allocated in a frame of the mode after the warm-up.
+static long long mostAllocationsAfterWarmup(const BenchmarkMode &mode)
+{
+   long long most = 0;
+   for (int j = BENCHMARK_WARMUP_FRAMES; j < (int)mode.frames.size(); j++)
+      most = max(most, mode.frames[j].allocations);
+   return most;
+}
+
+void printBenchmark(const BenchmarkReport &report)
+{
+   int i;
+   cout << "Benchmark: " << (report.modes.empty() ? 0 : report.modes[0].frames.size()) << " frames of a scripted flight over "
+		<< report.rows << " rows by " << report.columns << " columns, " << report.fillProbability << "% filled, "
+		<< report.spacing << " apart, seed " << report.seed << " (" << report.numAsteroids << " asteroids), "
+		<< report.numThreads << " threads." << endl;
+   cout << "Generated in " << report.generateTime << " ms (" << report.generateAllocations.allocations << " blocks, "
+		<< report.generateAllocations.bytes / 1024.0 << " KB allocated)." << endl;
+   for (i = 0; i < (int)report.modes.size(); i++)
+   {
+      BenchmarkSummary summary;
+	  summarize(report.modes[i], summary);
+	  cout << report.modes[i].name << ": built in " << report.modes[i].buildTime << " ms";
+	  if (report.modes[i].name == "quadtree") cout << " (" << report.numNodes << " nodes)";
+	  cout << "; latency mean " << summary.meanLatency << " ms, p50 " << summary.p50Latency << ", p90 "
+		   << summary.p90Latency << ", p99 " << summary.p99Latency << ", max " << summary.maxLatency << endl
+		   << "   per frame: " << summary.meanNodesVisited << " nodes visited, " << summary.meanTests << " tests, "
+		   << summary.meanVisible << " visible, " << summary.meanDrawn << " drawn." << endl;
+	  if (report.modes[i].name == "bruteforce")
+	     cout << "   " << report.modes[i].numMissed << " asteroids found by brute force missed by the quadtree." << endl;
+	  cout << "   allocated: " << report.modes[i].buildAllocations.allocations << " blocks, "
+		   << report.modes[i].buildAllocations.bytes / 1024.0 << " KB, building (peak "
+		   << report.modes[i].buildAllocations.peakBytes / 1024.0 << " KB live); " << report.modes[i].frameAllocations.allocations
+		   << " blocks, " << report.modes[i].frameAllocations.bytes / 1024.0 << " KB, over the frames, at most "
+		   << mostAllocationsAfterWarmup(report.modes[i]) << " in a frame after the warm-up (" << report.modes[i].allowedAllocations
+		   << " allowed)." << endl;
+   }
+}
+
+long long numberMissed(const BenchmarkReport &report)
+{
+   long long n = 0;
+   for (int i = 0; i < (int)report.modes.size(); i++) n += report.modes[i].numMissed;
+   return n;
+}
+
+int numberOverdrawnFrames(const BenchmarkReport &report)
+{
+   int i, j, n = 0;
+   for (i = 0; i < (int)report.modes.size(); i++)
+      for (j = 0; j < (int)report.modes[i].frames.size(); j++)
+	     if (report.modes[i].frames[j].drawn > report.modes[i].frames[j].visible) n++;
+   return n;
+}
+
+int numberAllocatingFrames(const BenchmarkReport &report)
+{
+   int i, j, n = 0;
+   for (i = 0; i < (int)report.modes.size(); i++)
+      for (j = BENCHMARK_WARMUP_FRAMES; j < (int)report.modes[i].frames.size(); j++)
+	     if (report.modes[i].frames[j].allocations > report.modes[i].allowedAllocations) n++;
+   return n;
+}
+
+// Write the counts as a JSON object.
+static void writeAllocations(ofstream &out, const AllocationCounts &counts)
+{
+   out << "{ \"blocks\": " << counts.allocations << ", \"bytes\": " << counts.bytes << ", \"freed\": " << counts.frees
+	   << ", \"peakBytes\": " << counts.peakBytes << " }";
+}
+
+int writeBenchmarkReport(const BenchmarkReport &report, const char *fileName)
+{
+   string name = fileName;
+   int isCSV = name.size() >= 4 && name.compare(name.size() - 4, 4, ".csv") == 0;
+   int i, j;
+   ofstream out(fileName);
+
+   if (!out)
+   {
+      cerr << "Cannot write the benchmark report " << fileName << "." << endl;
+	  return 0;
+   }
+   out.precision(9);
+
+   if (isCSV)
+   {
+      out << "mode,frame,latency_ms,nodes_visited,tests,visible,drawn,allocations,bytes_allocated" << endl;
+	  for (i = 0; i < (int)report.modes.size(); i++)
+	     for (j = 0; j < (int)report.modes[i].frames.size(); j++)
+		 {
+		    const BenchmarkFrame &frame = report.modes[i].frames[j];
+			out << report.modes[i].name << "," << j << "," << frame.latency << "," << frame.nodesVisited << ","
+				<< frame.tests << "," << frame.visible << "," << frame.drawn << "," << frame.allocations << "," << frame.bytes << endl;
+		 }
+   }
+   else
+   {
+      out << "{" << endl
+		  << "  \"field\": { \"rows\": " << report.rows << ", \"columns\": " << report.columns << ", \"fill\": "
+		  << report.fillProbability << ", \"spacing\": " << report.spacing << ", \"seed\": " << report.seed
+		  << ", \"asteroids\": " << report.numAsteroids << ", \"nodes\": " << report.numNodes << " }," << endl
+		  << "  \"threads\": " << report.numThreads << "," << endl
+		  << "  \"generateMs\": " << report.generateTime << "," << endl
+		  << "  \"generateAllocations\": ";
+	  writeAllocations(out, report.generateAllocations);
+	  out << "," << endl
+		  << "  \"frameFields\": [\"latencyMs\", \"nodesVisited\", \"tests\", \"visible\", \"drawn\", \"allocations\", \"bytesAllocated\"]," << endl
+		  << "  \"modes\": [" << endl;
+	  for (i = 0; i < (int)report.modes.size(); i++)
+	  {
+	     const BenchmarkMode &mode = report.modes[i];
+		 BenchmarkSummary summary;
+		 summarize(mode, summary);
+		 out << "    { \"mode\": \"" << mode.name << "\", \"buildMs\": " << mode.buildTime << "," << endl
+			 << "      \"latencyMs\": { \"mean\": " << summary.meanLatency << ", \"p50\": " << summary.p50Latency
+			 << ", \"p90\": " << summary.p90Latency << ", \"p99\": " << summary.p99Latency << ", \"max\": "
+			 << summary.maxLatency << " }," << endl
+			 << "      \"perFrame\": { \"nodesVisited\": " << summary.meanNodesVisited << ", \"tests\": "
+			 << summary.meanTests << ", \"visible\": " << summary.meanVisible << ", \"drawn\": " << summary.meanDrawn
+			 << " }," << endl
+			 << "      \"missed\": " << mode.numMissed << "," << endl
+			 << "      \"allocations\": { \"build\": ";
+		 writeAllocations(out, mode.buildAllocations);
+		 out << ", \"frames\": ";
+		 writeAllocations(out, mode.frameAllocations);
+		 out << ", \"mostAfterWarmup\": " << mostAllocationsAfterWarmup(mode) << ", \"allowed\": " << mode.allowedAllocations
+			 << " }," << endl
+			 << "      \"frames\": [";
+		 for (j = 0; j < (int)mode.frames.size(); j++)
+		    out << (j > 0 ? ", " : "") << "[" << mode.frames[j].latency << ", " << mode.frames[j].nodesVisited << ", "
+			    << mode.frames[j].tests << ", " << mode.frames[j].visible << ", " << mode.frames[j].drawn << ", "
+				<< mode.frames[j].allocations << ", "
+				<< mode.frames[j].bytes << "]";
+		 out << "] }" << (i + 1 < (int)report.modes.size() ? "," : "") << endl;
+	  }
+      out << "  ]" << endl
+		  << "}" << endl;
+   }
+
+   if (!out)
+   {
+      cerr << "Cannot write the benchmark report " << fileName << "." << endl;
+	  return 0;
+   }
+   return 1;
+}
@@ -0,0 +1,96 @@
+#ifndef Benchmark_61207
+#define Benchmark_61207
+
+#include <string>
+#include <vector>
+#include "Config.h"
+#include "FramePipeline.h"
+#include "AllocationTracker.h"
+
+using namespace std;
+
+#define BENCHMARK_STEP 3.0 // Distance the spacecraft flies each frame of the scripted flight.
+#define BENCHMARK_WEAVE_FRAMES 600 // Frames of a full weave of the spacecraft from side to side ...
+#define BENCHMARK_WEAVE_ANGLE 60.0 // ... turning up to this many degrees either way.
+#define BENCHMARK_WARMUP_FRAMES 10 // Frames at the start of each mode that may allocate, as the lists
+                                   // kept from frame to frame grow; the frames after must not.
+
+// Measurements of a frame of the benchmark in one culling mode.
+struct BenchmarkFrame
+{
+   double latency;         // Milliseconds to cull both viewports and make their draw commands.
+   long long nodesVisited; // Quadtree squares tested (none by brute force).
+   long long tests;        // Tests against a frustum, of squares or of asteroids' bounding squares.
+   int visible;            // Asteroids in the frusta, each once for each viewport it is seen in.
+   int drawn;              // Draw commands issued, over both viewports: one for each visible asteroid,
+                           // though the quadtree lists one for each leaf it intersects in a frustum.
+   long long allocations;  // Blocks allocated in doing so ...
+   long long bytes;        // ... and their bytes.
+};
+
+// Results of the benchmark in one culling mode.
+struct BenchmarkMode
+{
+   string name;                  // "quadtree" or "bruteforce".
+   double buildTime;             // Milliseconds to build what the mode culls with.
+   vector<BenchmarkFrame> frames;
+   AllocationCounts buildAllocations, frameAllocations; // Over the build, and over all the frames.
+   int allowedAllocations;       // Blocks a frame after the warm-up may allocate: none, in every mode,
+                                 // the threads of a parallel traversal being kept in the quadtree.
+   long long numMissed;          // Asteroids brute force finds in a frustum that the quadtree does not
+                                 // list for it, over the frames (always 0 for the quadtree).
+};
+
+// Results of a benchmark run: the field, and the measurements in each mode.
+struct BenchmarkReport
+{
+   int rows, columns, fillProbability;
+   float spacing;
+   unsigned seed;
+   int numAsteroids, numNodes, numThreads;
+   double generateTime; // Milliseconds to generate the field.
+   AllocationCounts generateAllocations;
+   vector<BenchmarkMode> modes;
+};
+
+// Summary of the frames of a mode: latency in milliseconds and the other measurements per frame.
+struct BenchmarkSummary
+{
+   double meanLatency, p50Latency, p90Latency, p99Latency, maxLatency;
+   double meanNodesVisited, meanTests, meanVisible, meanDrawn;
+};
+
+// Fill views with the frames of the scripted flight: the spacecraft sets off from the origin into
+// the field and flies BENCHMARK_STEP a frame, weaving from side to side, with culling on. The
+// flight is the same every run, so runs over the same field can be compared.
+void scriptedFlight(int numFrames, vector<ViewState> &views);
+
+// Run the benchmark of the configuration without a window: generate the field with its settings,
+// build its quadtree, and cull the frusta of both viewports for each frame of the scripted flight,
+// making the draw commands, by the quadtree with up to numThreads threads and by brute force.
+// Allocations are tracked throughout, for the generation, each build and each frame. Each frame
+// by brute force is culled by the quadtree as well, untimed, to check that it lists every asteroid
+// brute force finds.
+void runBenchmark(const Config &config, int numThreads, BenchmarkReport &report);
+
+double percentile(const vector<double> &sorted, double fraction); // Return the value below which the given
+                                                                  // fraction of the sorted values lie.
+void summarize(const BenchmarkMode &mode, BenchmarkSummary &summary);
+void printBenchmark(const BenchmarkReport &report); // Print the summary of each mode.
+int numberAllocatingFrames(const BenchmarkReport &report); // Return the frames after the warm-up, over all the
+                                                           // modes, that allocated more than allowed.
+long long numberMissed(const BenchmarkReport &report); // Return the asteroids brute force found that the
+                                                       // quadtree missed, over all the frames.
+int numberOverdrawnFrames(const BenchmarkReport &report); // Return the frames, over all the modes, with more
+                                                          // draw commands than visible asteroids.
+
+// Return the number of different asteroids in the list, marking each in marks, which has an entry for
+// every asteroid, with mark; no entry may hold mark before.
+int numberUnique(const vector<int> &ids, vector<int> &marks, int mark);
+
+// Write the report to the file, as CSV, a line for each frame of each mode, if its name ends in
+// .csv, and otherwise as JSON, with the summary of each mode as well as its frames. Return 1 if
+// written, or report the problem and return 0.
+int writeBenchmarkReport(const BenchmarkReport &report, const char *fileName);
+
+#endif
@@ -0,0 +1,250 @@
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include "ChunkedField.h"
+#include "FieldGenerator.h"
+#include "Trace.h"
+
+using namespace std;
+
+// Return a key for the chunk, unique for every chunkX and chunkZ.
+static long long chunkKey(int chunkX, int chunkZ)
+{
+   return ((long long)chunkX << 32) | (unsigned int)chunkZ;
+}
+
+static int chunkKeyX(long long key) { return (int)(key >> 32); }
+static int chunkKeyZ(long long key) { return (int)(unsigned int)key; }
+
+ChunkedField::ChunkedField(unsigned seed, int fillProbability, float spacing, float radius, 
+						   size_t budget, int numThreads)
+{
+   int i, numWorkers = numThreads - 1;
+   this->seed = seed;
+   this->fillProbability = fillProbability;
+   this->spacing = spacing;
+   this->radius = radius;
+   this->budget = budget;
+   residentBytes = 0;
+   numGenerated = numGeneratedLate = 0;
+   isStopping = 0;
+   drawnMark = 0;
+
+   // Leave the drawing thread a core of its own where there are enough to go round.
+   if (numWorkers < 1) numWorkers = 1;
+   for (i = 0; i < numWorkers; i++)
+      workers.push_back(thread(&ChunkedField::work, this));
+}
+
+ChunkedField::~ChunkedField()
+{
+   int i;
+   {
+      lock_guard<mutex> guard(lock);
+	  isStopping = 1;
+   }
+   wake.notify_all();
+   for (i = 0; i < (int)workers.size(); i++) workers[i].join();
+
+   for (unordered_map<long long, Entry>::iterator entry = resident.begin(); entry != resident.end(); entry++)
+      delete entry->second.chunk;
+   for (i = 0; i < (int)finished.size(); i++) delete finished[i];
+}
+
+// Generate the chunk: its slot in row i and column j is the slot in row chunkZ * CHUNK_SLOTS + i and
+// column chunkX * CHUNK_SLOTS + j of the field, whose asteroid, if any, is centered at 
+// (column * spacing, 0, -row * spacing). The root square of the chunk's quadtree bounds the
+// asteroids of all its slots.
+Chunk *ChunkedField::generate(int chunkX, int chunkZ)
+{
+   TRACE_SCOPE("ChunkedField::generate");
+   int i, j, row, column;
+   float x, z;
+   Chunk *chunk = new Chunk;
+
+   chunk->chunkX = chunkX;
+   chunk->chunkZ = chunkZ;
+   chunk->asteroids.reset(CHUNK_SLOTS);
+   for (i = 0; i < CHUNK_SLOTS; i++)
+      for (j = 0; j < CHUNK_SLOTS; j++)
+	  {
+	     row = chunkZ * CHUNK_SLOTS + i;
+		 column = chunkX * CHUNK_SLOTS + j;
+		 unsigned long long bits = slotRandom(seed, row, column);
+		 if (!isSlotFilled(bits, fillProbability)) continue;
+		 x = column * spacing;
+		 z = -row * spacing;
+		 if (x * x + z * z < CHUNK_CLEAR_RADIUS * CHUNK_CLEAR_RADIUS) continue;
+		 chunk->asteroids.add(i, j, x, 0.0, z, radius, slotRed(bits), slotGreen(bits), slotBlue(bits));
+	  }
+
+   chunk->SWCornerX = chunkX * CHUNK_SLOTS * spacing - radius;
+   chunk->SWCornerZ = -chunkZ * CHUNK_SLOTS * spacing + radius;
+   chunk->size = (CHUNK_SLOTS - 1) * spacing + 2.0 * radius;
+   chunk->quadtree.setStore(&chunk->asteroids);
+   chunk->quadtree.initialize(chunk->SWCornerX, chunk->SWCornerZ, chunk->size);
+   chunk->quadtree.releaseBuildStorage(); // A chunk's tree is built once.
+   chunk->bytes = sizeof(Chunk) + chunk->asteroids.memoryUsed() + chunk->quadtree.memoryUsed();
+   return chunk;
+}
+
+// Set keys to the chunks whose slots lie within CHUNK_VIEW_DISTANCE, plus an asteroid radius, of
+// (x, z) along x and along z, nearest first. A chunk takes the slots from half a spacing before 
+// its first row or column up to half a spacing before the next chunk's.
+void ChunkedField::chunksAround(float x, float z, vector<long long> &keys)
+{
+   int chunkX, chunkZ, k;
+   float width = CHUNK_SLOTS * spacing, reach = CHUNK_VIEW_DISTANCE + radius;
+   int minChunkX = (int)floor((x - reach + spacing / 2.0) / width), maxChunkX = (int)floor((x + reach + spacing / 2.0) / width);
+   int minChunkZ = (int)floor((-z - reach + spacing / 2.0) / width), maxChunkZ = (int)floor((-z + reach + spacing / 2.0) / width);
+   vector<float> distances;
+
+   keys.clear();
+   for (chunkX = minChunkX; chunkX <= maxChunkX; chunkX++)
+      for (chunkZ = minChunkZ; chunkZ <= maxChunkZ; chunkZ++)
+	  {
+	     float dx = (chunkX + 0.5) * width - spacing / 2.0 - x, dz = -(chunkZ + 0.5) * width + spacing / 2.0 - z;
+		 float distance = dx * dx + dz * dz;
+		 // Insertion sort on the distance of the chunk's center; there are only a few chunks.
+		 keys.push_back(0); distances.push_back(0.0);
+		 for (k = keys.size() - 1; k > 0 && distances[k-1] > distance; k--)
+		 {
+		    keys[k] = keys[k-1];
+			distances[k] = distances[k-1];
+		 }
+		 keys[k] = chunkKey(chunkX, chunkZ);
+		 distances[k] = distance;
+	  }
+}
+
+void ChunkedField::makeResident(Chunk *chunk)
+{
+   long long key = chunkKey(chunk->chunkX, chunk->chunkZ);
+   uses.push_front(key);
+   Entry entry = { chunk, uses.begin() };
+   resident[key] = entry;
+   residentBytes += chunk->bytes;
+}
+
+// The chunks around the spacecraft are made resident, taking any a worker has finished and
+// generating any other at once, and are marked as the most recently used. The workers are asked
+// for the chunks around a point CHUNK_VIEW_DISTANCE ahead of the spacecraft, so that what they 
+// generate reaches on from what is needed now; this replaces what was asked for before, since the
+// spacecraft may have turned. Then, while the cache is over budget, the
+// least recently used chunk is dropped unless it is needed now.
+void ChunkedField::update(float x, float z, float angle)
+{
+   int i;
+   vector<Chunk *> ready;
+   vector<long long> needed, wanted;
+   unordered_map<long long, Entry>::iterator entry;
+
+   {
+      lock_guard<mutex> guard(lock);
+	  ready.swap(finished);
+   }
+   for (i = 0; i < (int)ready.size(); i++)
+   {
+      numGenerated++;
+      if (resident.count(chunkKey(ready[i]->chunkX, ready[i]->chunkZ))) delete ready[i]; // Generated late meanwhile.
+	  else makeResident(ready[i]);
+   }
+
+   chunksAround(x, z, needed);
+   for (i = 0; i < (int)needed.size(); i++)
+   {
+      entry = resident.find(needed[i]);
+	  if (entry == resident.end())
+	  {
+	     makeResident(generate(chunkKeyX(needed[i]), chunkKeyZ(needed[i])));
+		 numGenerated++;
+		 numGeneratedLate++;
+	  }
+	  else uses.splice(uses.begin(), uses, entry->second.use);
+   }
+
+   chunksAround(x - CHUNK_VIEW_DISTANCE * sin((PI / 180.0) * angle), z - CHUNK_VIEW_DISTANCE * cos((PI / 180.0) * angle), wanted);
+   {
+      lock_guard<mutex> guard(lock);
+	  requests.clear();
+	  for (i = 0; i < (int)wanted.size(); i++)
+	     if (!resident.count(wanted[i]) && !inProgress.count(wanted[i])) requests.push_back(wanted[i]);
+   }
+   wake.notify_all();
+
+   while (residentBytes > budget && !uses.empty())
+   {
+      long long key = uses.back();
+	  if (find(needed.begin(), needed.end(), key) != needed.end()) break; // All the rest are needed too.
+	  entry = resident.find(key);
+	  residentBytes -= entry->second.chunk->bytes;
+	  delete entry->second.chunk;
+	  resident.erase(entry);
+	  uses.pop_back();
+   }
+}
+
+// Loop of a worker thread: take the first chunk asked for, generate it and hand it over.
+void ChunkedField::work()
+{
+   nameTraceThread("Chunk generator");
+   unique_lock<mutex> guard(lock);
+   while (1)
+   {
+      wake.wait(guard, [this] { return isStopping || !requests.empty(); });
+	  if (isStopping) return;
+	  long long key = requests.front();
+	  requests.pop_front();
+	  inProgress.insert(key);
+
+	  guard.unlock();
+	  Chunk *chunk = generate(chunkKeyX(key), chunkKeyZ(key));
+	  guard.lock();
+
+	  inProgress.erase(key);
+	  finished.push_back(chunk);
+   }
+}
+
+// Each chunk's quadtree rejects the frustum at its root square if they do not meet.
+void ChunkedField::collectDrawCommands(const Frustum *frusta, int numFrusta, vector<AsteroidDrawCommand> *commands,
+									  CullStats *stats)
+{
+   int k;
+   if ((int)visible.size() < numFrusta) visible.resize(numFrusta);
+   for (unordered_map<long long, Entry>::iterator entry = resident.begin(); entry != resident.end(); entry++)
+   {
+      Quadtree &quadtree = entry->second.chunk->quadtree;
+      for (k = 0; k < numFrusta; k++) visible[k].clear();
+	  quadtree.resetCullStats();
+      quadtree.collectAsteroids(frusta, numFrusta, visible.data());
+	  if (stats != NULL)
+	  {
+	     stats->nodesVisited += quadtree.getCullStats().nodesVisited;
+		 stats->tests += quadtree.getCullStats().tests;
+	  }
+	  for (k = 0; k < numFrusta; k++)
+	     entry->second.chunk->asteroids.appendDrawCommands(visible[k].data(), visible[k].size(), drawnMarks, drawnMark,
+														   commands[k]);
+   }
+}
+
+void ChunkedField::collectAllDrawCommands(vector<AsteroidDrawCommand> &commands)
+{
+   for (unordered_map<long long, Entry>::iterator entry = resident.begin(); entry != resident.end(); entry++)
+      entry->second.chunk->asteroids.appendAllDrawCommands(commands);
+}
+
+SweepHit ChunkedField::sweepSphere(const glm::vec3 &start, const glm::vec3 &end, float radius)
+{
+   SweepHit sweep, chunkSweep;
+   sweep.asteroid = -1;
+   sweep.timeOfImpact = 1.0;
+   for (unordered_map<long long, Entry>::iterator entry = resident.begin(); entry != resident.end(); entry++)
+   {
+      chunkSweep = entry->second.chunk->quadtree.sweepSphere(start, end, radius);
+	  if (chunkSweep.asteroid >= 0 && (sweep.asteroid < 0 || chunkSweep.timeOfImpact < sweep.timeOfImpact))
+	     sweep = chunkSweep;
+   }
+   return sweep;
+}
@@ -0,0 +1,108 @@
+#ifndef ChunkedField_84150
+#define ChunkedField_84150
+
+#include <vector>
+#include <deque>
+#include <list>
+#include <set>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "AsteroidStore.h"
+#include "QuadTree.h"
+
+using namespace std;
+
+#define CHUNK_SLOTS 32 // A chunk is CHUNK_SLOTS by CHUNK_SLOTS slots of the field.
+#define CHUNK_VIEW_DISTANCE 400.0 // Chunks within this distance along x or z of the spacecraft must be
+                                  // resident: it takes in the frustum carried by the spacecraft.
+#define CHUNK_CLEAR_RADIUS 40.0 // No asteroids are placed within this distance of the origin, where
+                                // the spacecraft starts.
+
+// A chunk of the field: its asteroids and a quadtree of its own over them.
+struct Chunk
+{
+   int chunkX, chunkZ;
+   AsteroidStore asteroids;
+   Quadtree quadtree;
+   float SWCornerX, SWCornerZ, size; // Root square of the quadtree, which bounds the asteroids.
+   size_t bytes;                     // Memory held by the chunk.
+};
+
+// Unbounded asteroid field, generated on demand in chunks around the spacecraft. Each slot of the
+// infinite grid is filled, and its asteroid colored, from a hash of the seed and the slot's row and
+// column, so a chunk comes out the same whenever and on whichever thread it is generated, and
+// a chunk that was dropped can be generated again. Generated chunks are kept in a cache in order
+// of last use, and the least recently used are dropped once the cache holds more than its budget
+// of memory, except for those the spacecraft needs now. Worker threads generate the chunks the 
+// spacecraft is heading into before it gets there; a chunk it needs and that is not ready is
+// generated at once on the calling thread.
+class ChunkedField
+{
+public:
+   ChunkedField(unsigned seed, int fillProbability, float spacing, float radius, // Start the worker
+                size_t budget, int numThreads);                                  // threads, one fewer
+                                                                                 // than numThreads.
+   ~ChunkedField(); // Stop the worker threads and free every chunk.
+
+   void update(float x, float z, float angle); // Make resident the chunks needed by the spacecraft with
+                                               // its base at (x, 0, z), aligned at angle degrees to -z,
+                                               // ask for those ahead of it and drop chunks over budget.
+
+   void collectDrawCommands(const Frustum *frusta, int numFrusta,     // Append to commands[k] the commands to
+                            vector<AsteroidDrawCommand> *commands,   // draw the asteroids of the resident chunks
+                            CullStats *stats = NULL);                // that culling to frustum k lets through,
+                                                                     // in one traversal of each chunk's quadtree;
+                                                                     // the work is added to stats if given.
+   void collectAllDrawCommands(vector<AsteroidDrawCommand> &commands); // Append the commands to draw the 
+                                                                      // asteroids of every resident chunk.
+
+   SweepHit sweepSphere(const glm::vec3 &start, const glm::vec3 &end, // As Quadtree::sweepSphere over the
+                        float radius);                                // resident chunks; the id of the
+                                                                      // asteroid is within its chunk.
+
+   int numberChunksResident() { return resident.size(); }
+   size_t memoryUsed() { return residentBytes; }
+   int numberChunksGenerated() { return numGenerated; }     // Chunks generated, by workers or not.
+   int numberChunksGeneratedLate() { return numGeneratedLate; } // Chunks generated on the calling thread
+                                                               // because the workers had not got to them.
+
+private:
+   struct Entry // A resident chunk and its place in the order of use.
+   {
+      Chunk *chunk;
+	  list<long long>::iterator use;
+   };
+
+   Chunk *generate(int chunkX, int chunkZ); // Generate the chunk; safe to call from any thread.
+   void chunksAround(float x, float z, vector<long long> &keys); // Keys of the chunks within 
+                                                                 // CHUNK_VIEW_DISTANCE along x or z of (x, z).
+   void makeResident(Chunk *chunk); // Add a generated chunk to the cache as the most recently used.
+   void work(); // Loop of a worker thread.
+
+   unsigned seed;
+   int fillProbability;
+   float spacing, radius;
+   size_t budget;
+   vector< vector<int> > visible; // Asteroids of a chunk let through by culling to each frustum, reused from
+                                  // chunk to chunk.
+   vector<int> drawnMarks; // Stamps of the asteroids of a chunk given draw commands, reused from chunk to
+   int drawnMark;          // chunk, to give each only one a frustum.
+
+   unordered_map<long long, Entry> resident; // Resident chunks by key (see chunkKey in ChunkedField.cpp).
+   list<long long> uses;                     // Keys of the resident chunks, most recently used first.
+   size_t residentBytes;
+   int numGenerated, numGeneratedLate;
+
+   // Shared with the worker threads, under lock.
+   mutex lock;
+   condition_variable wake;
+   deque<long long> requests;   // Chunks wanted ahead of the spacecraft, nearest first.
+   set<long long> inProgress;   // Chunks being generated by a worker.
+   vector<Chunk *> finished;    // Chunks generated by a worker and not yet taken into the cache.
+   int isStopping;
+   vector<thread> workers;
+};
+
+#endif
@@ -0,0 +1,281 @@
+#include <cstdlib>
+#include <ctime>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include "Config.h"
+#include "Gravity.h"
+#include "RenderBackend.h"
+
+using namespace std;
+
+// Config constructor: the field of the original program, 100 by 100 asteroids 30 apart.
+Config::Config()
+{
+   rows = 100;
+   columns = 100;
+   fillProbability = 100;
+   spacing = 30.0;
+   seed = (unsigned)time(0);
+   isStreamed = 0;
+   budget = 64;
+   threads = 0;
+   headlessTicks = 0;
+   gravityMode = GRAVITY_OFF;
+   benchmarkFrames = 0;
+   microbenchmarkInputs = 0;
+   isUnthrottled = 0;
+   offscreenFrames = 0;
+   backend = RENDER_GL;
+   isAllocationTracked = 0;
+   isQuadtreeShown = 0;
+   isRebaselined = 0;
+}
+
+// Return 1 if the text is a whole number, putting it in number.
+static int parseNumber(const string &text, long long &number)
+{
+   char *end;
+   if (text.empty()) return 0;
+   number = strtoll(text.c_str(), &end, 10);
+   return *end == '\0';
+}
+
+int setOption(Config &config, const string &name, const string &value)
+{
+   long long number = 0;
+   int isNumber = parseNumber(value, number);
+
+   if (name == "rows" || name == "columns")
+   {
+      long long other = (name == "rows") ? config.columns : config.rows;
+	  if (!isNumber || number < 1 || number * other > INT_MAX)
+	  {
+	     cerr << name << " must be a whole number at least 1, with rows * columns at most " << INT_MAX << "." << endl;
+		 return 0;
+	  }
+	  if (name == "rows") config.rows = (int)number; 
+	  else config.columns = (int)number;
+   }
+   else if (name == "fill")
+   {
+      if (!isNumber || number < 0 || number > 100)
+	  {
+	     cerr << "fill must be a whole number between 0 and 100." << endl;
+		 return 0;
+	  }
+	  config.fillProbability = (int)number;
+   }
+   else if (name == "spacing")
+   {
+      char *end;
+	  float spacing = strtof(value.c_str(), &end);
+	  if (value.empty() || *end != '\0' || !(spacing > 0.0))
+	  {
+	     cerr << "spacing must be a positive number." << endl;
+		 return 0;
+	  }
+	  config.spacing = spacing;
+   }
+   else if (name == "seed")
+   {
+      if (!isNumber || number < 0 || number > UINT_MAX)
+	  {
+	     cerr << "seed must be a whole number between 0 and " << UINT_MAX << "." << endl;
+		 return 0;
+	  }
+	  config.seed = (unsigned)number;
+   }
+   else if (name == "stream")
+   {
+      if (!isNumber || (number != 0 && number != 1))
+	  {
+	     cerr << "stream must be 0 or 1." << endl;
+		 return 0;
+	  }
+	  config.isStreamed = (int)number;
+   }
+   else if (name == "budget")
+   {
+      if (!isNumber || number < 1 || number > INT_MAX)
+	  {
+	     cerr << "budget must be a whole number of megabytes at least 1." << endl;
+		 return 0;
+	  }
+	  config.budget = (int)number;
+   }
+   else if (name == "save") config.saveFile = value;
+   else if (name == "load") config.loadFile = value;
+   else if (name == "threads")
+   {
+      if (!isNumber || number < 0 || number > 1024)
+	  {
+	     cerr << "threads must be a whole number from 0 to 1024." << endl;
+		 return 0;
+	  }
+	  config.threads = (int)number;
+   }
+   else if (name == "headless")
+   {
+      if (!isNumber || number < 0 || number > INT_MAX)
+	  {
+	     cerr << "headless must be a whole number of ticks." << endl;
+		 return 0;
+	  }
+	  config.headlessTicks = (int)number;
+   }
+   else if (name == "gravity")
+   {
+      if (value == "off") config.gravityMode = GRAVITY_OFF;
+	  else if (value == "bh") config.gravityMode = GRAVITY_BARNES_HUT;
+	  else if (value == "direct") config.gravityMode = GRAVITY_DIRECT;
+	  else
+	  {
+	     cerr << "gravity must be off, bh or direct." << endl;
+		 return 0;
+	  }
+   }
+   else if (name == "benchmark")
+   {
+      if (!isNumber || number < 0 || number > INT_MAX)
+	  {
+	     cerr << "benchmark must be a whole number of frames." << endl;
+		 return 0;
+	  }
+	  config.benchmarkFrames = (int)number;
+   }
+   else if (name == "microbenchmark")
+   {
+      if (!isNumber || number < 0 || number > INT_MAX)
+	  {
+	     cerr << "microbenchmark must be a whole number of inputs." << endl;
+		 return 0;
+	  }
+	  config.microbenchmarkInputs = (int)number;
+   }
+   else if (name == "report") config.reportFile = value;
+   else if (name == "record") config.recordFile = value;
+   else if (name == "replay") config.replayFile = value;
+   else if (name == "trace") config.traceFile = value;
+   else if (name == "offscreen")
+   {
+      if (!isNumber || number < 0 || number > INT_MAX)
+	  {
+	     cerr << "offscreen must be a whole number of frames." << endl;
+		 return 0;
+	  }
+	  config.offscreenFrames = (int)number;
+   }
+   else if (name == "backend")
+   {
+      if (value == "gl") config.backend = RENDER_GL;
+	  else if (value == "null") config.backend = RENDER_NULL;
+	  else if (value == "record") config.backend = RENDER_RECORD;
+	  else
+	  {
+	     cerr << "backend must be gl, null or record." << endl;
+		 return 0;
+	  }
+   }
+   else if (name == "calls") config.callsFile = value;
+   else if (name == "allocations")
+   {
+      if (!isNumber || (number != 0 && number != 1))
+	  {
+	     cerr << "allocations must be 0 or 1." << endl;
+		 return 0;
+	  }
+	  config.isAllocationTracked = (int)number;
+   }
+   else if (name == "quadtree")
+   {
+      if (!isNumber || (number != 0 && number != 1))
+	  {
+	     cerr << "quadtree must be 0 or 1." << endl;
+		 return 0;
+	  }
+	  config.isQuadtreeShown = (int)number;
+   }
+   else if (name == "regress") config.regressionDir = value;
+   else if (name == "rebaseline")
+   {
+      if (!isNumber || (number != 0 && number != 1))
+	  {
+	     cerr << "rebaseline must be 0 or 1." << endl;
+		 return 0;
+	  }
+	  config.isRebaselined = (int)number;
+   }
+   else if (name == "unthrottled")
+   {
+      if (!isNumber || (number != 0 && number != 1))
+	  {
+	     cerr << "unthrottled must be 0 or 1." << endl;
+		 return 0;
+	  }
+	  config.isUnthrottled = (int)number;
+   }
+   else
+   {
+      cerr << "Unknown setting " << name << "." << endl;
+	  return 0;
+   }
+   return 1;
+}
+
+int readConfigFile(Config &config, const char *fileName)
+{
+   ifstream file(fileName);
+   string line;
+   int lineNumber = 0;
+
+   if (!file)
+   {
+      cerr << "Cannot open configuration file " << fileName << "." << endl;
+	  return 0;
+   }
+
+   while (getline(file, line))
+   {
+      lineNumber++;
+	  size_t comment = line.find('#');
+	  if (comment != string::npos) line.erase(comment);
+
+	  string name, equals, value, rest;
+	  istringstream words(line);
+	  if (!(words >> name)) continue; // Blank line.
+	  if (!(words >> equals >> value) || equals != "=" || (words >> rest))
+	  {
+	     cerr << fileName << ", line " << lineNumber << ": expected \"name = value\"." << endl;
+		 return 0;
+	  }
+	  if (!setOption(config, name, value))
+	  {
+	     cerr << "(" << fileName << ", line " << lineNumber << ")" << endl;
+		 return 0;
+	  }
+   }
+   return 1;
+}
+
+int parseCommandLine(Config &config, int argc, char **argv)
+{
+   int i;
+   for (i = 1; i < argc; i++)
+   {
+      if (strncmp(argv[i], "--", 2) != 0 || i + 1 >= argc)
+	  {
+	     cerr << "Expected --name value, not " << argv[i] << "." << endl;
+		 return 0;
+	  }
+	  string name = argv[i] + 2, value = argv[++i];
+	  if (name == "config")
+	  {
+	     if (!readConfigFile(config, value.c_str())) return 0;
+	  }
+	  else if (!setOption(config, name, value)) return 0;
+   }
+   return 1;
+}
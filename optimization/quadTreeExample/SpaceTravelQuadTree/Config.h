@@ -0,0 +1,95 @@
+#ifndef Config_72813
+#define Config_72813
+
+#include <string>
+
+using namespace std;
+
+// Settings of a run of the program: the size and make-up of the asteroid field and what the
+// program is to do with it. Each setting has a default and may be given on the command line as
+// --name value, or as a line "name = value" in a configuration file read with --config FILE; 
+// settings are applied in the order given, so a later one overrides an earlier.
+//
+//    rows N          number of rows of asteroids
+//    columns N       number of columns of asteroids
+//    fill P          percentage probability that a row-column slot is filled with an asteroid
+//    spacing D       distance between neighbouring rows, and between neighbouring columns
+//    seed S          seed of the random numbers that fill and color the field
+//    stream 0|1      1 for an unbounded field generated in chunks around the spacecraft (rows
+//                    and columns are then ignored)
+//    budget MB       memory in megabytes for the chunks of an unbounded field
+//    save FILE       write a snapshot of the generated field, with its quadtree, to FILE
+//    load FILE       map the field and its quadtree from a snapshot in FILE instead of generating
+//                    them (the settings of the field are then those of the snapshot)
+//    threads N       number of threads to generate, cull and move the field with; 0, the default,
+//                    for one per core (the field, and what is drawn of it, is the same for any number)
+//    headless TICKS  run the simulation for TICKS ticks without a window
+//    gravity MODE    gravity between drifting asteroids from the start: off, bh or direct
+//    benchmark N     benchmark the culling over N frames of a scripted flight without a window
+//    report FILE     write the results of a benchmark, microbenchmark or regression suite to FILE,
+//                    as CSV if its name ends in .csv and as JSON otherwise
+//    microbenchmark N time the intersection routines, and check the accelerated ones against 
+//                    the originals, on sets of N inputs each, without a window
+//    record FILE     write the key events of the interactive program, with the tick each was
+//                    applied at and the settings of the field, to FILE at the end
+//    replay FILE     fly the spacecraft by the key events recorded in FILE, over the field they 
+//                    were recorded over, and end when they do
+//    unthrottled 0|1 1 to replay as fast as frames can be drawn, a tick a frame, and report the
+//                    frame times
+//    trace FILE      record a timeline of the phases of setup and of each frame, on every thread,
+//                    and write it to FILE as Chrome trace-event JSON at the end
+//    offscreen N     draw N frames into a framebuffer with no window, as fast as they can be drawn,
+//                    and report the frame times (needs a build with OFFSCREEN_EGL)
+//    backend NAME    what frames drawn offscreen go through: gl, OpenGL; null, nothing; or record,
+//                    which counts the calls (the last two need no OpenGL)
+//    calls FILE      write the calls of the record backend to FILE
+//    quadtree 0|1    1 to show the squares of the quadtree culling visits, and what it did with each,
+//                    from the start
+//    allocations 0|1 1 to count the memory allocated in setting up, in building the quadtree and in
+//                    the frames, and report it at the end (a benchmark always counts it)
+//    regress DIR     run the regression suite without a window, and compare its medians with the
+//                    baselines in the directory DIR
+//    rebaseline 0|1  1 to write the medians of the regression suite to DIR as its new baselines
+struct Config
+{
+   Config();
+   int rows;
+   int columns;
+   int fillProbability;
+   float spacing;
+   unsigned seed;       // Defaults to the time, so each run differs unless a seed is given.
+   int isStreamed;
+   int budget;
+   string saveFile;     // Empty for none.
+   string loadFile;     // Empty for none.
+   int threads;         // 0 for one per core.
+   int headlessTicks;   // 0 for the interactive program.
+   int gravityMode;     // See Gravity.h.
+   int benchmarkFrames; // 0 for no benchmark.
+   string reportFile;   // Empty for none.
+   int microbenchmarkInputs; // 0 for no microbenchmark.
+   string recordFile;   // Empty for none.
+   string replayFile;   // Empty for none.
+   int isUnthrottled;
+   string traceFile;    // Empty for none.
+   int offscreenFrames; // 0 to draw in a window.
+   int backend;         // See RenderBackend.h.
+   string callsFile;    // Empty for none.
+   int isAllocationTracked;
+   int isQuadtreeShown;
+   string regressionDir; // Empty for no regression suite.
+   int isRebaselined;
+};
+
+// Set the named setting from its value as text; return 1 if done, or report the problem and 
+// return 0 if the name is unknown or the value out of range.
+int setOption(Config &config, const string &name, const string &value);
+
+// Apply the settings in a configuration file, one "name = value" per line; blank lines and
+// anything after a # are ignored. Return 1 if all were applied, 0 otherwise.
+int readConfigFile(Config &config, const char *fileName);
+
+// Apply the settings on the command line. Return 1 if all were applied, 0 otherwise.
+int parseCommandLine(Config &config, int argc, char **argv);
+
+#endif
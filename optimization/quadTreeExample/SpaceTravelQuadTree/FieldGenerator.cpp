@@ -0,0 +1,93 @@
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include "FieldGenerator.h"
+#include "Trace.h"
+
+using namespace std;
+
+// The finalizer of the SplitMix64 generator is applied in turn to the seed, and to the result
+// combined with the row and then with the column.
+unsigned long long slotRandom(unsigned seed, int row, int column)
+{
+   unsigned long long h = seed;
+   unsigned int words[2] = { (unsigned int)row, (unsigned int)column };
+   for (int i = 0; i < 3; i++)
+   {
+      if (i > 0) h ^= words[i - 1];
+      h += 0x9E3779B97F4A7C15ULL;
+	  h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	  h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+	  h ^= h >> 31;
+   }
+   return h;
+}
+
+void layOutField(int rows, int columns, float spacing, float radius, float &firstX, float &firstZ,
+				 float &squareX, float &squareZ, float &squareSize)
+{
+   // Position the asteroids depending on if there is an even or odd number of columns.
+   if (columns % 2) firstX = spacing*(-columns / 2); // Odd number of columns.
+   else firstX = spacing/2.0 + spacing*(-columns / 2); // Even number of columns.
+   firstZ = -40.0;
+
+   if (rows <= columns) squareSize = (columns - 1)*spacing + 2.0*radius;
+   else squareSize = (rows - 1)*spacing + 2.0*radius;
+   squareX = -squareSize/2.0; squareZ = firstZ + radius;
+}
+
+// Two passes over the slots: the first counts the asteroids in each range of rows, which gives the
+// id of the first asteroid of each range, and the second sets the asteroids in the store. Ids thus
+// follow row-major order of the slots whatever the ranges are.
+void generateField(AsteroidStore &asteroids, int rows, int columns, int fillProbability, unsigned seed,
+				   float firstX, float firstZ, float spacing, float radius, int numThreads)
+{
+   TRACE_SCOPE("generateField");
+   int t;
+   if (numThreads < 1) numThreads = 1;
+   if (numThreads > rows) numThreads = (rows > 0) ? rows : 1;
+   vector<int> firstRow(numThreads + 1), firstId(numThreads + 1, 0);
+   for (t = 0; t <= numThreads; t++)
+      firstRow[t] = (int)((long long)rows * t / numThreads);
+
+   auto countRange = [&](int t)
+   {
+      int count = 0;
+      for (int i = firstRow[t]; i < firstRow[t + 1]; i++)
+	     for (int j = 0; j < columns; j++)
+		    count += isSlotFilled(slotRandom(seed, i, j), fillProbability);
+	  firstId[t + 1] = count;
+   };
+
+   auto setRange = [&](int t)
+   {
+      int id = firstId[t];
+      for (int i = firstRow[t]; i < firstRow[t + 1]; i++)
+	     for (int j = 0; j < columns; j++)
+		 {
+		    unsigned long long bits = slotRandom(seed, i, j);
+			if (isSlotFilled(bits, fillProbability))
+			   asteroids.set(id++, i, j, firstX + j * spacing, 0.0, firstZ - i * spacing, radius,
+			                 slotRed(bits), slotGreen(bits), slotBlue(bits));
+		 }
+   };
+
+   vector<thread> threads;
+   for (t = 1; t < numThreads; t++)
+      threads.push_back(thread(countRange, t));
+   countRange(0);
+   for (t = 0; t < (int)threads.size(); t++)
+      threads[t].join();
+   for (t = 0; t < numThreads; t++)
+      firstId[t + 1] += firstId[t];
+
+   asteroids.reset(columns);
+   asteroids.allocate(firstId[numThreads]);
+
+   threads.clear();
+   for (t = 1; t < numThreads; t++)
+      threads.push_back(thread(setRange, t));
+   setRange(0);
+   for (t = 0; t < (int)threads.size(); t++)
+      threads[t].join();
+}
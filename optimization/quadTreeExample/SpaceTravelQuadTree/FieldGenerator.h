@@ -0,0 +1,35 @@
+#ifndef FieldGenerator_47720
+#define FieldGenerator_47720
+
+#include "AsteroidStore.h"
+
+using namespace std;
+
+// Return 64 random bits for the slot in the given row and column of the field with the given seed.
+// This is a counter-based generator: the bits are a hash of the seed, row and column alone, so a
+// slot comes out the same whatever order, and on whichever thread, the slots are generated in.
+unsigned long long slotRandom(unsigned seed, int row, int column);
+
+// Return 1 if the slot is filled with an asteroid, from the bits of slotRandom, otherwise 0.
+inline int isSlotFilled(unsigned long long bits, int fillProbability) { return (int)(bits % 100) < fillProbability; }
+
+// Color of the slot's asteroid, from the bits of slotRandom.
+inline unsigned char slotRed(unsigned long long bits)   { return (bits >> 8) & 255; }
+inline unsigned char slotGreen(unsigned long long bits) { return (bits >> 16) & 255; }
+inline unsigned char slotBlue(unsigned long long bits)  { return (bits >> 24) & 255; }
+
+// Layout of a field of rows by columns slots, spacing apart, in front of the spacecraft at the
+// origin: the columns are centered on x = 0, so that the spacecraft faces the middle of the field,
+// and the first row is 40 along -z. Set the center of the slot in row 0 and column 0, and the SW
+// corner and side of a square bounding the asteroids of the given radius in any slot.
+void layOutField(int rows, int columns, float spacing, float radius, float &firstX, float &firstZ,
+                 float &squareX, float &squareZ, float &squareSize);
+
+// Fill the store with the asteroids of a field of rows by columns slots: the asteroid of the slot
+// in row i and column j, if filled, is centered at (firstX + j * spacing, 0, firstZ - i * spacing).
+// The rows are split into equal ranges handled by separate threads, up to numThreads of them; the
+// store comes out the same, bit for bit, for any number of threads.
+void generateField(AsteroidStore &asteroids, int rows, int columns, int fillProbability, unsigned seed,
+                   float firstX, float firstZ, float spacing, float radius, int numThreads);
+
+#endif
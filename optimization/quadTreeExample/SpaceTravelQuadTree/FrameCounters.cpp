@@ -0,0 +1,59 @@
+#include <cstdlib>
+#include <cstring>
+#include "FrameCounters.h"
+
+using namespace std;
+
+// Each asteroid is a draw call of its own. With culling off the spacecraft's viewport draws the
+// fixed camera's commands, as drawScene does.
+void countFrame(const FrameCommands &frame, FrameCounters &counters)
+{
+   int k;
+   counters.cullTime = frame.cullTime;
+   counters.nodesVisited = frame.cullStats.nodesVisited;
+   counters.tests = frame.cullStats.tests;
+   for (k = 0; k < FRAME_VIEWPORTS; k++)
+   {
+      int drawn = frame.viewports[frame.view.isFrustumCulled ? k : FIXED_VIEWPORT].size();
+	  counters.asteroidsDrawn[k] = drawn;
+	  counters.drawCalls[k] = drawn;
+	  counters.bytesUploaded[k] = (double)drawn * ASTEROID_DRAW_BYTES;
+   }
+}
+
+CounterAverages::CounterAverages()
+{
+   memset(&sum, 0, sizeof(sum));
+   memset(&averages, 0, sizeof(averages));
+   numFrames = 0;
+}
+
+void CounterAverages::add(const FrameCounters &frame)
+{
+   int k;
+   sum.frameTime += frame.frameTime;
+   sum.cullTime += frame.cullTime;
+   sum.nodesVisited += frame.nodesVisited;
+   sum.tests += frame.tests;
+   for (k = 0; k < FRAME_VIEWPORTS; k++)
+   {
+      sum.asteroidsDrawn[k] += frame.asteroidsDrawn[k];
+	  sum.drawCalls[k] += frame.drawCalls[k];
+	  sum.bytesUploaded[k] += frame.bytesUploaded[k];
+   }
+   numFrames++;
+   if (sum.frameTime < COUNTER_PERIOD) return;
+
+   averages.frameTime = sum.frameTime / numFrames;
+   averages.cullTime = sum.cullTime / numFrames;
+   averages.nodesVisited = sum.nodesVisited / numFrames;
+   averages.tests = sum.tests / numFrames;
+   for (k = 0; k < FRAME_VIEWPORTS; k++)
+   {
+      averages.asteroidsDrawn[k] = sum.asteroidsDrawn[k] / numFrames;
+	  averages.drawCalls[k] = sum.drawCalls[k] / numFrames;
+	  averages.bytesUploaded[k] = sum.bytesUploaded[k] / numFrames;
+   }
+   memset(&sum, 0, sizeof(sum));
+   numFrames = 0;
+}
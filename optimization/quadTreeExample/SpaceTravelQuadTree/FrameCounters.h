@@ -0,0 +1,44 @@
+#ifndef FrameCounters_83410
+#define FrameCounters_83410
+
+#include "FramePipeline.h"
+
+using namespace std;
+
+#define COUNTER_PERIOD 500.0 // Milliseconds of frames the counters shown are averaged over, so
+                             // that they hold still long enough to be read.
+#define ASTEROID_DRAW_BYTES (3 * sizeof(float) + 3) // Bytes handed to GL with the draw call of an
+                                                    // asteroid: its translation and its color.
+
+// Performance counters of a frame. Times are in milliseconds. The counts are whole numbers for a
+// frame, and become averages over the frames of a period.
+struct FrameCounters
+{
+   double frameTime;    // From the start of the frame to the start of the next.
+   double cullTime;     // To cull both viewports and make their commands, on the culling thread.
+   double nodesVisited; // Quadtree squares tested against the frusta.
+   double tests;        // Tests of a square, or an asteroid's bounding square, against a frustum.
+   double asteroidsDrawn[FRAME_VIEWPORTS]; // For each viewport.
+   double drawCalls[FRAME_VIEWPORTS];
+   double bytesUploaded[FRAME_VIEWPORTS];
+};
+
+// Set the counters of the frame from what it drew and what culling it cost; the frame time is
+// left to the caller.
+void countFrame(const FrameCommands &frame, FrameCounters &counters);
+
+// Averages of the counters over the frames of the last COUNTER_PERIOD: the frames are summed as
+// they are added, and once they span the period their averages replace those shown.
+class CounterAverages
+{
+public:
+   CounterAverages();
+   void add(const FrameCounters &frame); // Add the counters of a frame.
+   const FrameCounters &getAverages() { return averages; } // The averages of the last full period.
+
+private:
+   FrameCounters sum, averages;
+   int numFrames; // Frames in sum.
+};
+
+#endif
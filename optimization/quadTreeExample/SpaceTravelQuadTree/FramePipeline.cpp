@@ -0,0 +1,98 @@
+#include <cmath>
+#include <chrono>
+#include "FramePipeline.h"
+#include "Trace.h"
+
+using namespace std;
+
+#define PIPELINE_SPINS 64 // Times the stage is polled, yielding in between, before polls are spaced out.
+
+void viewFrusta(const ViewState &view, Frustum *frusta)
+{
+   Frustum fixed = { -5.0, -5.0, -250.0, -250.0, 250.0, -250.0, 5.0, -5.0 };
+   frusta[FIXED_VIEWPORT] = fixed;
+
+   float sinAnglePlu = sin((PI / 180.0) * (45.0 + view.angle));
+   float cosAnglePlu = cos((PI / 180.0) * (45.0 + view.angle));
+   float sinAngleMin = sin((PI / 180.0) * (45.0 - view.angle));
+   float cosAngleMin = cos((PI / 180.0) * (45.0 - view.angle));
+   Frustum carried = { (float)(view.x - 7.072 * sinAnglePlu), (float)(view.z - 7.072 * cosAnglePlu),
+                       (float)(view.x - 353.6 * sinAnglePlu), (float)(view.z - 353.6 * cosAnglePlu),
+                       (float)(view.x + 353.6 * sinAngleMin), (float)(view.z - 353.6 * cosAngleMin),
+                       (float)(view.x + 7.072 * sinAngleMin), (float)(view.z - 7.072 * cosAngleMin) };
+   frusta[CRAFT_VIEWPORT] = carried;
+}
+
+FramePipeline::FramePipeline()
+{
+   ViewState origin = { 0.0, 0.0, 0.0, 0, 0 };
+   frames[0].view = frames[1].view = origin;
+   for (int i = 0; i < 2; i++)
+   {
+      frames[i].cullTime = 0.0;
+	  frames[i].cullStats.nodesVisited = frames[i].cullStats.tests = 0;
+	  for (int k = 0; k < NUM_NODE_OUTCOMES; k++) frames[i].quadtreeLines.numNodes[k] = 0;
+   }
+   cull = NULL;
+   stage = PIPELINE_IDLE;
+   back = 0;
+}
+
+void FramePipeline::start(void (*cull)(const ViewState &, FrameCommands &))
+{
+   this->cull = cull;
+   stage.store(PIPELINE_IDLE, memory_order_relaxed);
+   worker = thread(&FramePipeline::work, this);
+}
+
+void FramePipeline::stop()
+{
+   if (!worker.joinable()) return;
+   if (stage.load(memory_order_acquire) == PIPELINE_REQUESTED) waitFor(PIPELINE_DONE, PIPELINE_DONE);
+   stage.store(PIPELINE_STOPPING, memory_order_release);
+   worker.join();
+   stage.store(PIPELINE_IDLE, memory_order_relaxed);
+}
+
+void FramePipeline::request(const ViewState &view)
+{
+   frames[back].view = view;
+   stage.store(PIPELINE_REQUESTED, memory_order_release);
+}
+
+const FrameCommands &FramePipeline::collect()
+{
+   TRACE_SCOPE("FramePipeline::collect");
+   if (stage.load(memory_order_acquire) == PIPELINE_IDLE) return frames[1 - back];
+   waitFor(PIPELINE_DONE, PIPELINE_DONE);
+   back = 1 - back;
+   stage.store(PIPELINE_IDLE, memory_order_relaxed);
+   return frames[1 - back];
+}
+
+// The wait is short when the other stage is nearly done, so it spins at first; it then sleeps a
+// little between polls, so an idle worker does not keep a core busy for a whole frame.
+int FramePipeline::waitFor(int first, int second)
+{
+   int spins = 0, value;
+   while ((value = stage.load(memory_order_acquire)) != first && value != second)
+   {
+      if (spins < PIPELINE_SPINS)
+	  {
+	     spins++;
+		 this_thread::yield();
+	  }
+	  else this_thread::sleep_for(chrono::microseconds(100));
+   }
+   return value;
+}
+
+void FramePipeline::work()
+{
+   nameTraceThread("Frame pipeline");
+   while (waitFor(PIPELINE_REQUESTED, PIPELINE_STOPPING) == PIPELINE_REQUESTED)
+   {
+	  cull(frames[back].view, frames[back]);
+	  stage.store(PIPELINE_DONE, memory_order_release);
+   }
+}
@@ -0,0 +1,78 @@
+#ifndef FramePipeline_29561
+#define FramePipeline_29561
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include "AsteroidStore.h"
+#include "QuadTree.h"
+#include "QuadtreeView.h"
+
+using namespace std;
+
+// State a frame is drawn from: the spacecraft, as drawn, whether frustum culling is on and whether
+// the debug view of the culling is shown.
+struct ViewState
+{
+   float x, z, angle;
+   int isFrustumCulled;
+   int isQuadtreeShown;
+};
+
+#define FRAME_VIEWPORTS 2 // Viewports of a frame, each with a camera and frustum of its own:
+#define FIXED_VIEWPORT 0  // the left, with the fixed camera,
+#define CRAFT_VIEWPORT 1  // and the right, with the spacecraft's.
+
+// What the culling stage hands the drawing stage for a frame: the view it was culled for, the
+// asteroids to draw in each viewport, what culling them cost, and the lines of the debug view.
+struct FrameCommands
+{
+   ViewState view;
+   vector<AsteroidDrawCommand> viewports[FRAME_VIEWPORTS];
+   double cullTime;     // Milliseconds to cull both viewports and make their commands.
+   CullStats cullStats; // Work of the culling, over both viewports' frusta.
+   QuadtreeLines quadtreeLines; // None unless the view shows them and the quadtree culled the frame.
+};
+
+// Set frusta[k] to the frustum of viewport k for the view: for the fixed camera the frustum with 
+// apex at the origin, and for the spacecraft's the frustum "carried" by the spacecraft with apex at
+// its tip and oriented with its axis along the spacecraft's axis.
+void viewFrusta(const ViewState &view, Frustum *frusta);
+
+// Two-stage frame pipeline: a worker thread culls the asteroid field for the next frame while the
+// calling thread draws the current one, so the culling is off the drawing thread's critical path
+// at the cost of a frame of latency. There are two FrameCommands, one being drawn and the other
+// being filled; they change roles when the drawing thread collects a finished frame. Handoff is 
+// by a single atomic stage, with no lock: the drawing thread writes the view and releases the
+// buffer to the worker by setting the stage, and the worker releases it back the same way.
+// Between collecting a frame and requesting the next the worker is idle, and the drawing thread
+// may change anything the culling reads.
+class FramePipeline
+{
+public:
+   FramePipeline(); // An empty frame, with the spacecraft at the origin, is collected before any is requested.
+   ~FramePipeline() { stop(); }
+   void start(void (*cull)(const ViewState &, FrameCommands &)); // Start the worker, which culls with cull.
+   void stop(); // Wait for the frame in hand, if any, and stop the worker.
+
+   void request(const ViewState &view); // Have the worker cull for the view; the last frame requested
+                                        // must have been collected.
+   const FrameCommands &collect(); // Wait for the frame requested last, if not collected, and return
+                                   // it; it is left alone until the next collect.
+   int isRunning() { return worker.joinable(); }
+
+private:
+   enum { PIPELINE_IDLE, PIPELINE_REQUESTED, PIPELINE_DONE, PIPELINE_STOPPING };
+
+   void work(); // Loop of the worker thread.
+   int waitFor(int first, int second); // Wait, on the drawing thread or the worker, until the stage is
+                                       // first or second, and return it.
+
+   void (*cull)(const ViewState &, FrameCommands &);
+   atomic<int> stage;       // Owner of frames[back]: the worker while PIPELINE_REQUESTED, the drawing thread otherwise.
+   FrameCommands frames[2]; // Double buffer: frames[back] is filled, frames[1 - back] drawn.
+   int back;
+   thread worker;
+};
+
+#endif
@@ -0,0 +1,45 @@
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <thread>
+#include "Gravity.h"
+
+using namespace std;
+
+// Return the gravitational acceleration at each of the n positions due to n bodies at the same
+// positions with the given masses, by summing over all pairs; the softening length makes the term
+// of a body on itself vanish. The positions are split into equal ranges handled by separate threads.
+void computeAccelerationsDirect(const glm::vec3 *positions, const float *masses, int n, float G, 
+								float softening, glm::vec3 *accelerations, int numThreads)
+{
+   int t;
+   if (numThreads < 1) numThreads = 1;
+   if (numThreads > n) numThreads = (n > 0) ? n : 1;
+
+   auto accelerateRange = [=](int begin, int end)
+   {
+      for (int i = begin; i < end; i++)
+	  {
+	     glm::vec3 sum(0.0);
+		 for (int j = 0; j < n; j++)
+		 {
+		    glm::vec3 offset = positions[j] - positions[i];
+			float distanceSquared = glm::dot(offset, offset) + softening * softening;
+			sum += (G * masses[j] / (distanceSquared * sqrt(distanceSquared))) * offset;
+		 }
+		 accelerations[i] = sum;
+	  }
+   };
+
+   if (numThreads == 1)
+   {
+      accelerateRange(0, n);
+	  return;
+   }
+
+   vector<thread> threads;
+   for (t = 0; t < numThreads; t++)
+      threads.push_back(thread(accelerateRange, (int)((long long)n * t / numThreads), (int)((long long)n * (t + 1) / numThreads)));
+   for (t = 0; t < numThreads; t++)
+      threads[t].join();
+}
@@ -0,0 +1,20 @@
+#ifndef Gravity_48213
+#define Gravity_48213
+
+#include <glm/glm.hpp>
+
+#define GRAVITY_CONSTANT 0.01 // Gravitational constant, in the units of the asteroid field and frames.
+#define GRAVITY_SOFTENING 3.0 // Softening length keeping the force between close asteroids finite.
+#define BARNES_HUT_THETA 0.5  // Opening angle of the Barnes-Hut approximation.
+
+// Gravity modes for the drifting asteroids.
+#define GRAVITY_OFF 0
+#define GRAVITY_BARNES_HUT 1 // Quadtree approximation, O(N log N).
+#define GRAVITY_DIRECT 2     // Exact pairwise sum, O(N^2), for checking the accuracy of the approximation.
+
+// Return the gravitational acceleration at each of the n positions due to n bodies at the same
+// positions with the given masses, by summing over all pairs; computed by up to numThreads threads.
+void computeAccelerationsDirect(const glm::vec3 *positions, const float *masses, int n, float G, 
+								float softening, glm::vec3 *accelerations, int numThreads);
+
+#endif
@@ -0,0 +1,104 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include "InputRecording.h"
+
+using namespace std;
+
+static const char RECORDING_MAGIC[8] = "ASTINPT";
+
+void InputRecording::record(int tick, const InputEvent &event)
+{
+   RecordedInput input;
+   input.tick = tick;
+   input.key = (short)event.key;
+   input.action = (short)event.action;
+   events.push_back(input);
+}
+
+int InputRecording::save(const char *fileName, const Config &config)
+{
+   RecordingHeader header;
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, RECORDING_MAGIC, sizeof(header.magic));
+   header.version = RECORDING_VERSION;
+   header.rows = config.rows; header.columns = config.columns; header.fillProbability = config.fillProbability;
+   header.spacing = config.spacing; header.seed = config.seed;
+   header.isStreamed = config.isStreamed; header.gravityMode = config.gravityMode;
+   header.numTicks = numTicks;
+   header.numEvents = events.size();
+
+   ofstream out(fileName, ios::binary | ios::trunc);
+   if (!out)
+   {
+      cerr << "Cannot create recording file " << fileName << "." << endl;
+	  return 0;
+   }
+   out.write((const char *)&header, sizeof(header));
+   if (!events.empty()) out.write((const char *)events.data(), events.size() * sizeof(RecordedInput));
+   out.close();
+   if (!out)
+   {
+      cerr << "Cannot write recording file " << fileName << "." << endl;
+	  return 0;
+   }
+   return 1;
+}
+
+// The events must be in the order of their ticks, as recorded, for replay to find them in turn.
+int InputRecording::load(const char *fileName, Config &config)
+{
+   RecordingHeader header;
+   int i;
+
+   ifstream in(fileName, ios::binary);
+   if (!in)
+   {
+      cerr << "Cannot open recording file " << fileName << "." << endl;
+	  return 0;
+   }
+   if (!in.read((char *)&header, sizeof(header)) || memcmp(header.magic, RECORDING_MAGIC, sizeof(header.magic)) != 0)
+   {
+      cerr << fileName << " is not a recording." << endl;
+	  return 0;
+   }
+   if (header.version != RECORDING_VERSION)
+   {
+      cerr << "The recording " << fileName << " is of version " << header.version << ", not " << RECORDING_VERSION << "." << endl;
+	  return 0;
+   }
+   if (header.numTicks < 0 || header.numEvents < 0)
+   {
+      cerr << "The recording " << fileName << " is damaged." << endl;
+	  return 0;
+   }
+   events.resize(header.numEvents);
+   if (header.numEvents > 0 && !in.read((char *)events.data(), events.size() * sizeof(RecordedInput)))
+   {
+      cerr << "The recording " << fileName << " is cut short." << endl;
+	  return 0;
+   }
+   for (i = 0; i < header.numEvents; i++)
+      if (events[i].tick < 0 || events[i].tick >= header.numTicks || (i > 0 && events[i].tick < events[i-1].tick))
+	  {
+	     cerr << "The recording " << fileName << " is damaged." << endl;
+		 return 0;
+	  }
+
+   config.rows = header.rows; config.columns = header.columns; config.fillProbability = header.fillProbability;
+   config.spacing = header.spacing; config.seed = header.seed;
+   config.isStreamed = header.isStreamed; config.gravityMode = header.gravityMode;
+   numTicks = header.numTicks;
+   next = 0;
+   return 1;
+}
+
+void InputRecording::replay(int tick, InputQueue &queue)
+{
+   while (next < (int)events.size() && events[next].tick <= tick)
+   {
+      queue.push(events[next].key, events[next].action);
+	  next++;
+   }
+}
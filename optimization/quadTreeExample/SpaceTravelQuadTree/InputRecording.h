@@ -0,0 +1,65 @@
+#ifndef InputRecording_48203
+#define InputRecording_48203
+
+#include <vector>
+#include "Config.h"
+#include "Simulation.h"
+
+using namespace std;
+
+#define RECORDING_VERSION 1
+
+// Header at the start of a recording file, followed by numEvents RecordedInputs in the order they
+// were applied. The settings of the field are recorded with the events, the seed among them, so
+// that a replay flies the same field as was recorded.
+struct RecordingHeader
+{
+   char magic[8];        // "ASTINPT" and a zero byte.
+   unsigned int version; // RECORDING_VERSION of the writer.
+   int rows, columns, fillProbability; // Settings the field was generated with.
+   float spacing;
+   unsigned seed;
+   int isStreamed;
+   int gravityMode;      // Gravity at the start.
+   int numTicks;         // Ticks simulated while recording.
+   int numEvents;
+};
+
+// Key event as applied by the simulation, stamped with the tick it was applied at.
+struct RecordedInput
+{
+   int tick;
+   short key;
+   short action;
+};
+
+// The key events of a run of the simulation, recorded tick by tick as they are applied, to be
+// written to a file and replayed: fed back at the same ticks, they fly the spacecraft the same way
+// however fast or slow the frames are drawn.
+class InputRecording
+{
+public:
+   InputRecording() { numTicks = 0; next = 0; }
+   void record(int tick, const InputEvent &event); // Add an event applied at the tick.
+   void setNumTicks(int numTicks) { this->numTicks = numTicks; }
+   int getNumTicks() { return numTicks; }
+   int numberEvents() { return events.size(); }
+
+   int save(const char *fileName, const Config &config); // Write the events and the settings of the
+                                                         // field to the file; return 1 if done, or
+                                                         // report the problem and return 0.
+   int load(const char *fileName, Config &config); // Read a recording from the file and set the
+                                                   // settings of the field in config from it;
+                                                   // return 1 if done, or report the problem and
+                                                   // return 0.
+   void replay(int tick, InputQueue &queue); // Queue the events recorded at the tick; ticks must be
+                                             // replayed in order from 0.
+   int isFinished(int tick) { return tick >= numTicks; } // Return 1 if the tick is past the recording.
+
+private:
+   vector<RecordedInput> events;
+   int numTicks;
+   int next; // First event not yet replayed.
+};
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef Meshes_38164
+#define Meshes_38164
+
+// Vertex data of the sphere every asteroid is drawn with and of the cone the spacecraft is drawn
+// with, computed at compile time: a mesh declared constexpr is a table in the executable, so
+// nothing is computed, and no table of sines or cosines filled in, when the program starts.
+// The meshes are templated on their tessellation, and each level of detail of the sphere is a
+// tessellation of its own.
+
+#define MESH_PI 3.14159265358979323846
+
+// A vertex laid out as a glm::vec3, three floats.
+struct MeshVertex
+{
+   float x, y, z;
+};
+
+// Sine and cosine of an angle in degrees, usable in constant expressions: the angle is reduced
+// to within 180 degrees of 0 and the Taylor series summed until its terms no longer count.
+constexpr double meshSin(double degrees)
+{
+   while (degrees > 180.0) degrees -= 360.0;
+   while (degrees < -180.0) degrees += 360.0;
+   double x = degrees / 180.0 * MESH_PI, term = x, sum = x;
+   for (int k = 1; k < 30; k++)
+   {
+      term *= -x * x / ((2 * k) * (2 * k + 1));
+	  sum += term;
+   }
+   return sum;
+}
+
+constexpr double meshCos(double degrees) { return meshSin(degrees + 90.0); }
+
+// Sphere of the given radius centered at the origin, with the angles around and down from the
+// pole stepping STEP degrees, STEP dividing 90: for each step a quad of four vertices, first for
+// the front half (z >= 0) and then mirrored for the back half, drawn as one triangle fan.
+// Derived from the tutorial at http://www.swiftless.com/tutorials/opengl/sphere.html
+template <int STEP>
+struct SphereMesh
+{
+   static_assert(STEP > 0 && 90 % STEP == 0, "The step of a sphere must divide 90 degrees.");
+   static const int VERTEX_COUNT = 2 * 4 * (90 / STEP) * (360 / STEP);
+
+   constexpr SphereMesh(double R) : vertices()
+   {
+      int n = 0;
+	  for (int half = 0; half < 2; half++)
+	  {
+	     double sign = half ? -1.0 : 1.0;
+         for (int b = 0; b <= 90 - STEP; b += STEP)
+		    for (int a = 0; a <= 360 - STEP; a += STEP)
+			{
+			   int aCorner[4] = { a, a, a + STEP, a + STEP }, bCorner[4] = { b, b + STEP, b, b + STEP };
+			   for (int k = 0; k < 4; k++)
+			   {
+			      vertices[n].x = (float)(R * meshSin(aCorner[k]) * meshSin(bCorner[k]));
+				  vertices[n].y = (float)(R * meshCos(aCorner[k]) * meshSin(bCorner[k]));
+				  vertices[n].z = (float)(sign * R * meshCos(bCorner[k]));
+				  n++;
+			   }
+			}
+	  }
+   }
+
+   MeshVertex vertices[VERTEX_COUNT];
+};
+
+// Levels of detail of the sphere, from the finest, level 0, to the coarsest.
+#define SPHERE_LOD_COUNT 3
+template <int LEVEL>
+struct SphereLod
+{
+   static_assert(LEVEL >= 0 && LEVEL < SPHERE_LOD_COUNT, "No such level of detail of the sphere.");
+   typedef SphereMesh<LEVEL == 0 ? 30 : LEVEL == 1 ? 45 : 90> Mesh;
+};
+
+// Cone with its apex at (0, height, 0) and its base a circle of the given radius around the
+// origin in the plane y = 0, its rim divided into SIDES: the apex and the rim, closed, drawn as
+// one triangle fan. The base is left open, as the cone is the spacecraft.
+// Derived from the tutorial at http://www.freemancw.com/2012/06/opengl-cone-function/
+template <int SIDES>
+struct ConeMesh
+{
+   static_assert(SIDES >= 3, "A cone needs at least three sides.");
+   static const int VERTEX_COUNT = SIDES + 2;
+
+   constexpr ConeMesh(double height, double radius) : vertices()
+   {
+      // The rim runs from -z towards +x, as the tutorial's perpendiculars to the axis give.
+      vertices[0].x = 0.0f; vertices[0].y = (float)height; vertices[0].z = 0.0f;
+	  for (int i = 0; i <= SIDES; i++)
+	  {
+	     double degrees = 360.0 / SIDES * (i % SIDES);
+		 vertices[i + 1].x = (float)(radius * meshSin(degrees));
+		 vertices[i + 1].y = 0.0f;
+		 vertices[i + 1].z = (float)(-radius * meshCos(degrees));
+	  }
+   }
+
+   MeshVertex vertices[VERTEX_COUNT];
+};
+
+#endif
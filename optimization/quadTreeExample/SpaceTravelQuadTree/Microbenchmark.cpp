@@ -0,0 +1,527 @@
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <fstream>
+#include "Microbenchmark.h"
+#include "intersectionDetectionRoutines.h"
+#include "Benchmark.h"
+#include "FramePipeline.h"
+
+using namespace std;
+
+#define MAX_INPUT_FLOATS 16 // Arguments of the routine with the most, checkQuadrilateralsIntersection.
+
+// The arguments of a call, whichever the routine.
+struct IntersectionInput
+{
+   float v[MAX_INPUT_FLOATS];
+};
+
+// Each routine is called through one of these, with the arguments of an input in order, so that
+// all are timed the same way.
+typedef int (*IntersectionRoutine)(const float *v);
+
+static int segments(const float *v)
+{
+   return checkSegmentsIntersection(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]);
+}
+
+static int pointInQuadrilateral(const float *v)
+{
+   return checkPointInQuadrilateral(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8], v[9]);
+}
+
+static int quadrilaterals(const float *v)
+{
+   return checkQuadrilateralsIntersection(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7],
+										  v[8], v[9], v[10], v[11], v[12], v[13], v[14], v[15]);
+}
+
+static int discRectangle(const float *v)
+{
+   return checkDiscRectangleIntersection(v[0], v[1], v[2], v[3], v[4], v[5], v[6]);
+}
+
+// A quadrilateral, v[0] to v[7], and an axes-parallel rectangle with diagonally opposite corners
+// (v[8],v[9]) and (v[10],v[11]), as Quadtree::cullSquare tests a frustum against a square: first
+// by the original routines, with the rectangle as a quadrilateral and its corners as points ...
+static int quadrilateralRectangle(const float *v)
+{
+   return checkQuadrilateralsIntersection(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7],
+										  v[8], v[9], v[8], v[11], v[10], v[11], v[10], v[9]);
+}
+
+static int rectangleInQuadrilateral(const float *v)
+{
+   return checkPointInQuadrilateral(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8], v[9]) &&
+	      checkPointInQuadrilateral(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8], v[11]) &&
+	      checkPointInQuadrilateral(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[10], v[11]) &&
+	      checkPointInQuadrilateral(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[10], v[9]);
+}
+
+// ... and then by the accelerated one that stands in for the first.
+static int convexQuadrilateralRectangle(const float *v)
+{
+   return checkConvexQuadrilateralRectangleIntersection(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7],
+													    v[8], v[9], v[10], v[11]);
+}
+
+// What the inputs of a routine are.
+enum InputShape { SEGMENTS, POINT_QUADRILATERAL, QUADRILATERALS, DISC_RECTANGLE, QUADRILATERAL_RECTANGLE };
+
+// A routine to time, with the routine it stands in for if it is an accelerated one.
+struct TimedRoutine
+{
+   const char *name;
+   IntersectionRoutine routine;
+   InputShape shape;
+   const char *referenceName; // NULL for an original routine.
+   IntersectionRoutine reference;
+};
+
+static const TimedRoutine timedRoutines[] =
+{
+   { "checkSegmentsIntersection", segments, SEGMENTS, NULL, NULL },
+   { "checkPointInQuadrilateral", pointInQuadrilateral, POINT_QUADRILATERAL, NULL, NULL },
+   { "checkQuadrilateralsIntersection", quadrilaterals, QUADRILATERALS, NULL, NULL },
+   { "checkDiscRectangleIntersection", discRectangle, DISC_RECTANGLE, NULL, NULL },
+   { "checkQuadrilateralsIntersection/rectangle", quadrilateralRectangle, QUADRILATERAL_RECTANGLE, NULL, NULL },
+   { "checkConvexQuadrilateralRectangleIntersection", convexQuadrilateralRectangle, QUADRILATERAL_RECTANGLE,
+     "checkQuadrilateralsIntersection/rectangle", quadrilateralRectangle },
+   { "checkPointInQuadrilateral/4 corners", rectangleInQuadrilateral, QUADRILATERAL_RECTANGLE, NULL, NULL }
+};
+
+static const char *inputSetNames[] = { "random", "collinear", "degenerate", "touching", "frusta" };
+#define NUM_INPUT_SETS 5
+#define DEGENERATE_SET 2 // The originals' answers on shapes of no length or area are their own, not
+                         // those of the general tests, so an accelerated routine may differ on these.
+#define FRUSTA_SET 4 // Only the frustum and square tests have inputs of this set.
+
+// Makes the inputs: co-ordinates at random, and shapes in whole numbers, which the routines
+// handle exactly, so that inputs made to touch do touch.
+class InputMaker
+{
+public:
+   InputMaker(unsigned seed) : generator(seed) {}
+
+   float coordinate() { return uniform_real_distribution<float>(-MICROBENCHMARK_EXTENT, MICROBENCHMARK_EXTENT)(generator); }
+   int whole(int low, int high) { return uniform_int_distribution<int>(low, high)(generator); }
+   int chance(int percent) { return whole(1, 100) <= percent; }
+
+   // A convex quadrilateral at random, in v[0] to v[7]: four points on a circle about a random
+   // center, in order round it one way or the other.
+   void convexQuadrilateral(float *v)
+   {
+      float cx = coordinate(), cy = coordinate(), r = fabs(coordinate()) / 2 + 1, angles[4], temp;
+	  int i, j;
+	  for (i = 0; i < 4; i++) angles[i] = uniform_real_distribution<float>(0.0, 2.0 * PI)(generator);
+	  for (i = 0; i < 4; i++)
+	     for (j = i + 1; j < 4; j++)
+		    if (angles[j] < angles[i]) { temp = angles[i]; angles[i] = angles[j]; angles[j] = temp; }
+	  if (chance(50)) { temp = angles[1]; angles[1] = angles[3]; angles[3] = temp; }
+	  for (i = 0; i < 4; i++)
+	  {
+	     v[2*i] = cx + r * cos(angles[i]);
+		 v[2*i+1] = cy + r * sin(angles[i]);
+	  }
+   }
+
+   // A convex quadrilateral in whole numbers, in v[0] to v[7]: a trapezoid, with its parallel sides
+   // along x or along y, and its vertices in order one way round or the other.
+   void wholeTrapezoid(float *v)
+   {
+      int bottom = whole(-20, 10), top = bottom + whole(1, 10);
+	  int left = whole(-20, 10), right = left + whole(1, 10);
+	  int topLeft = left + whole(-5, 5), topRight = topLeft + whole(1, 10);
+	  float p[8] = { (float)left, (float)bottom, (float)right, (float)bottom,
+		             (float)topRight, (float)top, (float)topLeft, (float)top };
+	  int i, isSwapped = chance(50), isReversed = chance(50);
+	  for (i = 0; i < 4; i++)
+	  {
+	     int j = isReversed ? 3 - i : i;
+		 v[2*i] = isSwapped ? p[2*j+1] : p[2*j];
+		 v[2*i+1] = isSwapped ? p[2*j] : p[2*j+1];
+	  }
+   }
+
+   // Four whole-number points on a line in v[0] to v[7], at the given steps along it from a point of it.
+   void collinearPoints(float *v, int t1, int t2, int t3, int t4)
+   {
+      int x = whole(-20, 20), y = whole(-20, 20), dx = whole(-3, 3), dy = whole(-3, 3);
+	  int t[4] = { t1, t2, t3, t4 }, i;
+	  if (dx == 0 && dy == 0) dx = 1;
+	  for (i = 0; i < 4; i++)
+	  {
+	     v[2*i] = (float)(x + t[i] * dx);
+		 v[2*i+1] = (float)(y + t[i] * dy);
+	  }
+   }
+
+   void make(InputShape shape, int set, IntersectionInput &input);
+
+private:
+   mt19937 generator;
+   vector<ViewState> flight; // The scripted flight, for the frusta.
+};
+
+void InputMaker::make(InputShape shape, int set, IntersectionInput &input)
+{
+   float *v = input.v, quad[8];
+   int i, k;
+
+   switch (shape)
+   {
+   case SEGMENTS:
+      if (set == 0) for (i = 0; i < 8; i++) v[i] = coordinate();
+	  else if (set == 1) // Two segments on a line, overlapping, end to end or apart.
+	     collinearPoints(v, whole(-5, 5), whole(-5, 5), whole(-5, 5), whole(-5, 5));
+	  else if (set == 2) // A segment of no length, on the other, on its line or off it, or both of no length.
+	  {
+	     k = whole(0, 2);
+		 collinearPoints(v, 0, 0, whole(-5, 5), (k == 2) ? 0 : whole(-5, 5));
+		 if (k == 1) { v[0] += whole(1, 3); v[2] = v[0]; }
+	  }
+	  else // Segments meeting at an end: end to end, or the end of one on the other.
+	  {
+	     collinearPoints(v, whole(-5, -1), whole(1, 5), 0, 0);
+		 k = chance(50) ? 0 : whole(1, 3);
+		 v[4] = v[0] + (v[2] - v[0]) * k / 4;
+		 v[5] = v[1] + (v[3] - v[1]) * k / 4;
+		 v[6] = (float)whole(-20, 20); v[7] = (float)whole(-20, 20);
+	  }
+	  break;
+
+   case POINT_QUADRILATERAL:
+      if (set == 0)
+	  {
+	     convexQuadrilateral(v);
+		 v[8] = coordinate(); v[9] = coordinate();
+		 if (chance(50)) { v[8] = (v[0] + v[4]) / 2 + coordinate() / 10; v[9] = (v[1] + v[5]) / 2 + coordinate() / 10; }
+	  }
+	  else if (set == 1) // The point on the line of a side, in it or beyond its ends.
+	  {
+	     wholeTrapezoid(v);
+		 k = 2 * whole(0, 3);
+		 float t = whole(-4, 8) / 4.0;
+		 v[8] = v[k] + t * (v[(k+2) % 8] - v[k]);
+		 v[9] = v[k+1] + t * (v[(k+3) % 8] - v[k+1]);
+	  }
+	  else if (set == 2) // A quadrilateral of no area, or with two vertices the same.
+	  {
+	     if (chance(50)) collinearPoints(v, whole(-5, 5), whole(-5, 5), whole(-5, 5), whole(-5, 5));
+		 else
+		 {
+		    wholeTrapezoid(v);
+			k = 2 * whole(0, 3);
+			v[(k+2) % 8] = v[k]; v[(k+3) % 8] = v[k+1];
+		 }
+		 k = 2 * whole(0, 3);
+		 v[8] = v[k] + whole(-1, 1); v[9] = v[k+1] + whole(-1, 1);
+	  }
+	  else // The point at a vertex.
+	  {
+	     wholeTrapezoid(v);
+		 k = 2 * whole(0, 3);
+		 v[8] = v[k]; v[9] = v[k+1];
+	  }
+	  break;
+
+   case QUADRILATERALS:
+      if (set == 0)
+	  {
+	     convexQuadrilateral(v);
+		 convexQuadrilateral(v + 8);
+	  }
+	  else if (set == 1) // The second a copy of the first slid along the line of one of its sides.
+	  {
+	     wholeTrapezoid(v);
+		 k = 2 * whole(0, 3);
+		 float t = whole(-6, 6) / 2.0;
+		 for (i = 0; i < 4; i++)
+		 {
+		    v[8+2*i] = v[2*i] + t * (v[(k+2) % 8] - v[k]);
+			v[9+2*i] = v[2*i+1] + t * (v[(k+3) % 8] - v[k+1]);
+		 }
+	  }
+	  else if (set == 2) // Either of no area.
+	  {
+	     k = chance(50) ? 0 : 8;
+		 collinearPoints(v + k, whole(-5, 5), whole(-5, 5), whole(-5, 5), whole(-5, 5));
+		 wholeTrapezoid(v + 8 - k);
+	  }
+	  else // The second moved so that one of its vertices is on one of the first's.
+	  {
+	     wholeTrapezoid(v);
+		 wholeTrapezoid(v + 8);
+		 k = 2 * whole(0, 3);
+		 int j = 8 + 2 * whole(0, 3);
+		 float dx = v[k] - v[j], dy = v[k+1] - v[j+1];
+		 for (i = 8; i < 16; i += 2) { v[i] += dx; v[i+1] += dy; }
+	  }
+	  break;
+
+   case DISC_RECTANGLE:
+      if (set == 0)
+	  {
+	     for (i = 0; i < 6; i++) v[i] = coordinate();
+		 v[6] = fabs(coordinate()) / 4;
+	  }
+	  else
+	  {
+	     int left = whole(-20, 10), bottom = whole(-20, 10), right = left + whole(1, 10), top = bottom + whole(1, 10);
+		 int scale = whole(1, 3);
+		 v[0] = left; v[1] = bottom; v[2] = right; v[3] = top;
+		 if (set == 2) // A rectangle of no width, height or either, or a disc of no radius.
+		 {
+		    if (chance(50)) v[2] = v[0];
+			if (chance(50)) v[3] = v[1];
+			v[4] = whole(-20, 20); v[5] = whole(-20, 20); v[6] = chance(50) ? 0 : whole(0, 5);
+			if (chance(50)) { v[4] = v[0]; v[5] = v[1]; }
+		 }
+		 else if (set == 1) // The center on the line of a side, beyond a corner, the radius reaching it or not.
+		 {
+		    v[4] = right + 5 * scale; v[5] = top; v[6] = 5 * scale + whole(-1, 1);
+		 }
+		 else // The disc touching a side, or a corner, the 3, 4, 5 triangle making the distance exact.
+		 {
+		    if (chance(50)) { v[4] = right + 5 * scale; v[5] = whole(bottom, top); }
+			else { v[4] = right + 3 * scale; v[5] = top + 4 * scale; }
+			v[6] = 5 * scale;
+		 }
+		 if (chance(50)) { float temp = v[0]; v[0] = v[2]; v[2] = temp; }
+	  }
+	  break;
+
+   case QUADRILATERAL_RECTANGLE:
+      if (set == 0)
+	  {
+	     convexQuadrilateral(v);
+		 v[8] = coordinate(); v[9] = coordinate();
+		 v[10] = v[8] + coordinate() / 4; v[11] = v[9] + coordinate() / 4;
+	  }
+	  else if (set == FRUSTA_SET) // A frustum of the scripted flight and a square of the quadtree near it.
+	  {
+	     Frustum frusta[FRAME_VIEWPORTS];
+		 if (flight.empty()) scriptedFlight(BENCHMARK_WEAVE_FRAMES, flight);
+		 const ViewState &view = flight[whole(0, BENCHMARK_WEAVE_FRAMES - 1)];
+		 viewFrusta(view, frusta);
+		 const Frustum &f = frusta[whole(0, FRAME_VIEWPORTS - 1)];
+		 float size = 30.0 * (1 << whole(0, 6));
+		 v[0] = f.x1; v[1] = f.z1; v[2] = f.x2; v[3] = f.z2; v[4] = f.x3; v[5] = f.z3; v[6] = f.x4; v[7] = f.z4;
+		 v[8] = size * floor((view.x + 4 * coordinate()) / size);
+		 v[9] = size * floor((view.z + 4 * coordinate()) / size);
+		 v[10] = v[8] + size; v[11] = v[9] - size;
+	  }
+	  else
+	  {
+	     int left = whole(-20, 10), bottom = whole(-20, 10), right = left + whole(1, 10), top = bottom + whole(1, 10);
+		 wholeTrapezoid(quad);
+		 if (set == 2 && chance(50)) collinearPoints(quad, whole(-5, 5), whole(-5, 5), whole(-5, 5), whole(-5, 5));
+		 for (i = 0; i < 8; i++) v[i] = quad[i];
+		 if (set == 1) // The rectangle with a side on the line of a side of the quadrilateral.
+		 {
+		    do k = 2 * whole(0, 3); while (v[k] != v[(k+2) % 8] && v[k+1] != v[(k+3) % 8]);
+			if (v[k] == v[(k+2) % 8]) { left = v[k] - (chance(50) ? 0 : right - left); right = left + whole(1, 10); }
+			else { bottom = v[k+1] - (chance(50) ? 0 : top - bottom); top = bottom + whole(1, 10); }
+		 }
+		 else if (set == 2) // The rectangle of no width or height, and maybe the quadrilateral of no area.
+		 {
+		    if (chance(50)) right = left;
+			if (chance(50)) top = bottom;
+		 }
+		 else // A corner of the rectangle on a vertex of the quadrilateral.
+		 {
+		    k = 2 * whole(0, 3);
+			int width = right - left, height = top - bottom;
+			left = v[k] - (chance(50) ? width : 0); right = left + width;
+			bottom = v[k+1] - (chance(50) ? height : 0); top = bottom + height;
+		 }
+		 v[8] = left; v[9] = bottom; v[10] = right; v[11] = top;
+		 if (chance(50)) { v[8] = right; v[10] = left; }
+	  }
+	  break;
+   }
+}
+
+// Return the milliseconds since start.
+static double millisecondsSince(chrono::steady_clock::time_point start)
+{
+   return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+static volatile int answers; // Where the answers go, so that the calls are not optimized away.
+
+// Call the routine on all the inputs, over and over until MICROBENCHMARK_MIN_TIME has gone by.
+static void timeRoutine(IntersectionRoutine routine, const vector<IntersectionInput> &inputs, MicrobenchmarkResult &result)
+{
+   chrono::steady_clock::time_point start = chrono::steady_clock::now();
+   double elapsed;
+   int i, sum = 0;
+
+   result.numCalls = 0;
+   do
+   {
+      for (i = 0; i < (int)inputs.size(); i++) sum += routine(inputs[i].v);
+	  result.numCalls += inputs.size();
+	  elapsed = millisecondsSince(start);
+   } while (elapsed < MICROBENCHMARK_MIN_TIME);
+   answers = sum;
+   result.nsPerCall = elapsed * 1e6 / result.numCalls;
+}
+
+static int numberArguments(InputShape shape)
+{
+   switch (shape)
+   {
+   case SEGMENTS: return 8;
+   case POINT_QUADRILATERAL: return 10;
+   case QUADRILATERALS: return 16;
+   case DISC_RECTANGLE: return 7;
+   default: return 12;
+   }
+}
+
+// The inputs of each set are made again for each routine, from a seed of the set and the shape, so
+// that an accelerated routine has the same inputs as its reference.
+void runMicrobenchmarks(int numInputs, unsigned seed, MicrobenchmarkReport &report)
+{
+   int r, set, i, j;
+   vector<IntersectionInput> inputs(numInputs);
+
+   report.seed = seed;
+   report.numInputs = numInputs;
+   report.results.clear();
+   for (r = 0; r < (int)(sizeof(timedRoutines) / sizeof(timedRoutines[0])); r++)
+   {
+      const TimedRoutine &timed = timedRoutines[r];
+	  for (set = 0; set < NUM_INPUT_SETS; set++)
+	  {
+	     if (set == FRUSTA_SET && timed.shape != QUADRILATERAL_RECTANGLE) continue;
+		 MicrobenchmarkResult result;
+		 InputMaker maker(seed + 7919 * timed.shape + set);
+		 for (i = 0; i < numInputs; i++) maker.make(timed.shape, set, inputs[i]);
+
+		 result.routine = timed.name;
+		 result.inputs = inputSetNames[set];
+		 result.reference = (timed.referenceName != NULL) ? timed.referenceName : "";
+		 result.numInputs = numInputs;
+		 result.numMismatches = 0;
+		 result.firstMismatch = -1;
+		 int numTrue = 0;
+		 for (i = 0; i < numInputs; i++)
+		 {
+		    int answer = timed.routine(inputs[i].v);
+			numTrue += answer;
+			if (timed.reference != NULL && answer != timed.reference(inputs[i].v))
+			{
+			   if (result.numMismatches++ == 0)
+			   {
+			      result.firstMismatch = i;
+				  cerr << timed.name << " differs from " << timed.referenceName << " on " << result.inputs << " input " << i
+					   << ", answering " << answer << " to";
+				  for (j = 0; j < numberArguments(timed.shape); j++) cerr << " " << inputs[i].v[j];
+				  cerr << endl;
+			   }
+			}
+		 }
+		 result.trueFraction = numInputs > 0 ? (double)numTrue / numInputs : 0.0;
+		 timeRoutine(timed.routine, inputs, result);
+		 report.results.push_back(result);
+	  }
+   }
+}
+
+int numberMismatches(const MicrobenchmarkReport &report)
+{
+   int i, sum = 0;
+   for (i = 0; i < (int)report.results.size(); i++)
+      if (report.results[i].inputs != inputSetNames[DEGENERATE_SET]) sum += report.results[i].numMismatches;
+   return sum;
+}
+
+int numberDegenerateMismatches(const MicrobenchmarkReport &report)
+{
+   int i, sum = 0;
+   for (i = 0; i < (int)report.results.size(); i++)
+      if (report.results[i].inputs == inputSetNames[DEGENERATE_SET]) sum += report.results[i].numMismatches;
+   return sum;
+}
+
+// An accelerated routine is shown with how many times faster it is than its reference on the same
+// inputs, and whether it agreed with it on every one; on the degenerate inputs a difference is
+// shown as a disagreement, which does not make the run fail.
+void printMicrobenchmarks(const MicrobenchmarkReport &report)
+{
+   int i, j;
+   cout << "Intersection routines, " << report.numInputs << " inputs a set, seed " << report.seed << ":" << endl;
+   for (i = 0; i < (int)report.results.size(); i++)
+   {
+      const MicrobenchmarkResult &result = report.results[i];
+	  cout << result.routine << " on " << result.inputs << ": " << result.nsPerCall << " ns a call, "
+		   << result.trueFraction * 100.0 << "% true";
+	  if (!result.reference.empty())
+	  {
+	     for (j = 0; j < i; j++)
+		    if (report.results[j].routine == result.reference && report.results[j].inputs == result.inputs)
+			   cout << ", " << report.results[j].nsPerCall / result.nsPerCall << " times as fast as " << result.reference;
+		 if (result.numMismatches == 0) cout << ", agreeing on every input";
+		 else if (result.inputs == inputSetNames[DEGENERATE_SET]) cout << ", disagreeing on " << result.numMismatches << " inputs";
+		 else cout << ", DIFFERING on " << result.numMismatches << " inputs";
+	  }
+	  cout << "." << endl;
+   }
+}
+
+int writeMicrobenchmarkReport(const MicrobenchmarkReport &report, const char *fileName)
+{
+   string name = fileName;
+   int isCSV = name.size() >= 4 && name.compare(name.size() - 4, 4, ".csv") == 0;
+   int i;
+   ofstream out(fileName);
+
+   if (!out)
+   {
+      cerr << "Cannot write the microbenchmark report " << fileName << "." << endl;
+	  return 0;
+   }
+   out.precision(9);
+
+   if (isCSV)
+   {
+      out << "routine,inputs,reference,num_inputs,calls,ns_per_call,true_fraction,mismatches" << endl;
+	  for (i = 0; i < (int)report.results.size(); i++)
+	  {
+	     const MicrobenchmarkResult &result = report.results[i];
+		 out << result.routine << "," << result.inputs << "," << result.reference << "," << result.numInputs << ","
+			 << result.numCalls << "," << result.nsPerCall << "," << result.trueFraction << "," << result.numMismatches << endl;
+	  }
+   }
+   else
+   {
+      out << "{" << endl
+		  << "  \"seed\": " << report.seed << "," << endl
+		  << "  \"inputsPerSet\": " << report.numInputs << "," << endl
+		  << "  \"mismatches\": " << numberMismatches(report) << "," << endl
+		  << "  \"degenerateMismatches\": " << numberDegenerateMismatches(report) << "," << endl
+		  << "  \"results\": [" << endl;
+	  for (i = 0; i < (int)report.results.size(); i++)
+	  {
+	     const MicrobenchmarkResult &result = report.results[i];
+		 out << "    { \"routine\": \"" << result.routine << "\", \"inputs\": \"" << result.inputs << "\", \"reference\": \""
+			 << result.reference << "\", \"calls\": " << result.numCalls << ", \"nsPerCall\": " << result.nsPerCall
+			 << ", \"trueFraction\": " << result.trueFraction << ", \"mismatches\": " << result.numMismatches
+			 << ", \"firstMismatch\": " << result.firstMismatch << " }" << (i + 1 < (int)report.results.size() ? "," : "") << endl;
+	  }
+      out << "  ]" << endl
+		  << "}" << endl;
+   }
+
+   if (!out)
+   {
+      cerr << "Cannot write the microbenchmark report " << fileName << "." << endl;
+	  return 0;
+   }
+   return 1;
+}
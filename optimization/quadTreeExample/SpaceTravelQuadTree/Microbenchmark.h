@@ -0,0 +1,54 @@
+#ifndef Microbenchmark_38254
+#define Microbenchmark_38254
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define MICROBENCHMARK_MIN_TIME 50.0 // Milliseconds each routine is timed for at least, going over its
+                                     // inputs again and again.
+#define MICROBENCHMARK_EXTENT 100.0  // Random inputs have co-ordinates between minus and plus this.
+
+// Timing of an intersection routine over one set of inputs.
+struct MicrobenchmarkResult
+{
+   string routine;      // Name of the routine timed.
+   string inputs;       // The set of inputs: "random", "collinear", "degenerate", "touching" or "frusta".
+   string reference;    // For an accelerated routine, the name of the routine it stands in for, and
+                        // whose answers it must give; empty for the original routines.
+   int numInputs;
+   long long numCalls;  // Calls timed, over all the passes.
+   double nsPerCall;
+   double trueFraction; // Fraction of the inputs the routine returns 1 for.
+   int numMismatches;   // Inputs an accelerated routine answers differently from its reference.
+   int firstMismatch;   // Index of the first of them, -1 if none.
+};
+
+// Results of a run of the microbenchmarks.
+struct MicrobenchmarkReport
+{
+   unsigned seed;
+   int numInputs; // Inputs in each set.
+   vector<MicrobenchmarkResult> results;
+};
+
+// Time the routines of intersectionDetectionRoutines on sets of numInputs inputs each, made from
+// the seed: random ones, and ones made to be awkward, with points collinear, shapes of no length
+// or area, and shapes that just touch, in whole numbers so that the answers are exact. Each
+// accelerated routine is run on the same inputs as the routine it replaces, and its answers
+// checked against it; the inputs of the first it gets wrong are printed. On shapes of no length
+// or area the originals answer as their general tests happen to, which an accelerated routine
+// need not match, so differences there are counted apart, as disagreements.
+void runMicrobenchmarks(int numInputs, unsigned seed, MicrobenchmarkReport &report);
+
+void printMicrobenchmarks(const MicrobenchmarkReport &report); // Print the results.
+int numberMismatches(const MicrobenchmarkReport &report); // Inputs answered wrongly, over all the routines,
+                                                          // but for the degenerate ones.
+int numberDegenerateMismatches(const MicrobenchmarkReport &report); // Degenerate inputs answered differently.
+
+// Write the report to the file, as CSV, a line for each routine and set of inputs, if its name ends
+// in .csv, and otherwise as JSON. Return 1 if written, or report the problem and return 0.
+int writeMicrobenchmarkReport(const MicrobenchmarkReport &report, const char *fileName);
+
+#endif
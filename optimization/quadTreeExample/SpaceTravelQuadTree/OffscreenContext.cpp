@@ -0,0 +1,119 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "OffscreenContext.h"
+
+using namespace std;
+
+OffscreenContext::OffscreenContext()
+{
+#ifdef OFFSCREEN_EGL
+   display = EGL_NO_DISPLAY;
+   context = EGL_NO_CONTEXT;
+#endif
+   framebuffer = colorBuffer = depthBuffer = 0;
+}
+
+#ifdef OFFSCREEN_EGL
+
+// Return the display of the surfaceless platform, if EGL has it, and otherwise the default display.
+static EGLDisplay offscreenDisplay()
+{
+   const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+   PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+      (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+   if (extensions != NULL && strstr(extensions, "EGL_MESA_platform_surfaceless") != NULL && getPlatformDisplay != NULL)
+   {
+      EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	  if (display != EGL_NO_DISPLAY) return display;
+   }
+   return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+// The context is of desktop OpenGL with no profile asked for, so the compatibility one, as the
+// drawing uses the fixed-function matrix stack alongside the shaders. It is made current with no
+// surface, for which EGL_KHR_surfaceless_context is needed.
+int OffscreenContext::create(int width, int height)
+{
+   EGLint major, minor, numConfigs;
+   EGLConfig eglConfig;
+   const EGLint configAttributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+
+   display = offscreenDisplay();
+   if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+   {
+      cerr << "Cannot open an EGL display." << endl;
+	  display = EGL_NO_DISPLAY;
+	  return 0;
+   }
+   if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(display, configAttributes, &eglConfig, 1, &numConfigs) ||
+	   numConfigs < 1)
+   {
+      cerr << "The EGL display has no desktop OpenGL." << endl;
+	  return 0;
+   }
+   context = eglCreateContext(display, eglConfig, EGL_NO_CONTEXT, NULL);
+   if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+   {
+      cerr << "Cannot make an OpenGL context current without a surface (EGL error " << hex << eglGetError() << dec
+		   << ")." << endl;
+	  return 0;
+   }
+
+   glewInit();
+
+   glGenRenderbuffers(1, &colorBuffer);
+   glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+   glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+   glGenRenderbuffers(1, &depthBuffer);
+   glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+   glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+   glGenFramebuffers(1, &framebuffer);
+   glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+   glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+   glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+   if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+   {
+      cerr << "Cannot make an offscreen framebuffer of " << width << " by " << height << "." << endl;
+	  return 0;
+   }
+   glDrawBuffer(GL_COLOR_ATTACHMENT0);
+   glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+   cout << "Offscreen OpenGL " << glGetString(GL_VERSION) << " on " << glGetString(GL_RENDERER) << ", EGL "
+	    << major << "." << minor << ", " << width << " by " << height << "." << endl;
+   return 1;
+}
+
+void OffscreenContext::destroy()
+{
+   if (framebuffer != 0)
+   {
+      glDeleteFramebuffers(1, &framebuffer);
+	  glDeleteRenderbuffers(1, &colorBuffer);
+	  glDeleteRenderbuffers(1, &depthBuffer);
+	  framebuffer = colorBuffer = depthBuffer = 0;
+   }
+   if (display != EGL_NO_DISPLAY)
+   {
+      eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	  if (context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+	  eglTerminate(display);
+	  display = EGL_NO_DISPLAY;
+	  context = EGL_NO_CONTEXT;
+   }
+}
+
+#else
+
+int OffscreenContext::create(int /*width*/, int /*height*/)
+{
+   cerr << "This build cannot draw offscreen: build it with OFFSCREEN_EGL defined and link it with EGL." << endl;
+   return 0;
+}
+
+void OffscreenContext::destroy()
+{
+}
+
+#endif
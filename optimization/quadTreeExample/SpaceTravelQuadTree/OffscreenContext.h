@@ -0,0 +1,41 @@
+#ifndef OffscreenContext_46318
+#define OffscreenContext_46318
+
+#include <GL/glew.h>
+
+#ifdef OFFSCREEN_EGL
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+using namespace std;
+
+// OpenGL without a window, for machines with no display: an EGL context on Mesa's surfaceless
+// platform, which needs no display server and, with no GPU, renders on the CPU with llvmpipe, or
+// failing that on EGL's default display. The context has no framebuffer of its own, so it draws
+// into a framebuffer object of color and depth renderbuffers, bound once made and left bound, so
+// that the program's drawing goes to it as it would to a window.
+//
+// EGL is needed only for this, so it is built in only if OFFSCREEN_EGL is defined, with the
+// program linked against libEGL; otherwise create reports that it is not there.
+class OffscreenContext
+{
+public:
+   OffscreenContext();
+   ~OffscreenContext() { destroy(); }
+   int create(int width, int height); // Make a context current on the calling thread, with GLEW initialized
+                                      // and drawing into a framebuffer of the size; return 1 if done, or
+                                      // report the problem and return 0.
+   void finish() { glFinish(); } // Wait for the frame's drawing to be done, in place of swapping buffers.
+   void destroy(); // Delete the framebuffer and the context.
+
+private:
+#ifdef OFFSCREEN_EGL
+   EGLDisplay display;
+   EGLContext context;
+#endif
+   GLuint framebuffer, colorBuffer, depthBuffer;
+};
+
+#endif
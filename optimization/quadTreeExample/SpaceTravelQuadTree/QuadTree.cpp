@@ -1,128 +1,742 @@
 
 #include <cstdlib>
 #include <cmath>
-#include <list>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <atomic>
 #include <iostream>
 #include "QuadTree.h"
 #include "intersectionDetectionRoutines.h"
+#include "Trace.h"
 
 using namespace std;
 
-// QuadtreeNode constructor.
-QuadtreeNode::QuadtreeNode(float x, float z, float s)
+// Return the index of the lowest bit set in a mask, which must not be 0.
+static int lowestBit(unsigned mask)
 {
-   SWCornerX = x; SWCornerZ = z; size = s;
-   SWChild = NWChild = NEChild = SEChild = NULL;
-   asteroidList.clear();
+   int k = 0;
+   while (!(mask & 1u))
+   {
+      mask >>= 1;
+	  k++;
+   }
+   return k;
 }
 
-// Return the number of asteroids intersecting the square.
-int QuadtreeNode::numberAsteroidsIntersected()
+// Add the asteroids among the candidates intersecting the square to the list intersecting; if 
+// there are no candidates given (i.e., for the root) every asteroid in the store is examined.
+void Quadtree::addIntersectingAsteroidsToList(int node, const vector<int> *candidates, vector<int> &intersecting)
 {
-   int numVal = 0;
-   int i, j;
-   for (i = 0; i<rows; i++)
-	 for (j=0; j<cols; j++)
-	     if (arrayAsteroids[i][j].getRadius() > 0.0) 
-	        if ( checkDiscRectangleIntersection( SWCornerX, SWCornerZ, SWCornerX+size, SWCornerZ-size,
-                 arrayAsteroids[i][j].getCenterX(), arrayAsteroids[i][j].getCenterZ(), 
-				 arrayAsteroids[i][j].getRadius() )
-			   )
-				asteroidList.push_back(Asteroid(arrayAsteroids[i][j]));
-		       numVal++;
-   return numVal;
+   const QuadtreeNode &square = nodeStorage[node];
+   int i, id, n = (candidates == NULL) ? asteroids->size() : candidates->size();
+   for (i = 0; i < n; i++)
+   {
+      id = (candidates == NULL) ? i : (*candidates)[i];
+	  if ( checkDiscRectangleIntersection( square.SWCornerX, square.SWCornerZ, square.SWCornerX+square.size, 
+		   square.SWCornerZ-square.size, asteroids->cx[id], asteroids->cz[id], asteroids->r[id] )
+		 )
+		 intersecting.push_back(id);
+   }
 }
 
-// Add the asteoroids intersecting the square to a local list of asteroids.
-void QuadtreeNode::addIntersectingAsteroidsToList()
+// Return 1 if the asteroid's center lies in the square, otherwise 0. The W and N sides belong to
+// the square and the E and S sides do not, so an asteroid is centered in exactly one leaf even if it
+// lies on the side between two.
+int Quadtree::ownsAsteroid(const QuadtreeNode &square, int id)
 {
-   int i, j;
-   for (i = 0; i<rows; i++)
-	 for (j=0; j<cols; j++)
-	     if (arrayAsteroids[i][j].getRadius() > 0.0) 
-	        if ( checkDiscRectangleIntersection( SWCornerX, SWCornerZ, SWCornerX+size, SWCornerZ-size, 
-				 arrayAsteroids[i][j].getCenterX(), arrayAsteroids[i][j].getCenterZ(), 
-				 arrayAsteroids[i][j].getRadius() )
-			   )
-		       asteroidList.push_back( Asteroid(arrayAsteroids[i][j]) );
+   return asteroids->cx[id] >= square.SWCornerX && asteroids->cx[id] < square.SWCornerX + square.size &&
+          asteroids->cz[id] <= square.SWCornerZ && asteroids->cz[id] > square.SWCornerZ - square.size;
 }
 
 // Recursive routine to split a square that intersects more than one asteroid; if it intersects
-// at most one asteroid leave it as a leaf and add the intersecting asteroid, if any, to a local 
-// list of asteroids.
-void QuadtreeNode::build()
+// at most one asteroid leave it as a leaf with the intersecting asteroid, if any, in its list of
+// asteroids. The four children are added to the end of the array of nodes together, and each in
+// turn takes its asteroids from its parent's and is built before the next, so that one list for
+// each depth, kept from build to build, holds all the lists alive at once. A leaf's list is added
+// to the end of the tree's list of asteroid ids. On the way back up the mass and center of mass of
+// the asteroids centered in each square are gathered, a leaf from its own asteroids and a split
+// square from its children, for the Barnes-Hut gravity computation. Nodes are referred to by
+// index, as the array of nodes may move as it grows.
+void Quadtree::build(int node, int depth)
 {
-	//if (this->numberAsteroidsIntersected() <= 1) this->addIntersectingAsteroidsToList();
-	//else
-   if ( this->numberAsteroidsIntersected() > 1 )
+   int i, firstChild;
+   float mass = 0.0;
+   glm::vec3 centerOfMass(0.0);
+   QuadtreeNode square = nodeStorage[node];
+
+   if ( buildLists[depth].size() > 1 && square.size > QUADTREE_MIN_SIZE )
+   {
+      float half = square.size/2.0;
+	  QuadtreeNode children[4] = { { square.SWCornerX, square.SWCornerZ, half, -1, 0, 0, 0.0, glm::vec3(0.0) },                // SW
+	                               { square.SWCornerX, square.SWCornerZ - half, half, -1, 0, 0, 0.0, glm::vec3(0.0) },         // NW
+								   { square.SWCornerX + half, square.SWCornerZ - half, half, -1, 0, 0, 0.0, glm::vec3(0.0) },  // NE
+								   { square.SWCornerX + half, square.SWCornerZ, half, -1, 0, 0, 0.0, glm::vec3(0.0) } };       // SE
+	  firstChild = nodeStorage.size();
+	  nodeStorage[node].firstChild = firstChild;
+	  for (i = 0; i < 4; i++) nodeStorage.push_back(children[i]);
+
+	  if ((int)buildLists.size() < depth + 2) buildLists.resize(depth + 2);
+	  for (i = 0; i < 4; i++)
+	  {
+	     buildLists[depth + 1].clear();
+		 addIntersectingAsteroidsToList(firstChild + i, &buildLists[depth], buildLists[depth + 1]);
+		 build(firstChild + i, depth + 1);
+		 mass += nodeStorage[firstChild + i].mass;
+		 centerOfMass += nodeStorage[firstChild + i].mass * nodeStorage[firstChild + i].centerOfMass;
+	  }
+   }
+   else
    {
-      SWChild = new QuadtreeNode(SWCornerX, SWCornerZ, size/2.0);
-	  SWChild->setRowsCols(rows, cols);
-	  SWChild->setArray(arrayAsteroids);
+      const vector<int> &intersecting = buildLists[depth];
+      nodeStorage[node].firstAsteroid = listStorage.size();
+	  nodeStorage[node].numAsteroids = intersecting.size();
+	  listStorage.insert(listStorage.end(), intersecting.begin(), intersecting.end());
 
-      NWChild = new QuadtreeNode(SWCornerX, SWCornerZ - size/2.0, size/2.0);
-	  NWChild->setRowsCols(rows, cols);
-	  NWChild->setArray(arrayAsteroids);
+      for (i = 0; i < (int)intersecting.size(); i++)
+	     if ( ownsAsteroid(square, intersecting[i]) )
+		 {
+		    int id = intersecting[i];
+		    mass += asteroids->getMass(id);
+			centerOfMass += asteroids->getMass(id) * glm::vec3(asteroids->cx[id], asteroids->cy[id], asteroids->cz[id]);
+		 }
+   }
+   if (mass > 0.0) centerOfMass /= mass;
+   nodeStorage[node].mass = mass;
+   nodeStorage[node].centerOfMass = centerOfMass;
+}
+
+// Recursive routine to return the gravitational acceleration at the position due to the asteroids
+// centered in the square. If the square is seen from the position under an angle below theta, i.e., 
+// its side is less than theta times the distance to its center of mass, it is taken as a single
+// body of its total mass at its center of mass; otherwise a leaf sums over its own asteroids and a 
+// split square over its children. The softening length keeps the force finite at short range, and
+// makes the contribution of an asteroid at the position itself vanish.
+glm::vec3 Quadtree::acceleration(int node, const glm::vec3 &position, float theta, float G, float softening)
+{
+   const QuadtreeNode &square = nodes[node];
+   glm::vec3 offset, sum(0.0);
+   float distanceSquared;
+
+   if (square.mass == 0.0) return sum;
+
+   offset = square.centerOfMass - position;
+   distanceSquared = glm::dot(offset, offset);
+   if (square.size * square.size < theta * theta * distanceSquared)
+      return (G * square.mass / ((distanceSquared + softening * softening) * sqrt(distanceSquared + softening * softening))) * offset;
+
+   if (square.firstChild < 0) // Square is leaf.
+   {
+      for (int i = square.firstAsteroid; i < square.firstAsteroid + square.numAsteroids; i++)
+	     if ( ownsAsteroid(square, asteroidLists[i]) )
+		 {
+		    int id = asteroidLists[i];
+		    offset = glm::vec3(asteroids->cx[id], asteroids->cy[id], asteroids->cz[id]) - position;
+			distanceSquared = glm::dot(offset, offset) + softening * softening;
+			sum += (G * asteroids->getMass(id) / (distanceSquared * sqrt(distanceSquared))) * offset;
+		 }
+	  return sum;
+   }
 
-      NEChild = new QuadtreeNode(SWCornerX + size/2.0, SWCornerZ - size/2.0, size/2.0);
-	  NEChild->setRowsCols(rows, cols);
-	  NEChild->setArray(arrayAsteroids);
+   return acceleration(square.firstChild, position, theta, G, softening) + acceleration(square.firstChild + 1, position, theta, G, softening) +
+          acceleration(square.firstChild + 2, position, theta, G, softening) + acceleration(square.firstChild + 3, position, theta, G, softening);
+}
 
-      SEChild = new QuadtreeNode(SWCornerX + size/2.0, SWCornerZ, size/2.0);
-	  SEChild->setRowsCols(rows, cols);
-	  SEChild->setArray(arrayAsteroids);
+// Test the square against the frusta of testing, which intersect its parent: those that miss it
+// are dropped, and those that contain it, which being convex they do if they contain the four
+// corners, move to inside, as they contain the square's descendants as well and need not be
+// tested against them again. Return 1 if any frustum of testing or inside is left, otherwise 0.
+int Quadtree::cullSquare(const QuadtreeNode &square, const Frustum *frusta, unsigned &testing, unsigned &inside,
+						 CullStats &stats)
+{
+   float west = square.SWCornerX, east = square.SWCornerX + square.size;
+   float south = square.SWCornerZ, north = square.SWCornerZ - square.size;
+   unsigned remaining = testing;
+   int k;
 
-	  
-	  SWChild->build(); NWChild->build(); NEChild->build(); SEChild->build(); 
+   stats.nodesVisited++;
+   testing = 0;
+   while (remaining)
+   {
+      k = lowestBit(remaining);
+	  remaining &= remaining - 1;
+	  const Frustum &f = frusta[k];
+	  stats.tests++;
+	  if ( checkConvexQuadrilateralRectangleIntersection(f.x1, f.z1, f.x2, f.z2, f.x3, f.z3, f.x4, f.z4,
+		   west, south, east, north) )
+	  {
+	     stats.tests++; // The four corners count as one test of containment.
+	     if ( checkPointInQuadrilateral(f.x1, f.z1, f.x2, f.z2, f.x3, f.z3, f.x4, f.z4, west, south) &&
+			  checkPointInQuadrilateral(f.x1, f.z1, f.x2, f.z2, f.x3, f.z3, f.x4, f.z4, west, north) &&
+			  checkPointInQuadrilateral(f.x1, f.z1, f.x2, f.z2, f.x3, f.z3, f.x4, f.z4, east, north) &&
+			  checkPointInQuadrilateral(f.x1, f.z1, f.x2, f.z2, f.x3, f.z3, f.x4, f.z4, east, south) )
+		    inside |= 1u << k;
+		 else testing |= 1u << k;
+	  }
    }
+   return (testing | inside) != 0;
 }
 
-// Recursive routine to draw the asteroids in a square's list if the square is a
-// leaf and it intersects the frustum (which is specified by the input parameters);
-// if the square is not a leaf, the routine recursively calls itself on its children.
-void QuadtreeNode::drawAsteroids(float x1, float z1, float x2, float z2, 
-					             float x3, float z3, float x4, float z4)
+// Recursive routine to append the asteroids in a square's list to the list of each frustum that
+// intersects the square, if it is a leaf; if not, the routine recursively calls itself on its 
+// children with the frusta that intersect the square. A square that no frustum intersects is not
+// visited further.
+void Quadtree::collectAsteroids(int node, const Frustum *frusta, unsigned testing, unsigned inside, vector<int> *visible,
+								CullStats &stats)
 {
-   // If the square does not intersect the frustum do nothing.
-   if ( checkQuadrilateralsIntersection(x1, z1, x2, z2, x3, z3, x4, z4,
-								        SWCornerX, SWCornerZ, SWCornerX, SWCornerZ-size,
-								        SWCornerX+size, SWCornerZ-size, SWCornerX+size, SWCornerZ) )
+   const QuadtreeNode &square = nodes[node];
+   unsigned remaining;
+   int k;
+
+   if (!cullSquare(square, frusta, testing, inside, stats)) return;
+
+   if (square.firstChild < 0) // Square is leaf.
    {
-      if (SWChild == NULL) // Square is leaf.
+      // Take all the asteroids in the square's list for each frustum that intersects it.
+	  remaining = testing | inside;
+	  while (remaining)
 	  {
-         // Define local iterator to traverse asteroidList and initialize.
-         list<Asteroid>::iterator asteroidListIterator;
-         asteroidListIterator = asteroidList.begin();
+	     k = lowestBit(remaining);
+		 remaining &= remaining - 1;
+		 visible[k].insert(visible[k].end(), asteroidLists + square.firstAsteroid, asteroidLists + square.firstAsteroid + square.numAsteroids);
+	  }
+   }
+   else
+   {
+      collectAsteroids(square.firstChild, frusta, testing, inside, visible, stats);
+	  collectAsteroids(square.firstChild + 1, frusta, testing, inside, visible, stats);
+	  collectAsteroids(square.firstChild + 2, frusta, testing, inside, visible, stats);
+	  collectAsteroids(square.firstChild + 3, frusta, testing, inside, visible, stats);
+   }
+}
+
+// Tests the squares just as the traversal that collects the asteroids does, with its stats counted
+// apart, so that the outcomes are those of the frame's culling.
+void Quadtree::classifyNodes(const Frustum *frusta, int numFrusta, vector<NodeVisit> &visits)
+{
+   visits.clear();
+   if (numNodes == 0 || numFrusta == 0) return;
+   numFrusta = min(numFrusta, QUADTREE_MAX_FRUSTA);
+   classifyNodes(0, frusta, (numFrusta == QUADTREE_MAX_FRUSTA) ? ~0u : (1u << numFrusta) - 1, 0, visits);
+}
+
+void Quadtree::classifyNodes(int node, const Frustum *frusta, unsigned testing, unsigned inside,
+							 vector<NodeVisit> &visits)
+{
+   const QuadtreeNode &square = nodes[node];
+   CullStats stats = { 0, 0 };
+   NodeVisit visit;
+
+   visit.node = node;
+   if (!cullSquare(square, frusta, testing, inside, stats)) visit.outcome = NODE_CULLED;
+   else if (square.firstChild < 0) visit.outcome = NODE_LEAF_DRAWN;
+   else if (testing != 0) visit.outcome = NODE_PARTIAL;
+   else visit.outcome = NODE_INSIDE;
+   visits.push_back(visit);
+   if (visit.outcome == NODE_CULLED || square.firstChild < 0) return;
+   for (int c = 0; c < 4; c++)
+      classifyNodes(square.firstChild + c, frusta, testing, inside, visits);
+}
 
-         // Draw all the asteroids in asteroidList.
-         while(asteroidListIterator != asteroidList.end() )
+// Split the traversal from the root for the frusta into subtree tasks, kept in the order the
+// serial traversal would visit the subtrees in: each task that is not a leaf is replaced by its
+// children that some frustum intersects, in turn, until there are enough tasks or none left to
+// split. A task holds the masks it is to be visited with, as a call of the recursive routine would.
+void Quadtree::splitTraversal(const Frustum *frusta, unsigned testing, int numTasks)
+{
+   CullTask root = { 0, testing, 0 };
+   vector<CullTask> &next = splitTasks;
+   int i, c, isSplit = 1;
+
+   cullTasks.assign(1, root);
+   while (isSplit && (int)cullTasks.size() < numTasks)
+   {
+      isSplit = 0;
+	  next.clear();
+      for (i = 0; i < (int)cullTasks.size(); i++)
+	  {
+	     CullTask task = cullTasks[i];
+		 const QuadtreeNode &square = nodes[task.node];
+		 if (square.firstChild < 0)
+		 {
+		    next.push_back(task);
+			continue;
+		 }
+		 if (!cullSquare(square, frusta, task.testing, task.inside, cullStats)) continue;
+		 for (c = 0; c < 4; c++)
+		 {
+		    CullTask child = { square.firstChild + c, task.testing, task.inside };
+			next.push_back(child);
+		 }
+		 isSplit = 1;
+	  }
+	  cullTasks.swap(next);
+   }
+}
+
+// Parallel traversal for the frusta on a work-stealing scheduler: the subtree tasks are dealt out
+// to the threads in contiguous blocks, and a thread that has run its own block steals tasks from 
+// the far end of the others'. The range of tasks left in a block is held in one atomic word, the
+// first task in the high half and the end in the low half, and taken a task at a time by compare
+// and swap, from the front by the owner and from the back by thieves, so there is no lock. Each
+// thread appends to lists of its own and notes where each task's asteroids went, and once all are
+// done the tasks' stretches of the lists are joined in task order, which is the order of the serial
+// traversal. The lists and the rest are kept from one traversal to the next, as are the threads, those
+// of a pool that waits between traversals, so that once the lists have grown, a traversal allocates
+// nothing and starts no thread: the tasks' are given room for as many as a split can make, under four
+// for each asked for, and each thread's, once joined, for twice all the asteroids of the traversal,
+// more than its share of a later one will seldom be.
+void Quadtree::collectAsteroidsParallel(const Frustum *frusta, int numFrusta, unsigned testing,
+										vector<int> *visible, int numThreads)
+{
+   int i, k, t, numTasks, maxTasks = 4 * numThreads * QUADTREE_TASKS_PER_THREAD;
+
+   cullTasks.reserve(maxTasks);
+   splitTasks.reserve(maxTasks);
+   taskThread.reserve(maxTasks);
+   taskStart.reserve(maxTasks * QUADTREE_MAX_FRUSTA);
+   taskEnd.reserve(maxTasks * QUADTREE_MAX_FRUSTA);
+   splitTraversal(frusta, testing, numThreads * QUADTREE_TASKS_PER_THREAD);
+   numTasks = cullTasks.size();
+   if (numThreads > numTasks) numThreads = (numTasks > 0) ? numTasks : 1;
+
+   if ((int)taskBlocks.size() < numThreads) vector< atomic<unsigned long long> >(numThreads).swap(taskBlocks);
+   vector< atomic<unsigned long long> > &blocks = taskBlocks;
+   for (t = 0; t < numThreads; t++)
+      blocks[t].store(((unsigned long long)(numTasks * t / numThreads) << 32) | (unsigned)(numTasks * (t + 1) / numThreads));
+   threadVisible.resize(numThreads * QUADTREE_MAX_FRUSTA);
+   threadStats.resize(numThreads);
+   taskThread.resize(numTasks);
+   taskStart.resize(numTasks * QUADTREE_MAX_FRUSTA);
+   taskEnd.resize(numTasks * QUADTREE_MAX_FRUSTA);
+
+   auto runTasks = [&](int t)
+   {
+      TRACE_SCOPE("Quadtree cull tasks");
+      vector<int> *out = &threadVisible[t * QUADTREE_MAX_FRUSTA];
+	  CullStats &stats = threadStats[t];
+	  int victim, task, f;
+	  stats.nodesVisited = stats.tests = 0;
+	  for (f = 0; f < numFrusta; f++) out[f].clear();
+	  for (victim = t; victim < t + numThreads; victim++)
+	  {
+	     atomic<unsigned long long> &block = blocks[victim % numThreads];
+		 while (true)
 		 {
-            asteroidListIterator->draw();
-	        asteroidListIterator++;
-		 }	  
+		    unsigned long long range = block.load(), taken;
+			unsigned begin = range >> 32, end = (unsigned)range;
+			if (begin >= end) break;
+			if (victim == t)
+			{
+			   task = begin;
+			   taken = ((unsigned long long)(begin + 1) << 32) | end;
+			}
+			else
+			{
+			   task = end - 1;
+			   taken = ((unsigned long long)begin << 32) | (end - 1);
+			}
+			if (!block.compare_exchange_weak(range, taken)) continue;
+			for (f = 0; f < numFrusta; f++) taskStart[task * QUADTREE_MAX_FRUSTA + f] = out[f].size();
+			collectAsteroids(cullTasks[task].node, frusta, cullTasks[task].testing, cullTasks[task].inside, out, stats);
+			taskThread[task] = t;
+			for (f = 0; f < numFrusta; f++) taskEnd[task * QUADTREE_MAX_FRUSTA + f] = out[f].size();
+		 }
 	  }
-	  else 
+   };
+
+   cullWorkers.run(numThreads, numThreads, runTasks);
+
+   for (t = 0; t < numThreads; t++)
+   {
+      cullStats.nodesVisited += threadStats[t].nodesVisited;
+	  cullStats.tests += threadStats[t].tests;
+   }
+   for (k = 0; k < numFrusta; k++)
+      for (i = 0; i < numTasks; i++)
 	  {
-	     SWChild->drawAsteroids(x1, z1, x2, z2, x3, z3, x4, z4); 
-		 NWChild->drawAsteroids(x1, z1, x2, z2, x3, z3, x4, z4); 
-		 NEChild->drawAsteroids(x1, z1, x2, z2, x3, z3, x4, z4); 
-		 SEChild->drawAsteroids(x1, z1, x2, z2, x3, z3, x4, z4);
+	     const vector<int> &out = threadVisible[taskThread[i] * QUADTREE_MAX_FRUSTA + k];
+		 visible[k].insert(visible[k].end(), out.begin() + taskStart[i * QUADTREE_MAX_FRUSTA + k], 
+			 out.begin() + taskEnd[i * QUADTREE_MAX_FRUSTA + k]);
 	  }
+   for (t = 0; t < numThreads; t++)
+      for (k = 0; k < numFrusta; k++)
+	  {
+	     vector<int> &out = threadVisible[t * QUADTREE_MAX_FRUSTA + k];
+		 if (out.capacity() < visible[k].size()) out.reserve(2 * visible[k].size());
+	  }
+}
+
+// Recursive routine to find the first asteroid hit by a sphere of the given radius moving along the
+// ray nearer than hit.distance; for a plain ray the radius is 0. The ray direction must be of unit
+// length so that ray parameters are distances. Moving the sphere is the same as casting the ray
+// against asteroids grown by its radius, within squares grown by its radius. In a leaf each asteroid
+// of the list is tested; otherwise the children met by the ray are visited in the order the ray
+// enters them, stopping at the first child that the ray enters beyond the best hit found so far.
+void Quadtree::raycast(int node, const glm::vec3 &origin, const glm::vec3 &direction, float radius, RayHit &hit)
+{
+   const QuadtreeNode &square = nodes[node];
+   float t;
+
+   if (square.firstChild < 0) // Square is leaf.
+   {
+      for (int i = square.firstAsteroid; i < square.firstAsteroid + square.numAsteroids; i++)
+	  {
+	     int id = asteroidLists[i];
+	     if ( checkRaySphereIntersection(origin.x, origin.y, origin.z, direction.x, direction.y, direction.z,
+			  asteroids->cx[id], asteroids->cy[id], asteroids->cz[id], asteroids->r[id] + radius, hit.distance, &t) 
+			)
+            if (hit.asteroid < 0 || t < hit.distance)
+		    {
+			   hit.asteroid = id;
+			   hit.distance = t;
+		    }
+	  }
+	  return;
+   }
+
+   // Sort the children met by the ray on the parameter at which the ray enters them (insertion
+   // sort, at most four entries).
+   int order[4];
+   float tEnter[4];
+   int numMet = 0, i, k;
+   for (i = square.firstChild; i < square.firstChild + 4; i++)
+      if ( checkRayRectangleIntersection(origin.x, origin.z, direction.x, direction.z,
+		   nodes[i].SWCornerX - radius, nodes[i].SWCornerZ + radius, 
+		   nodes[i].SWCornerX + nodes[i].size + radius, nodes[i].SWCornerZ - nodes[i].size - radius,
+		   hit.distance, &t) 
+		 )
+	  {
+	     for (k = numMet; k > 0 && tEnter[k-1] > t; k--)
+		 {
+		    tEnter[k] = tEnter[k-1];
+			order[k] = order[k-1];
+		 }
+		 tEnter[k] = t;
+		 order[k] = i;
+		 numMet++;
+	  }
+
+   for (i = 0; i < numMet; i++)
+   {
+      if (hit.asteroid >= 0 && tEnter[i] > hit.distance) break;
+	  raycast(order[i], origin, direction, radius, hit);
+   }
+}
+
+// Set minY and maxY to the vertical extent of the asteroids, for the ray-cast queries.
+static void verticalExtent(AsteroidStore *asteroids, float &minY, float &maxY)
+{
+   int i, n = asteroids->size();
+   const float *cy = asteroids->cy, *r = asteroids->r;
+   minY = (n > 0) ? cy[0] - r[0] : 0.0;
+   maxY = (n > 0) ? cy[0] + r[0] : 0.0;
+   for (i = 1; i < n; i++)
+   {
+      minY = min(minY, cy[i] - r[i]);
+	  maxY = max(maxY, cy[i] + r[i]);
    }
 }
 
-// Initialize quadtree by splitting nodes till each leaf node intersects at most one asteroid.
+// Initialize quadtree by splitting nodes till each leaf node intersects at most one asteroid;
+// a tree built before, e.g. for asteroids that have since moved, is discarded, though the arrays
+// that held it are kept for the new tree.
 void Quadtree::initialize(float x, float z, float s)
 {
-   header = new QuadtreeNode(x, z, s);
-   header->setRowsCols(rows, cols);
-   header->setArray(arrayAsteroids);
-   header->build();
+   TRACE_SCOPE("Quadtree::initialize");
+   QuadtreeNode root = { x, z, s, -1, 0, 0, 0.0, glm::vec3(0.0) };
+
+   nodeStorage.clear();
+   listStorage.clear();
+   nodeStorage.push_back(root);
+   if (buildLists.empty()) buildLists.resize(1);
+   buildLists[0].clear();
+   addIntersectingAsteroidsToList(0, NULL, buildLists[0]);
+   verticalExtent(asteroids, minY, maxY);
+
+   build(0, 0);
+   nodes = nodeStorage.data();
+   numNodes = nodeStorage.size();
+   asteroidLists = listStorage.data();
+   numListed = listStorage.size();
+}
+
+// Recursive routine to count the asteroid for each square from the given one down that it
+// intersects, by the test the build makes, or to add it to the lists of such leaves; return 0 if
+// a leaf counted comes to more asteroids than it may hold, else 1.
+int Quadtree::countIntersecting(int node, int id, int isListed)
+{
+   const QuadtreeNode &square = nodeStorage[node];
+   int i, isKept = 1;
+   if ( !checkDiscRectangleIntersection( square.SWCornerX, square.SWCornerZ, square.SWCornerX+square.size, 
+		square.SWCornerZ-square.size, asteroids->cx[id], asteroids->cz[id], asteroids->r[id] )
+	  )
+      return 1;
+   if (square.firstChild < 0) // Square is leaf.
+   {
+      if (isListed) listStorage[squareCounts[node]++] = id;
+	  else if ( ++squareCounts[node] > 1 && square.size > QUADTREE_MIN_SIZE ) return 0;
+	  return 1;
+   }
+   if (!isListed) squareCounts[node]++;
+   for (i = square.firstChild; i < square.firstChild + 4; i++)
+      isKept &= countIntersecting(i, id, isListed);
+   return isKept;
+}
+
+// Leaves are given their stretches in the order build visits them, SW, NW, NE and SE child in turn.
+int Quadtree::placeLists(int node, int first)
+{
+   QuadtreeNode &square = nodeStorage[node];
+   if (square.firstChild < 0)
+   {
+      square.firstAsteroid = first;
+	  square.numAsteroids = squareCounts[node];
+	  squareCounts[node] = first; // Where the next of the leaf's asteroids goes.
+	  return first + square.numAsteroids;
+   }
+   for (int i = square.firstChild; i < square.firstChild + 4; i++)
+      first = placeLists(i, first);
+   return first;
+}
+
+// The sums are taken in the order build takes them, so they come out the same.
+void Quadtree::gatherMasses(int node)
+{
+   QuadtreeNode &square = nodeStorage[node];
+   float mass = 0.0;
+   glm::vec3 centerOfMass(0.0);
+   int i;
+
+   if (square.firstChild >= 0)
+      for (i = square.firstChild; i < square.firstChild + 4; i++)
+	  {
+	     gatherMasses(i);
+		 mass += nodeStorage[i].mass;
+		 centerOfMass += nodeStorage[i].mass * nodeStorage[i].centerOfMass;
+	  }
+   else
+      for (i = square.firstAsteroid; i < square.firstAsteroid + square.numAsteroids; i++)
+	     if ( ownsAsteroid(square, listStorage[i]) )
+		 {
+		    int id = listStorage[i];
+		    mass += asteroids->getMass(id);
+			centerOfMass += asteroids->getMass(id) * glm::vec3(asteroids->cx[id], asteroids->cy[id], asteroids->cz[id]);
+		 }
+   if (mass > 0.0) centerOfMass /= mass;
+   square.mass = mass;
+   square.centerOfMass = centerOfMass;
+}
+
+// A build splits a square just if it intersects more than one asteroid and is larger than the
+// least size, so if the counts of the asteroids intersecting each square, taken by walking each
+// asteroid down the tree, call for the same squares to be split as are, a build would make the same
+// tree, and only the lists and masses need doing again; the lists are placed from the counts and
+// filled by a second walk, in order of asteroid id, as build fills them. Nothing is allocated once
+// the arrays have grown. The first walk stops at the first leaf that would have to be split, as
+// in a large field one nearly always does, where the walks would cost more than the build saved.
+int Quadtree::refresh(float x, float z, float s)
+{
+   TRACE_SCOPE("Quadtree::refresh");
+   int i, n = asteroids->size();
+
+   if ( numNodes == 0 || nodes != nodeStorage.data() || 
+	    nodeStorage[0].SWCornerX != x || nodeStorage[0].SWCornerZ != z || nodeStorage[0].size != s )
+   {
+      initialize(x, z, s);
+	  return 0;
+   }
+
+   squareCounts.assign(numNodes, 0);
+   for (i = 0; i < n; i++)
+      if (!countIntersecting(0, i, 0))
+	  {
+	     initialize(x, z, s);
+		 return 0;
+	  }
+   for (i = 0; i < numNodes; i++) // Does a split square now intersect at most one asteroid?
+      if ( nodeStorage[i].firstChild >= 0 && squareCounts[i] <= 1 )
+	  {
+	     initialize(x, z, s);
+		 return 0;
+	  }
+
+   listStorage.resize(placeLists(0, 0));
+   for (i = 0; i < n; i++) countIntersecting(0, i, 1);
+   gatherMasses(0);
+   verticalExtent(asteroids, minY, maxY);
+   asteroidLists = listStorage.data();
+   numListed = listStorage.size();
+   return 1;
+}
+
+void Quadtree::attach(const QuadtreeNode *nodes, int numNodes, const int *asteroidLists, int numListed,
+					  float minY, float maxY)
+{
+   nodeStorage.clear();
+   listStorage.clear();
+   this->nodes = nodes;
+   this->numNodes = numNodes;
+   this->asteroidLists = asteroidLists;
+   this->numListed = numListed;
+   this->minY = minY;
+   this->maxY = maxY;
 }
 
-// Routine to draw all the asteroids in the asteroid list of each leaf square that intersects the frustum.
-void Quadtree::drawAsteroids(float x1, float z1, float x2, float z2, 
-					         float x3, float z3, float x4, float z4)
+// The lists kept for building and refreshing count as well as the tree's own, as they are held
+// until released.
+size_t Quadtree::memoryUsed()
 {
-   header->drawAsteroids(x1, z1, x2, z2, x3, z3, x4, z4); 
+   size_t bytes = nodeStorage.capacity() * sizeof(QuadtreeNode) + listStorage.capacity() * sizeof(int) +
+				  buildLists.capacity() * sizeof(vector<int>) + squareCounts.capacity() * sizeof(int);
+   for (int i = 0; i < (int)buildLists.size(); i++) bytes += buildLists[i].capacity() * sizeof(int);
+   return bytes;
+}
+
+void Quadtree::releaseBuildStorage()
+{
+   vector< vector<int> >().swap(buildLists);
+   vector<int>().swap(squareCounts);
+}
+
+// Routine to append to visible all the asteroids in the asteroid list of each leaf square that intersects
+// the frustum; the caller draws them, or hands them on to be drawn.
+void Quadtree::collectAsteroids(float x1, float z1, float x2, float z2, 
+					            float x3, float z3, float x4, float z4, vector<int> &visible)
+{
+   Frustum frustum = { x1, z1, x2, z2, x3, z3, x4, z4 };
+   collectAsteroids(&frustum, 1, &visible);
+}
+
+// Routine to append to visible[k] the asteroids in the asteroid list of each leaf square that 
+// intersects frustum k, for every frustum together: each square is visited once, however many
+// frusta intersect it, up to QUADTREE_MAX_FRUSTA at a time. A tree of at least 
+// QUADTREE_PARALLEL_MIN_NODES nodes is traversed by up to numThreads threads, with the same result.
+void Quadtree::collectAsteroids(const Frustum *frusta, int numFrusta, vector<int> *visible, int numThreads)
+{
+   TRACE_SCOPE("Quadtree::collectAsteroids");
+   int first, count;
+   unsigned testing;
+   if (numNodes == 0) return;
+   for (first = 0; first < numFrusta; first += QUADTREE_MAX_FRUSTA)
+   {
+      count = min(numFrusta - first, QUADTREE_MAX_FRUSTA);
+	  testing = (count == QUADTREE_MAX_FRUSTA) ? ~0u : (1u << count) - 1;
+	  if (numThreads > 1 && numNodes >= QUADTREE_PARALLEL_MIN_NODES)
+	     collectAsteroidsParallel(frusta + first, count, testing, visible + first, numThreads);
+	  else collectAsteroids(0, frusta + first, testing, 0, visible + first, cullStats);
+   }
+}
+
+// Return the first asteroid hit by the ray from origin along direction within maxDist of the
+// origin; the asteroid of the result is -1 if there is none.
+RayHit Quadtree::raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDist)
+{
+   return castSphere(origin, direction, 0.0, maxDist);
+}
+
+// Batched ray-cast: hits[i] is set to the result of the query for rays[i].
+void Quadtree::raycast(const Ray *rays, int numRays, RayHit *hits)
+{
+   int i;
+   for (i = 0; i < numRays; i++)
+      hits[i] = castSphere(rays[i].origin, rays[i].direction, 0.0, rays[i].maxDist);
+}
+
+// Return the first asteroid touched by a sphere of the given radius moving in a straight line from
+// start to end, with the fraction of the movement made before contact. A single query covers the
+// whole movement however long it is, so fast movers cannot tunnel through asteroids between steps;
+// if start and end coincide the query reports an asteroid overlapping the sphere, if any.
+SweepHit Quadtree::sweepSphere(const glm::vec3 &start, const glm::vec3 &end, float radius)
+{
+   SweepHit sweep;
+   RayHit hit;
+   float length = glm::length(end - start);
+
+   if (length == 0.0) hit = castSphere(start, glm::vec3(1.0, 0.0, 0.0), radius, 0.0);
+   else hit = castSphere(start, end - start, radius, length);
+
+   sweep.asteroid = hit.asteroid;
+   if (hit.asteroid < 0 || length == 0.0) sweep.timeOfImpact = (hit.asteroid < 0) ? 1.0 : 0.0;
+   else sweep.timeOfImpact = hit.distance / length;
+   return sweep;
+}
+
+// Return the first asteroid hit by a sphere of the given radius (0 for a plain ray) moving from
+// origin along direction within maxDist of the origin; the asteroid of the result is -1 if there
+// is none, in which case the distance is maxDist.
+RayHit Quadtree::castSphere(const glm::vec3 &origin, const glm::vec3 &direction, float radius, float maxDist)
+{
+   RayHit hit;
+   float length, t;
+   hit.asteroid = -1;
+   hit.distance = maxDist;
+
+   length = glm::length(direction);
+   if (numNodes == 0 || length == 0.0) return hit;
+   glm::vec3 unitDirection = direction / length;
+
+   // Only the part of the ray within the vertical extent of the field can hit anything, so cut
+   // the ray short where it leaves that slab; this keeps rays climbing out of the plane of the
+   // field from walking every square underneath them.
+   if (unitDirection.y > 0.0 && (maxY + radius - origin.y) / unitDirection.y < hit.distance)
+      hit.distance = (maxY + radius - origin.y) / unitDirection.y;
+   else if (unitDirection.y < 0.0 && (minY - radius - origin.y) / unitDirection.y < hit.distance)
+      hit.distance = (minY - radius - origin.y) / unitDirection.y;
+
+   // The ray must meet the root square for there to be any hit at all.
+   if ( hit.distance >= 0.0 &&
+		checkRayRectangleIntersection(origin.x, origin.z, unitDirection.x, unitDirection.z,
+		nodes[0].SWCornerX - radius, nodes[0].SWCornerZ + radius, 
+		nodes[0].SWCornerX + nodes[0].size + radius, nodes[0].SWCornerZ - nodes[0].size - radius,
+		hit.distance, &t) 
+	  )
+      raycast(0, origin, unitDirection, radius, hit);
+
+   if (hit.asteroid < 0) hit.distance = maxDist;
+   return hit;
+}
+
+// Barnes-Hut approximation of the gravitational acceleration of the asteroid field at each of the n
+// positions, with opening angle theta (0 for the exact sum, larger for faster and rougher results).
+// Each query is a walk from the root taking O(log N) squares, so a pass over all N asteroids takes
+// O(N log N). The positions are split into equal ranges, one for each thread, which are kept from
+// one call to the next, so that a call each tick starts no threads and allocates nothing.
+void Quadtree::computeAccelerations(const glm::vec3 *positions, int n, float theta, float G, float softening,
+									glm::vec3 *accelerations, int numThreads)
+{
+   int i;
+   if (numNodes == 0)
+   {
+      for (i = 0; i < n; i++) accelerations[i] = glm::vec3(0.0);
+	  return;
+   }
+   if (numThreads < 1) numThreads = 1;
+   if (numThreads > n) numThreads = (n > 0) ? n : 1;
+
+   auto accelerateRange = [&](int t)
+   {
+      int begin = (int)((long long)n * t / numThreads), end = (int)((long long)n * (t + 1) / numThreads);
+      for (int k = begin; k < end; k++)
+	     accelerations[k] = acceleration(0, positions[k], theta, G, softening);
+   };
+   gravityWorkers.run(numThreads, numThreads, accelerateRange);
+}
+
+void collectAsteroidsBruteForce(AsteroidStore &asteroids, const Frustum *frusta, int numFrusta, 
+								vector<int> *visible, CullStats *stats)
+{
+   int id, k, n = asteroids.size();
+   for (id = 0; id < n; id++)
+   {
+      float x = asteroids.cx[id], z = asteroids.cz[id], r = asteroids.r[id];
+	  for (k = 0; k < numFrusta; k++)
+	  {
+	     const Frustum &f = frusta[k];
+	     if ( checkQuadrilateralsIntersection(f.x1, f.z1, f.x2, f.z2, f.x3, f.z3, f.x4, f.z4,
+		      x - r, z + r, x - r, z - r, x + r, z - r, x + r, z + r) )
+	        visible[k].push_back(id);
+	  }
+   }
+   if (stats != NULL) stats->tests += (long long)n * numFrusta;
 }
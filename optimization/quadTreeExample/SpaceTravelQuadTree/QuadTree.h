@@ -1,65 +1,251 @@
 #ifndef QuadTree_239847
 #define QuadTree_239847
 
-#include <list>
-#include "Asteroid.h"
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <glm/glm.hpp>
+#include "AsteroidStore.h"
+#include "WorkerPool.h"
 
 using namespace std;
 
-// Quadtree node class.
-class QuadtreeNode
+#define QUADTREE_MIN_SIZE 1.0f // Squares are not split below this side length, so asteroids that
+                               // overlap cannot force the build to subdivide forever.
+
+// A ray for the quadtree ray-cast queries; the direction need not be of unit length.
+struct Ray
+{
+   glm::vec3 origin;
+   glm::vec3 direction;
+   float maxDist; // Only hits at most this far from the origin are reported.
+};
+
+#define QUADTREE_MAX_FRUSTA 32 // Frusta tested together in one traversal, one bit each of a mask; more are taken in batches.
+#define QUADTREE_PARALLEL_MIN_NODES 65536 // Smaller trees are culled on the calling thread alone, as
+                                          // splitting the work and waking threads would cost more than
+                                          // it saves.
+#define QUADTREE_TASKS_PER_THREAD 16 // Subtree tasks of a parallel traversal for each thread, so a
+                                     // thread whose subtrees are culled early can steal others' work.
+
+// Frustum of a view as seen from above, for culling: the quadrilateral with vertices (x1, z1),
+// (x2, z2), (x3, z3) and (x4, z4) in the xz-plane, which must be convex.
+struct Frustum
+{
+   float x1, z1, x2, z2, x3, z3, x4, z4;
+};
+
+// Result of a ray-cast query.
+struct RayHit
+{
+   int asteroid;   // Id of the first asteroid hit along the ray, -1 if none.
+   float distance; // Distance from the ray origin to the hit point.
+};
+
+// Result of a swept-sphere query.
+struct SweepHit
+{
+   int asteroid;       // Id of the first asteroid touched by the moving sphere, -1 if none.
+   float timeOfImpact; // Fraction of the movement segment covered before contact, 1 if none.
+};
+
+// Quadtree node: a square of the field. The nodes of a tree are held in a single array and refer to
+// their children, and to the asteroids they hold, by index rather than by pointer, so a built tree
+// can be written to a file as it is and used again from wherever the file is mapped in memory.
+struct QuadtreeNode
 {
-public:
-   QuadtreeNode(float x, float z, float s);
-   int numberAsteroidsIntersected(); // Return the number of asteroids intersecting the square.
-   void addIntersectingAsteroidsToList(); // Add the intersected asteoroids to the local list of asteroids.
-
-   void build(); // Recursive routine to split a square that intersects more than one asteroid; 
-                 // if it intersects at most one asteroid leave it as a leaf and add the intersecting 
-                 // asteroid, if any, to a local list of asteroids.
-
-   void drawAsteroids(float x1, float z1, float x2, float z2,  // Recursive routine to draw the asteroids
-					  float x3, float z3, float x4, float z4); // in a square's list if the square is a
-															   // leaf and it intersects the frustum (which
-                                                               // is specified by the input parameters); 
-															   // if the square is not a leaf, the routine
-                                                               // recursively calls itself on its children.
-   void setRowsCols(int rows, int cols) { this->rows = rows; this->cols = cols; }
-   void setArray(Asteroid **arrayAsteroids) { this->arrayAsteroids = arrayAsteroids; }
-
-private: 
-	int rows;
-	int cols;
-	Asteroid **arrayAsteroids; // Global array of asteroids.
    float SWCornerX, SWCornerZ; // x and z co-ordinates of the SW corner of the square.
    float size; // Side length of square.
-   QuadtreeNode *SWChild, *NWChild, *NEChild, *SEChild; // Children nodes.
-   list<Asteroid> asteroidList; // Local list of asteroids intersecting the square - only filled for leaf nodes.
-   friend class Quadtree;
+   int firstChild; // Index of the SW child, followed by the NW, NE and SE children; -1 if the square is a leaf.
+   int firstAsteroid, numAsteroids; // Range in the tree's list of asteroid ids of those intersecting the 
+                                    // square - only leaves have one.
+   float mass; // Total mass of the asteroids centered in the square.
+   glm::vec3 centerOfMass; // Their center of mass.
+};
+
+// Work done by frustum culling, counted over the queries since the counts were last reset.
+struct CullStats
+{
+   long long nodesVisited; // Squares tested against the frusta.
+   long long tests;        // Tests of a square, or an asteroid's bounding square, against a frustum.
+};
+
+// What the culling traversal for a set of frusta does with a square it visits: drops it, as no
+// frustum intersects it; goes on to its children, testing them against the frusta that intersect
+// it but do not contain it, or without testing them, as each frustum that meets it contains it; or,
+// for a leaf, takes its asteroids.
+enum NodeOutcome
+{
+   NODE_CULLED, NODE_PARTIAL, NODE_INSIDE, NODE_LEAF_DRAWN,
+   NUM_NODE_OUTCOMES
+};
+
+// A square visited by a culling traversal, and what was done with it.
+struct NodeVisit
+{
+   int node;
+   NodeOutcome outcome;
+};
+
+// A subtree of a parallel culling traversal: its root and the masks it is to be visited with.
+struct CullTask
+{
+   int node;
+   unsigned testing, inside;
 };
 
 // Quadtree class.
 class Quadtree
 {
 public:
-   Quadtree() { header = NULL; } // Constructor.
+   Quadtree() { nodes = NULL; numNodes = 0; asteroidLists = NULL; numListed = 0; asteroids = NULL; minY = maxY = 0.0; resetCullStats(); } // Constructor.
    void initialize(float x, float z, float s); // Initialize quadtree by splitting nodes
                                                      // till each leaf node intersects at
-                                                     // most one asteroid.
+                                                     // most one asteroid; a tree built
+                                                     // before is discarded.
+   int refresh(float x, float z, float s); // Bring the tree up to date with asteroids that have moved,
+                                           // as initialize would: if no square need be split or joined
+                                           // the lists and masses are redone in the tree as it stands,
+                                           // and 1 returned; otherwise the tree is built again, and 0
+                                           // returned.
+   void attach(const QuadtreeNode *nodes, int numNodes,       // Use a tree built before and held
+               const int *asteroidLists, int numListed,       // elsewhere, e.g. in a mapped file,
+               float minY, float maxY);                       // in place; it must stay there while
+                                                              // in use.
+
+   void collectAsteroids(float x1, float z1, float x2, float z2,  // Routine to append to visible the asteroids
+					     float x3, float z3, float x4, float z4,  // in the asteroid list of each leaf square 
+						 vector<int> &visible);                   // that intersects the frustum; an asteroid
+                                                                  // in several such leaves is appended for each.
+   void collectAsteroids(const Frustum *frusta, int numFrusta, // The same for numFrusta frusta in a single
+                         vector<int> *visible,                 // traversal, appending to visible[k] the
+                         int numThreads = 1);                  // asteroids of frustum k; a large tree is 
+                                                               // traversed by up to numThreads threads.
+
+   RayHit raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDist); // Return the first asteroid
+                                                                                       // hit by the ray within
+                                                                                       // maxDist of its origin.
+   void raycast(const Ray *rays, int numRays, RayHit *hits); // Batched ray-cast, one hit per ray.
 
-   void drawAsteroids(float x1, float z1, float x2, float z2,  // Routine to draw all the asteroids in the  
-					  float x3, float z3, float x4, float z4); // asteroid list of each leaf square that
-                                                               // intersects the frustum.
+   SweepHit sweepSphere(const glm::vec3 &start, const glm::vec3 &end, // Return the first asteroid touched by a
+                        float radius);                                // sphere moving from start to end, and the
+                                                                      // fraction of the movement made before contact.
 
-   void setRowsCols(int rows, int cols) { this->rows = rows; this->cols = cols; }
-   void setArray(Asteroid **arrayAsteroids) { this->arrayAsteroids = arrayAsteroids; }
+   void computeAccelerations(const glm::vec3 *positions, int n, // Barnes-Hut approximation of the gravitational
+                             float theta, float G, float softening, // acceleration of the asteroid field at each of
+                             glm::vec3 *accelerations, int numThreads); // n positions, computed by up to numThreads
+                                                                         // threads; theta is the opening angle.
+
+   void classifyNodes(const Frustum *frusta, int numFrusta, // Set visits to the squares the culling traversal
+                      vector<NodeVisit> &visits);           // for up to QUADTREE_MAX_FRUSTA frusta visits, in
+                                                            // the order it visits them, each with its outcome;
+                                                            // the cull counts are left as they are.
+
+   const CullStats &getCullStats() { return cullStats; }
+   void resetCullStats() { cullStats.nodesVisited = cullStats.tests = 0; }
+
+   void setStore(AsteroidStore *asteroids) { this->asteroids = asteroids; }
+   size_t memoryUsed(); // Return the bytes held by the tree, the lists kept for building it among them.
+   void releaseBuildStorage(); // Free the lists kept for building, for a tree that will not be built again
+                               // or refreshed; a later build makes them anew.
+
+   const QuadtreeNode *getNodes() { return nodes; } // The root is node 0.
+   int numberNodes() { return numNodes; }
+   const int *getAsteroidLists() { return asteroidLists; }
+   int numberListed() { return numListed; }
+   float getMinY() { return minY; }
+   float getMaxY() { return maxY; }
 
 private:
-   QuadtreeNode *header;
-   int rows;
-   int cols;
-   Asteroid **arrayAsteroids; // Global array of asteroids.
+   void build(int node, int depth); // Recursive routine to split a square that intersects more than one
+                                    // asteroid, those in buildLists[depth], handing each child the
+                                    // asteroids of its parent as candidates; if it intersects at most one
+                                    // asteroid leave it as a leaf with the intersecting asteroid, if any,
+                                    // in its list.
+   int countIntersecting(int node, int id, int isListed); // Recursive routine to count the asteroid in
+                                                           // squareCounts for the square and each of its
+                                                           // descendants that it intersects, or if isListed,
+                                                           // to add it to the list of each such leaf;
+                                                           // return 0 if a leaf then holds too many.
+   int placeLists(int node, int first); // Recursive routine to give the leaves of the square the stretches
+                                        // of the list for their counts, from first on, in the order build
+                                        // would; return the end of the last.
+   void gatherMasses(int node); // Recursive routine to set the mass and center of mass of the square and
+                                // its descendants from the asteroids centered in them.
+   void addIntersectingAsteroidsToList(int node, const vector<int> *candidates, // Add the asteroids among the
+                                       vector<int> &intersecting);              // candidates (the whole store if
+                                                                                // NULL) intersecting the square.
+   int ownsAsteroid(const QuadtreeNode &square, int id); // Return 1 if the asteroid is centered in the square,
+                                                         // otherwise 0; half-open sides make each asteroid
+                                                         // centered in just one leaf.
+
+   int cullSquare(const QuadtreeNode &square, const Frustum *frusta, // Test a square against the frusta of
+                  unsigned &testing, unsigned &inside,              // testing: bit k of testing is set if
+                  CullStats &stats);                                // frustum k intersects the parent, so must
+                                                                    // be tested, and bit k of inside if it 
+                                                                    // contains the parent, so contains the
+                                                                    // square too. Update the masks for the
+                                                                    // square, count the work in stats and
+                                                                    // return 1 if any bit is left.
+   void collectAsteroids(int node, const Frustum *frusta,   // Recursive routine to append the asteroids in a
+                         unsigned testing, unsigned inside, // square's list to the list of each frustum that
+                         vector<int> *visible,              // intersects the square, if it is a leaf; if not,
+                         CullStats &stats);                 // the routine recursively calls itself on its
+                                                            // children.
+   void classifyNodes(int node, const Frustum *frusta,   // Recursive routine to add the square and those
+                      unsigned testing, unsigned inside, // of its descendants the traversal visits to
+                      vector<NodeVisit> &visits);        // visits.
+   void splitTraversal(const Frustum *frusta, unsigned testing, // Fill cullTasks with about numTasks subtrees,
+                       int numTasks);                           // in the order of the serial traversal.
+   void collectAsteroidsParallel(const Frustum *frusta, int numFrusta, // Traversal for up to QUADTREE_MAX_FRUSTA
+                                 unsigned testing, vector<int> *visible, // frusta by up to numThreads threads,
+                                 int numThreads);                        // stealing subtree tasks from each other.
+
+   void raycast(int node, const glm::vec3 &origin, const glm::vec3 &direction, // Recursive routine to find the first
+                float radius, RayHit &hit);                                    // asteroid hit by a sphere of the given
+                                                                               // radius (0 for a plain ray) moving along
+                                                                               // the ray nearer than hit.distance,
+                                                                               // visiting the children in the order the
+                                                                               // ray enters them and skipping those it
+                                                                               // enters beyond the best hit so far.
+   glm::vec3 acceleration(int node, const glm::vec3 &position, float theta, // Recursive routine to return the gravitational
+                          float G, float softening);                        // acceleration at a position due to the asteroids
+                                                                            // centered in the square, approximating a square
+                                                                            // by its total mass at its center of mass when it
+                                                                            // is seen under an angle below theta.
+
+   RayHit castSphere(const glm::vec3 &origin, const glm::vec3 &direction, // Shared by the ray-cast and swept-sphere
+                     float radius, float maxDist);                        // queries: a ray is a sphere of radius 0.
+
+   vector<QuadtreeNode> nodeStorage; // The nodes and lists of a tree built here.
+   vector<int> listStorage;
+   vector< vector<int> > buildLists; // Asteroids intersecting the square being built at each depth, kept,
+                                     // like the rest of these, from one build or refresh to the next.
+   vector<int> squareCounts; // Asteroids intersecting each square, then the next free place in each leaf's list.
+   WorkerPool gravityWorkers; // Threads of the gravity computation.
+   const QuadtreeNode *nodes; // The nodes in use, built here or attached.
+   int numNodes;
+   const int *asteroidLists; // The lists of asteroid ids of the leaves, one after another.
+   int numListed;
+   float minY, maxY; // Vertical extent of the asteroid field; the squares bound it only in x and z.
+   AsteroidStore *asteroids; // Global store of asteroids.
+
+   CullStats cullStats;
+   vector<CullStats> threadStats; // Counts of each thread of a parallel traversal.
+   vector<CullTask> cullTasks, splitTasks; // Kept from one parallel traversal to the next, for their memory,
+                                           // as are the rest of these.
+   vector< atomic<unsigned long long> > taskBlocks; // Range of tasks left in each thread's block.
+   WorkerPool cullWorkers; // Threads of the parallel traversal.
+   vector< vector<int> > threadVisible; // QUADTREE_MAX_FRUSTA lists for each thread.
+   vector<int> taskThread;        // Thread that ran each task ...
+   vector<int> taskStart, taskEnd; // ... and the stretch of that thread's list for each frustum that
+                                   // holds the task's asteroids.
 };
 
+// Append to visible[k] the asteroids of the store whose bounding squares intersect frustum k,
+// testing each asteroid against each frustum: the stand-in for a quadtree not yet built, and the
+// reference it is measured against. The tests are added to stats if it is given.
+void collectAsteroidsBruteForce(AsteroidStore &asteroids, const Frustum *frusta, int numFrusta, 
+                                vector<int> *visible, CullStats *stats = NULL);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include <cstdlib>
+#include <GL/glew.h>
+#include "QuadtreeView.h"
+#include "Trace.h"
+
+using namespace std;
+
+GLuint InitShader(const char* vShaderFile, const char* fShaderFile);
+
+const char *nodeOutcomeNames[NUM_NODE_OUTCOMES] = { "culled", "partial", "inside", "leaves drawn" };
+
+// Squares culled are red, partly in a frustum yellow, wholly in one green, and leaves whose asteroids
+// are taken cyan.
+const unsigned char nodeOutcomeColors[NUM_NODE_OUTCOMES][4] = {
+   { 200, 0, 0, 255 }, { 255, 255, 0, 255 }, { 0, 255, 0, 255 }, { 0, 255, 255, 255 }
+};
+
+// Frusta, by viewport: the fixed camera's white and the spacecraft's magenta.
+static const unsigned char FRUSTUM_COLORS[2][4] = { { 255, 255, 255, 255 }, { 255, 0, 255, 255 } };
+
+// Add the four sides of the quadrilateral with the x, z corners, in order, in the color.
+static void addQuadrilateral(const float *corners, const unsigned char *rgba, vector<LineVertex> &vertices)
+{
+   int i, j;
+   for (i = 0; i < 4; i++)
+      for (j = i; j <= i + 1; j++)
+	  {
+	     LineVertex vertex;
+		 vertex.x = corners[2 * (j % 4)];
+		 vertex.y = QUADTREE_VIEW_Y;
+		 vertex.z = corners[2 * (j % 4) + 1];
+		 vertex.rgba[0] = rgba[0]; vertex.rgba[1] = rgba[1]; vertex.rgba[2] = rgba[2]; vertex.rgba[3] = rgba[3];
+		 vertices.push_back(vertex);
+	  }
+}
+
+// Squares run from their SW corner north, which is towards -z, and east.
+void makeQuadtreeLines(Quadtree &quadtree, const Frustum *frusta, int numFrusta, vector<NodeVisit> &visits,
+					   QuadtreeLines &lines)
+{
+   TRACE_SCOPE("makeQuadtreeLines");
+   const QuadtreeNode *nodes = quadtree.getNodes();
+   int i;
+
+   lines.vertices.clear();
+   for (i = 0; i < NUM_NODE_OUTCOMES; i++) lines.numNodes[i] = 0;
+   quadtree.classifyNodes(frusta, numFrusta, visits);
+   for (i = 0; i < (int)visits.size(); i++)
+   {
+      const QuadtreeNode &square = nodes[visits[i].node];
+	  float west = square.SWCornerX, east = square.SWCornerX + square.size;
+	  float south = square.SWCornerZ, north = square.SWCornerZ - square.size;
+	  float corners[8] = { west, south, west, north, east, north, east, south };
+	  addQuadrilateral(corners, nodeOutcomeColors[visits[i].outcome], lines.vertices);
+	  lines.numNodes[visits[i].outcome]++;
+   }
+   for (i = 0; i < numFrusta; i++)
+      addQuadrilateral(&frusta[i].x1, FRUSTUM_COLORS[i % 2], lines.vertices);
+}
+
+// The lines take the color of their vertices, through the scene's fragment shader.
+void QuadtreeView::setup()
+{
+   glGenBuffers(1, &buffer);
+
+   program = InitShader("linevshader.glsl", "fshader.glsl");
+   positionLoc = glGetAttribLocation(program, "vPosition");
+   colorLoc = glGetAttribLocation(program, "vColor");
+}
+
+// The lines are drawn with the depth test off, so that no asteroid hides them. The attribute arrays
+// enabled here are disabled again, as the scene's program does not use them.
+void QuadtreeView::draw(RenderBackend &backend, const QuadtreeLines &lines)
+{
+   TRACE_SCOPE("QuadtreeView::draw");
+   if (lines.vertices.empty()) return;
+
+   backend.useProgram(program);
+   backend.bindBuffer(GL_ARRAY_BUFFER, buffer);
+   backend.bufferData(GL_ARRAY_BUFFER, lines.vertices.size() * sizeof(LineVertex), lines.vertices.data(), GL_STREAM_DRAW);
+   backend.enableVertexAttribArray(positionLoc);
+   backend.vertexAttribPointer(positionLoc, 3, GL_FLOAT, GL_FALSE, sizeof(LineVertex), 0);
+   backend.enableVertexAttribArray(colorLoc);
+   backend.vertexAttribPointer(colorLoc, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(LineVertex), 3 * sizeof(float));
+
+   backend.disable(GL_DEPTH_TEST);
+   backend.drawArrays(GL_LINES, 0, lines.vertices.size());
+   backend.enable(GL_DEPTH_TEST);
+
+   backend.disableVertexAttribArray(positionLoc);
+   backend.disableVertexAttribArray(colorLoc);
+}
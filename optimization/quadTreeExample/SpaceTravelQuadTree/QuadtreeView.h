@@ -0,0 +1,53 @@
+#ifndef QuadtreeView_30671
+#define QuadtreeView_30671
+
+#include <vector>
+#include <GL/glew.h>
+#include "QuadTree.h"
+#include "RenderBackend.h"
+
+using namespace std;
+
+#define QUADTREE_VIEW_Y 0.0 // Height of the plane the squares and frusta are drawn in.
+
+// Vertex of a line of the view: its position in the world and its color.
+struct LineVertex
+{
+   float x, y, z;
+   unsigned char rgba[4];
+};
+
+// Lines of the debug view of a frame's culling: the outline of each square of the quadtree the
+// traversal for the frame's frusta visits, colored by what it did with it, and the outlines of the
+// frusta themselves, flat in the plane of the field. Squares it did not visit lie within a culled
+// square, which is drawn.
+struct QuadtreeLines
+{
+   vector<LineVertex> vertices; // Pairs, one for each line.
+   int numNodes[NUM_NODE_OUTCOMES]; // Squares of each outcome.
+};
+
+extern const char *nodeOutcomeNames[NUM_NODE_OUTCOMES];
+extern const unsigned char nodeOutcomeColors[NUM_NODE_OUTCOMES][4]; // Color of the squares of each outcome.
+
+// Set lines to those of the traversal of the quadtree for the frusta; visits is left holding the
+// squares visited. The tree must not change meanwhile, so this is done where the culling is.
+void makeQuadtreeLines(Quadtree &quadtree, const Frustum *frusta, int numFrusta, vector<NodeVisit> &visits,
+                       QuadtreeLines &lines);
+
+// Draws the lines of the debug view, all of them uploaded in one buffer and drawn in one call.
+class QuadtreeView
+{
+public:
+   QuadtreeView() { program = buffer = 0; }
+   void setup(); // Make the buffer and shader program; a GL context must be current.
+   void draw(RenderBackend &backend, const QuadtreeLines &lines); // Draw the lines through the backend, over
+                                                                  // what is drawn, with the model-view matrix
+                                                                  // as it is.
+
+private:
+   GLuint program, buffer;
+   GLint positionLoc, colorLoc;
+};
+
+#endif
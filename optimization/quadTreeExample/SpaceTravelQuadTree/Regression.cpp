@@ -0,0 +1,471 @@
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <glm/glm.hpp>
+#include "Regression.h"
+#include "Benchmark.h"
+#include "AsteroidStore.h"
+#include "FieldGenerator.h"
+#include "QuadTree.h"
+#include "SweepAndPrune.h"
+#include "AllocationTracker.h"
+
+using namespace std;
+
+// Return the milliseconds since start.
+static double millisecondsSince(chrono::steady_clock::time_point start)
+{
+   return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// Add to the scenario the metric with the given value in each run, as their median.
+static void addMetric(RegressionScenario &scenario, const char *name, vector<double> runs, int isExact, double tolerance)
+{
+   RegressionMetric metric;
+   sort(runs.begin(), runs.end());
+   metric.name = name;
+   metric.measured = percentile(runs, 0.5);
+   metric.isExact = isExact;
+   metric.hasBaseline = 0;
+   metric.baseline = 0.0;
+   metric.tolerance = tolerance;
+   metric.status = "missing";
+   scenario.metrics.push_back(metric);
+}
+
+// Each run builds a quadtree of its own, so that each allocates as much as a first build does.
+static void runBuildScenario(AsteroidStore &asteroids, float squareX, float squareZ, float squareSize,
+							 RegressionScenario &scenario)
+{
+   vector<double> times, nodes, blocks, numAsteroids;
+   int run;
+   for (run = 0; run < REGRESSION_RUNS; run++)
+   {
+      Quadtree quadtree;
+	  quadtree.setStore(&asteroids);
+	  beginAllocationPhase(ALLOCATION_BUILD);
+	  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	  quadtree.initialize(squareX, squareZ, squareSize);
+	  times.push_back(millisecondsSince(start));
+	  blocks.push_back(allocationCounts(ALLOCATION_BUILD).allocations);
+	  setAllocationPhase(ALLOCATION_SETUP);
+	  nodes.push_back(quadtree.numberNodes());
+	  numAsteroids.push_back(asteroids.size());
+   }
+   addMetric(scenario, "buildMs", times, 0, REGRESSION_TIME_TOLERANCE);
+   addMetric(scenario, "buildBlocks", blocks, 0, 0.0);
+   addMetric(scenario, "nodes", nodes, 1, 0.0);
+   addMetric(scenario, "asteroids", numAsteroids, 1, 0.0);
+}
+
+// As in the benchmark, the frames cull into lists kept from frame to frame, with room for every
+// asteroid, and only the allocations of the frames after the warm-up are counted. The position of
+// the spacecraft at a frame is taken as the center of its bounding sphere.
+static void runPathScenario(AsteroidStore &asteroids, Quadtree &quadtree, const vector<ViewState> &views,
+							int numThreads, RegressionScenario &scenario)
+{
+   vector<double> cullTimes, nodesVisited, tests, numVisible, numDrawnPerFrame, blocks, rayTimes, rayHits, sweepTimes, sweepHits, threads;
+   Frustum frusta[FRAME_VIEWPORTS];
+   vector<int> visible[FRAME_VIEWPORTS];
+   vector<AsteroidDrawCommand> commands[FRAME_VIEWPORTS];
+   vector<int> marks(asteroids.size(), -1), drawnMarks(asteroids.size(), 0);
+   int run, i, k, n = views.size(), mark = 0, drawnMark = 0;
+
+   for (k = 0; k < FRAME_VIEWPORTS; k++)
+   {
+      visible[k].reserve(asteroids.size());
+	  commands[k].reserve(asteroids.size());
+   }
+
+   for (run = 0; run < REGRESSION_RUNS; run++)
+   {
+      double cullTime = 0.0;
+	  long long nodes = 0, numTests = 0, numUnique = 0, numDrawn = 0, numBlocks = 0, hits;
+	  beginAllocationPhase(ALLOCATION_FRAMES);
+	  for (i = 0; i < n; i++)
+	  {
+	     viewFrusta(views[i], frusta);
+		 quadtree.resetCullStats();
+		 AllocationCounts before = allocationCounts(ALLOCATION_FRAMES);
+
+		 chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		 for (k = 0; k < FRAME_VIEWPORTS; k++)
+		 {
+		    visible[k].clear();
+			commands[k].clear();
+		 }
+		 quadtree.collectAsteroids(frusta, FRAME_VIEWPORTS, visible, numThreads);
+		 for (k = 0; k < FRAME_VIEWPORTS; k++)
+		    asteroids.appendDrawCommands(visible[k].data(), visible[k].size(), drawnMarks, drawnMark, commands[k]);
+		 cullTime += millisecondsSince(start);
+
+		 if (i >= BENCHMARK_WARMUP_FRAMES) numBlocks += allocationCounts(ALLOCATION_FRAMES).allocations - before.allocations;
+		 nodes += quadtree.getCullStats().nodesVisited;
+		 numTests += quadtree.getCullStats().tests;
+		 for (k = 0; k < FRAME_VIEWPORTS; k++)
+		 {
+		    numDrawn += commands[k].size();
+			numUnique += numberUnique(visible[k], marks, mark++);
+		 }
+	  }
+	  setAllocationPhase(ALLOCATION_SETUP);
+	  cullTimes.push_back(cullTime / n);
+	  nodesVisited.push_back((double)nodes / n);
+	  tests.push_back((double)numTests / n);
+	  numVisible.push_back((double)numUnique / n);
+	  numDrawnPerFrame.push_back((double)numDrawn / n);
+	  blocks.push_back(numBlocks);
+	  threads.push_back(numThreads);
+
+	  hits = 0;
+	  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	  for (i = 0; i < n; i++)
+	  {
+	     glm::vec3 origin(views[i].x, 0.0, views[i].z);
+		 glm::vec3 direction(-sin(views[i].angle * PI / 180.0), 0.0, -cos(views[i].angle * PI / 180.0));
+		 if (quadtree.raycast(origin, direction, REGRESSION_RAY_LENGTH).asteroid >= 0) hits++;
+	  }
+	  rayTimes.push_back(millisecondsSince(start) * 1000.0 / n);
+	  rayHits.push_back(hits);
+
+	  hits = 0;
+	  start = chrono::steady_clock::now();
+	  for (i = 1; i < n; i++)
+	  {
+	     glm::vec3 from(views[i - 1].x, 0.0, views[i - 1].z), to(views[i].x, 0.0, views[i].z);
+		 if (quadtree.sweepSphere(from, to, REGRESSION_SWEEP_RADIUS).asteroid >= 0) hits++;
+	  }
+	  sweepTimes.push_back(millisecondsSince(start) * 1000.0 / (n - 1));
+	  sweepHits.push_back(hits);
+   }
+   addMetric(scenario, "cullMs", cullTimes, 0, REGRESSION_TIME_TOLERANCE);
+   addMetric(scenario, "nodesVisited", nodesVisited, 0, 0.0);
+   addMetric(scenario, "tests", tests, 0, 0.0);
+   addMetric(scenario, "visible", numVisible, 1, 0.0);
+   addMetric(scenario, "drawn", numDrawnPerFrame, 0, 0.0);
+   addMetric(scenario, "frameBlocks", blocks, 0, 0.0);
+   addMetric(scenario, "rayUs", rayTimes, 0, REGRESSION_TIME_TOLERANCE);
+   addMetric(scenario, "rayHits", rayHits, 1, 0.0);
+   addMetric(scenario, "sweepUs", sweepTimes, 0, REGRESSION_TIME_TOLERANCE);
+   addMetric(scenario, "sweepHits", sweepHits, 1, 0.0);
+   addMetric(scenario, "threads", threads, 1, 0.0);
+}
+
+// The asteroids drift as they do in the program, bouncing off the sides of the field's square, but
+// do not bounce off each other, so that every run, and the pairs it finds, is the same whatever
+// order the broad phase finds them in. Each run starts from the field as generated.
+static void runCollideScenario(AsteroidStore &asteroids, float squareX, float squareZ, float squareSize,
+							   int numThreads, RegressionScenario &scenario)
+{
+   vector<double> tickTimes, numPairs;
+   vector<float> startVelocityX, startVelocityZ, x, z, velocityX, velocityZ;
+   vector<CollisionPair> pairs;
+   mt19937 random(REGRESSION_SEED);
+   uniform_real_distribution<float> speed(-REGRESSION_DRIFT_SPEED, REGRESSION_DRIFT_SPEED);
+   int run, tick, i, n = asteroids.size();
+   float *r = asteroids.r;
+
+   for (i = 0; i < n; i++)
+   {
+      startVelocityX.push_back(speed(random));
+	  startVelocityZ.push_back(speed(random));
+   }
+
+   for (run = 0; run < REGRESSION_RUNS; run++)
+   {
+      SweepAndPrune broadPhase;
+	  long long found = 0;
+	  x.assign(asteroids.cx, asteroids.cx + n);
+	  z.assign(asteroids.cz, asteroids.cz + n);
+	  velocityX = startVelocityX;
+	  velocityZ = startVelocityZ;
+
+	  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	  for (tick = 0; tick < REGRESSION_TICKS; tick++)
+	  {
+	     for (i = 0; i < n; i++)
+		 {
+		    x[i] += velocityX[i];
+			z[i] += velocityZ[i];
+			velocityX[i] = (x[i] - r[i] < squareX || x[i] + r[i] > squareX + squareSize) ? -velocityX[i] : velocityX[i];
+			velocityZ[i] = (z[i] + r[i] > squareZ || z[i] - r[i] < squareZ - squareSize) ? -velocityZ[i] : velocityZ[i];
+		 }
+		 broadPhase.update(x.data(), asteroids.cy, z.data(), r, n);
+		 broadPhase.findCollisions(pairs, numThreads);
+		 found += pairs.size();
+	  }
+	  tickTimes.push_back(millisecondsSince(start) / REGRESSION_TICKS);
+	  numPairs.push_back(found);
+   }
+   addMetric(scenario, "tickMs", tickTimes, 0, REGRESSION_TIME_TOLERANCE);
+   addMetric(scenario, "pairs", numPairs, 1, 0.0);
+}
+
+void runRegression(int numThreads, RegressionReport &report)
+{
+   int sizes[] = REGRESSION_SIZES;
+   int s, numSizes = sizeof(sizes) / sizeof(sizes[0]);
+   vector<ViewState> views;
+
+   report.numThreads = numThreads;
+   report.scenarios.clear();
+   scriptedFlight(REGRESSION_FRAMES, views);
+   startAllocationTracking();
+
+   for (s = 0; s < numSizes; s++)
+   {
+      AsteroidStore asteroids;
+	  Quadtree quadtree;
+	  float firstX, firstZ, squareX, squareZ, squareSize;
+	  RegressionScenario build, path, collide;
+	  ostringstream size;
+	  size << sizes[s];
+	  build.name = "build-" + size.str();
+	  path.name = "path-" + size.str();
+	  collide.name = "collide-" + size.str();
+
+	  cout << "Running the scenarios over " << sizes[s] << " by " << sizes[s] << " asteroids." << endl;
+	  layOutField(sizes[s], sizes[s], REGRESSION_SPACING, ASTEROID_RADIUS, firstX, firstZ, squareX, squareZ, squareSize);
+	  generateField(asteroids, sizes[s], sizes[s], REGRESSION_FILL, REGRESSION_SEED, firstX, firstZ, REGRESSION_SPACING,
+					ASTEROID_RADIUS, numThreads);
+
+	  runBuildScenario(asteroids, squareX, squareZ, squareSize, build);
+	  quadtree.setStore(&asteroids);
+	  quadtree.initialize(squareX, squareZ, squareSize);
+	  runPathScenario(asteroids, quadtree, views, numThreads, path);
+	  runCollideScenario(asteroids, squareX, squareZ, squareSize, numThreads, collide);
+
+	  report.scenarios.push_back(build);
+	  report.scenarios.push_back(path);
+	  report.scenarios.push_back(collide);
+   }
+}
+
+// Return the name of the scenario's baseline file in the directory.
+static string baselineFile(const string &directory, const RegressionScenario &scenario)
+{
+   if (directory.empty()) return scenario.name + ".baseline";
+   return directory + "/" + scenario.name + ".baseline";
+}
+
+// A baseline file has a line "metric = median tolerance" for each metric, the tolerance being a
+// percentage of the median; blank lines and anything after a # are ignored, as are metrics the
+// scenario no longer has.
+void readBaselines(const string &directory, RegressionReport &report)
+{
+   int s, j;
+   report.baselineDir = directory;
+   for (s = 0; s < (int)report.scenarios.size(); s++)
+   {
+      RegressionScenario &scenario = report.scenarios[s];
+	  string fileName = baselineFile(directory, scenario), line;
+	  ifstream file(fileName.c_str());
+	  int lineNumber = 0;
+
+	  if (!file) continue;
+	  while (getline(file, line))
+	  {
+	     lineNumber++;
+		 size_t comment = line.find('#');
+		 if (comment != string::npos) line.erase(comment);
+
+		 string name, equals, rest;
+		 double value, tolerance;
+		 istringstream words(line);
+		 if (!(words >> name)) continue; // Blank line.
+		 if (!(words >> equals >> value >> tolerance) || equals != "=" || tolerance < 0.0 || (words >> rest))
+		 {
+		    cerr << fileName << ", line " << lineNumber << ": expected \"metric = median tolerance\"; ignored." << endl;
+			continue;
+		 }
+		 for (j = 0; j < (int)scenario.metrics.size(); j++)
+		    if (scenario.metrics[j].name == name)
+			{
+			   scenario.metrics[j].hasBaseline = 1;
+			   scenario.metrics[j].baseline = value;
+			   scenario.metrics[j].tolerance = tolerance;
+			}
+	  }
+   }
+}
+
+int judgeRegression(RegressionReport &report)
+{
+   int s, j, numFailed = 0;
+   for (s = 0; s < (int)report.scenarios.size(); s++)
+      for (j = 0; j < (int)report.scenarios[s].metrics.size(); j++)
+	  {
+	     RegressionMetric &metric = report.scenarios[s].metrics[j];
+		 double allowed = fabs(metric.baseline) * metric.tolerance / 100.0, delta = metric.measured - metric.baseline;
+		 if (!metric.hasBaseline) metric.status = "missing";
+		 else if (metric.isExact) metric.status = (fabs(delta) > allowed) ? "changed" : "pass";
+		 else if (delta > allowed) metric.status = "regressed";
+		 else if (delta < -allowed) metric.status = "improved";
+		 else metric.status = "pass";
+		 if (metric.status != "pass" && metric.status != "improved") numFailed++;
+	  }
+   return numFailed;
+}
+
+// Return 1 if every metric of the scenario passes.
+static int isScenarioPassed(const RegressionScenario &scenario)
+{
+   for (int j = 0; j < (int)scenario.metrics.size(); j++)
+      if (scenario.metrics[j].status != "pass" && scenario.metrics[j].status != "improved") return 0;
+   return 1;
+}
+
+// Return the change of the metric from its baseline as a percentage of it, or 0 for a change from 0
+// to 0; the caller must see that it has a baseline other than 0 otherwise.
+static double deltaPercent(const RegressionMetric &metric)
+{
+   if (metric.baseline == 0.0) return 0.0;
+   return 100.0 * (metric.measured - metric.baseline) / fabs(metric.baseline);
+}
+
+// Return 1 if the change of the metric can be given as a percentage.
+static int hasDeltaPercent(const RegressionMetric &metric)
+{
+   return metric.hasBaseline && (metric.baseline != 0.0 || metric.measured == 0.0);
+}
+
+void printRegression(const RegressionReport &report)
+{
+   int s, j, numPassed = 0;
+   cout << "Regression suite: " << REGRESSION_RUNS << " runs of each scenario, " << report.numThreads
+		<< " threads, against the baselines in " << (report.baselineDir.empty() ? "." : report.baselineDir) << "." << endl;
+   for (s = 0; s < (int)report.scenarios.size(); s++)
+   {
+      const RegressionScenario &scenario = report.scenarios[s];
+	  numPassed += isScenarioPassed(scenario);
+	  cout << scenario.name << ": " << (isScenarioPassed(scenario) ? "pass" : "FAIL") << endl;
+	  for (j = 0; j < (int)scenario.metrics.size(); j++)
+	  {
+	     const RegressionMetric &metric = scenario.metrics[j];
+		 cout << "   " << metric.name << " " << metric.measured;
+		 if (metric.hasBaseline)
+		 {
+		    cout << " against " << metric.baseline;
+			if (hasDeltaPercent(metric)) cout << " (" << (deltaPercent(metric) >= 0.0 ? "+" : "") << deltaPercent(metric) << "%";
+			else cout << " (+" << metric.measured - metric.baseline;
+			cout << ", " << (metric.isExact ? "exact" : "lower") << " within " << metric.tolerance << "%)";
+		 }
+		 cout << ": " << metric.status << endl;
+	  }
+   }
+   cout << numPassed << " of " << report.scenarios.size() << " scenarios passed." << endl;
+}
+
+int writeBaselines(const string &directory, const RegressionReport &report)
+{
+   int s, j;
+   for (s = 0; s < (int)report.scenarios.size(); s++)
+   {
+      const RegressionScenario &scenario = report.scenarios[s];
+	  string fileName = baselineFile(directory, scenario);
+	  ofstream out(fileName.c_str());
+	  if (!out)
+	  {
+	     cerr << "Cannot write the baseline " << fileName << "." << endl;
+		 return 0;
+	  }
+	  out.precision(17);
+	  out << "# Baseline of the regression scenario " << scenario.name << ", over " << report.numThreads << " threads:" << endl
+		  << "# metric = median tolerance, the tolerance being the percentage of the median it may change by." << endl;
+	  for (j = 0; j < (int)scenario.metrics.size(); j++)
+	     out << scenario.metrics[j].name << " = " << scenario.metrics[j].measured << " " << scenario.metrics[j].tolerance << endl;
+	  if (!out)
+	  {
+	     cerr << "Cannot write the baseline " << fileName << "." << endl;
+		 return 0;
+	  }
+   }
+   return 1;
+}
+
+// Return the text in double quotes, with what JSON requires escaped.
+static string quoted(const string &text)
+{
+   string result = "\"";
+   for (int i = 0; i < (int)text.size(); i++)
+   {
+      if (text[i] == '"' || text[i] == '\\') result += '\\';
+	  result += text[i];
+   }
+   return result + "\"";
+}
+
+int writeRegressionReport(const RegressionReport &report, const char *fileName)
+{
+   string name = fileName;
+   int isCSV = name.size() >= 4 && name.compare(name.size() - 4, 4, ".csv") == 0;
+   int s, j, isPassed = 1;
+   ofstream out(fileName);
+
+   if (!out)
+   {
+      cerr << "Cannot write the regression report " << fileName << "." << endl;
+	  return 0;
+   }
+   out.precision(9);
+   for (s = 0; s < (int)report.scenarios.size(); s++)
+      if (!isScenarioPassed(report.scenarios[s])) isPassed = 0;
+
+   if (isCSV)
+   {
+      out << "scenario,metric,measured,baseline,delta,delta_percent,tolerance_percent,exact,status" << endl;
+	  for (s = 0; s < (int)report.scenarios.size(); s++)
+	     for (j = 0; j < (int)report.scenarios[s].metrics.size(); j++)
+		 {
+		    const RegressionMetric &metric = report.scenarios[s].metrics[j];
+			out << report.scenarios[s].name << "," << metric.name << "," << metric.measured << ",";
+			if (metric.hasBaseline) out << metric.baseline << "," << metric.measured - metric.baseline;
+			else out << ",";
+			out << ",";
+			if (hasDeltaPercent(metric)) out << deltaPercent(metric);
+			out << "," << metric.tolerance << "," << metric.isExact << "," << metric.status << endl;
+		 }
+   }
+   else
+   {
+      out << "{" << endl
+		  << "  \"passed\": " << (isPassed ? "true" : "false") << "," << endl
+		  << "  \"baselines\": " << quoted(report.baselineDir) << "," << endl
+		  << "  \"threads\": " << report.numThreads << "," << endl
+		  << "  \"runs\": " << REGRESSION_RUNS << "," << endl
+		  << "  \"scenarios\": [" << endl;
+	  for (s = 0; s < (int)report.scenarios.size(); s++)
+	  {
+	     const RegressionScenario &scenario = report.scenarios[s];
+		 out << "    { \"scenario\": " << quoted(scenario.name) << ", \"passed\": " << (isScenarioPassed(scenario) ? "true" : "false")
+			 << ", \"metrics\": [" << endl;
+		 for (j = 0; j < (int)scenario.metrics.size(); j++)
+		 {
+		    const RegressionMetric &metric = scenario.metrics[j];
+			out << "      { \"metric\": " << quoted(metric.name) << ", \"measured\": " << metric.measured << ", \"baseline\": ";
+			if (metric.hasBaseline) out << metric.baseline << ", \"delta\": " << metric.measured - metric.baseline;
+			else out << "null, \"delta\": null";
+			out << ", \"deltaPercent\": ";
+			if (hasDeltaPercent(metric)) out << deltaPercent(metric);
+			else out << "null";
+			out << ", \"tolerancePercent\": " << metric.tolerance << ", \"exact\": " << (metric.isExact ? "true" : "false")
+				<< ", \"status\": " << quoted(metric.status) << " }" << (j + 1 < (int)scenario.metrics.size() ? "," : "") << endl;
+		 }
+		 out << "    ] }" << (s + 1 < (int)report.scenarios.size() ? "," : "") << endl;
+	  }
+	  out << "  ]" << endl
+		  << "}" << endl;
+   }
+
+   if (!out)
+   {
+      cerr << "Cannot write the regression report " << fileName << "." << endl;
+	  return 0;
+   }
+   return 1;
+}
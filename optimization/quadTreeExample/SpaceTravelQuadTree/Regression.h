@@ -0,0 +1,82 @@
+#ifndef Regression_84163
+#define Regression_84163
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define REGRESSION_RUNS 5 // Runs of each scenario; each metric is the median of its runs.
+#define REGRESSION_SEED 1 // Seed of the fields of the scenarios, so every run has the same ones.
+#define REGRESSION_FILL 100 // Fill percentage and ...
+#define REGRESSION_SPACING 30.0 // ... spacing of the fields, which are square, of each of these sizes:
+#define REGRESSION_SIZES { 100, 200, 400 }
+#define REGRESSION_FRAMES 600 // Frames of the scripted flight the queries follow, a full weave.
+#define REGRESSION_RAY_LENGTH 1000.0 // Reach of the ray cast ahead of the spacecraft each frame.
+#define REGRESSION_SWEEP_RADIUS 7.072 // Radius of the sphere swept from each frame's position to the
+                                      // next, the spacecraft's bounding sphere.
+#define REGRESSION_TICKS 60 // Ticks the asteroids drift for in a run of a collision scenario ...
+#define REGRESSION_DRIFT_SPEED 0.25 // ... at speeds along x and z of up to this much a tick.
+#define REGRESSION_TIME_TOLERANCE 25.0 // Percentage a time may grow by before it counts as a regression;
+                                       // the counts of work done may not grow at all. Either is taken
+                                       // from the baseline file if it gives one.
+
+// A measurement of a scenario, against its baseline.
+struct RegressionMetric
+{
+   string name;
+   double measured;  // Median over the runs.
+   int isExact;      // 1 if a change either way is a failure, as the result is wrong; 0 if only growth
+                     // is, as lower is better.
+   int hasBaseline;  // 1 if the baseline file gives the metric, when ...
+   double baseline;  // ... this is its value there ...
+   double tolerance; // ... and this the change allowed, as a percentage of it.
+   string status;    // "pass"; "improved", lower beyond the tolerance, which passes; "regressed",
+                     // higher beyond it; "changed", an exact metric that differs; or "missing".
+};
+
+// A scenario of the suite, with its metrics; its baseline is the file named after it with the
+// extension .baseline in the baseline directory.
+struct RegressionScenario
+{
+   string name;
+   vector<RegressionMetric> metrics;
+};
+
+// Results of a run of the suite.
+struct RegressionReport
+{
+   string baselineDir;
+   int numThreads;
+   vector<RegressionScenario> scenarios;
+};
+
+// Run the scenarios without a window, REGRESSION_RUNS times each, over square fields of
+// REGRESSION_SIZES: for each size, "build-N" builds the quadtree of the field; "path-N" follows the
+// benchmark's scripted flight, each frame culling the frusta of both viewports and making their
+// draw commands, casting a ray ahead of the spacecraft and sweeping its bounding sphere on to the
+// next frame's position; and "collide-N" lets the asteroids drift, finding their collisions each
+// tick with the sweep-and-prune broad phase. Culling and the broad phase use up to numThreads
+// threads. Times are in milliseconds for a build, a frame or a tick and in microseconds for a
+// query; the work done and the results are counted as well, and allocations tracked.
+void runRegression(int numThreads, RegressionReport &report);
+
+// Take the baselines of the report's scenarios from their files in the directory; a scenario with
+// no file has no baselines.
+void readBaselines(const string &directory, RegressionReport &report);
+
+// Set the status of each metric from its measurement and baseline, and return the number that fail.
+int judgeRegression(RegressionReport &report);
+
+void printRegression(const RegressionReport &report); // Print each metric against its baseline.
+
+// Write the measurements of each scenario as its baseline file in the directory, keeping the
+// tolerance of each metric that had one. Return 1 if written, or report the problem and return 0.
+int writeBaselines(const string &directory, const RegressionReport &report);
+
+// Write the report to the file, as CSV, a line for each metric of each scenario, if its name ends
+// in .csv, and otherwise as JSON, with whether each scenario and the whole passed. Return 1 if
+// written, or report the problem and return 0.
+int writeRegressionReport(const RegressionReport &report, const char *fileName);
+
+#endif
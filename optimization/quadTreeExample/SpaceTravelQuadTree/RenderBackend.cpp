@@ -0,0 +1,158 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "RenderBackend.h"
+
+using namespace std;
+
+const char *renderCallNames[NUM_RENDER_CALLS] =
+{
+   "glClear", "glUseProgram", "glBindBuffer", "glBufferData", "glGetAttribLocation",
+   "glEnableVertexAttribArray", "glDisableVertexAttribArray", "glVertexAttribPointer",
+   "glUniform2f", "glUniform1i", "glActiveTexture", "glBindTexture", "glViewport", "glEnable",
+   "glDisable", "glBlendFunc", "glPolygonMode", "glLineWidth", "glDrawArrays", "glLoadIdentity",
+   "glPushMatrix", "glPopMatrix", "glTranslatef", "glRotatef", "glMultMatrixf", "glColor3f",
+   "glColor3ubv", "endFrame"
+};
+
+RecordingBackend::RecordingBackend()
+{
+   memset(counts, 0, sizeof(counts));
+   inFrame = mostInFrame = 0;
+   isWriting = 0;
+}
+
+int RecordingBackend::open(const char *fileName)
+{
+   out.open(fileName, ios::binary);
+   if (!out)
+   {
+      cerr << "Cannot write the calls to " << fileName << "." << endl;
+	  return 0;
+   }
+   this->fileName = fileName;
+   out.write(RECORDING_CALLS_MAGIC, strlen(RECORDING_CALLS_MAGIC));
+   isWriting = 1;
+   return 1;
+}
+
+int RecordingBackend::close()
+{
+   if (!isWriting) return 1;
+   out.close();
+   isWriting = 0;
+   if (!out)
+   {
+      cerr << "Cannot write the calls to " << fileName << "." << endl;
+	  return 0;
+   }
+   return 1;
+}
+
+// Count the call and write its kind; its arguments follow.
+void RecordingBackend::call(RenderCall call)
+{
+   unsigned char kind = (unsigned char)call;
+   counts[call]++;
+   inFrame++;
+   if (isWriting) out.write((const char *)&kind, 1);
+}
+
+void RecordingBackend::printCounts()
+{
+   int i;
+   long long frames = numberFrames(), total = 0;
+   for (i = 0; i < CALL_END_FRAME; i++) total += counts[i];
+   cout << "Recorded " << total << " calls over " << frames << " frames, " << (frames > 0 ? (double)total / frames : 0.0)
+	    << " a frame, at most " << mostInFrame << ":" << endl;
+   for (i = 0; i < CALL_END_FRAME; i++)
+      if (counts[i] > 0)
+	     cout << "   " << renderCallNames[i] << ": " << counts[i] << ", " << (frames > 0 ? (double)counts[i] / frames : 0.0)
+		      << " a frame" << endl;
+}
+
+void RecordingBackend::clear(GLbitfield mask) { call(CALL_CLEAR); putInt(mask); }
+void RecordingBackend::useProgram(GLuint program) { call(CALL_USE_PROGRAM); putInt(program); }
+void RecordingBackend::bindBuffer(GLenum target, GLuint buffer) { call(CALL_BIND_BUFFER); putInt(target); putInt(buffer); }
+
+void RecordingBackend::bufferData(GLenum target, size_t size, const void *data, GLenum usage)
+{
+   call(CALL_BUFFER_DATA);
+   putInt(target);
+   putInt((int)size);
+   if (isWriting) out.write((const char *)data, size);
+   putInt(usage);
+}
+
+// The name is written as its length and its characters; the location given back is 0.
+GLint RecordingBackend::getAttribLocation(GLuint program, const char *name)
+{
+   int length = strlen(name);
+   call(CALL_GET_ATTRIB_LOCATION);
+   putInt(program);
+   putInt(length);
+   if (isWriting) out.write(name, length);
+   return 0;
+}
+
+void RecordingBackend::enableVertexAttribArray(GLuint index) { call(CALL_ENABLE_VERTEX_ATTRIB_ARRAY); putInt(index); }
+void RecordingBackend::disableVertexAttribArray(GLuint index) { call(CALL_DISABLE_VERTEX_ATTRIB_ARRAY); putInt(index); }
+
+void RecordingBackend::vertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride,
+										   size_t offset)
+{
+   call(CALL_VERTEX_ATTRIB_POINTER);
+   putInt(index); putInt(size); putInt(type); putInt(normalized); putInt(stride); putInt((int)offset);
+}
+
+void RecordingBackend::uniform2f(GLint location, float x, float y) { call(CALL_UNIFORM_2F); putInt(location); putFloat(x); putFloat(y); }
+void RecordingBackend::uniform1i(GLint location, GLint value) { call(CALL_UNIFORM_1I); putInt(location); putInt(value); }
+void RecordingBackend::activeTexture(GLenum unit) { call(CALL_ACTIVE_TEXTURE); putInt(unit); }
+void RecordingBackend::bindTexture(GLenum target, GLuint texture) { call(CALL_BIND_TEXTURE); putInt(target); putInt(texture); }
+
+void RecordingBackend::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+   call(CALL_VIEWPORT);
+   putInt(x); putInt(y); putInt(width); putInt(height);
+}
+
+void RecordingBackend::enable(GLenum capability) { call(CALL_ENABLE); putInt(capability); }
+void RecordingBackend::disable(GLenum capability) { call(CALL_DISABLE); putInt(capability); }
+void RecordingBackend::blendFunc(GLenum source, GLenum destination) { call(CALL_BLEND_FUNC); putInt(source); putInt(destination); }
+void RecordingBackend::polygonMode(GLenum face, GLenum mode) { call(CALL_POLYGON_MODE); putInt(face); putInt(mode); }
+void RecordingBackend::lineWidth(float width) { call(CALL_LINE_WIDTH); putFloat(width); }
+void RecordingBackend::drawArrays(GLenum mode, GLint first, GLsizei count) { call(CALL_DRAW_ARRAYS); putInt(mode); putInt(first); putInt(count); }
+void RecordingBackend::loadIdentity() { call(CALL_LOAD_IDENTITY); }
+void RecordingBackend::pushMatrix() { call(CALL_PUSH_MATRIX); }
+void RecordingBackend::popMatrix() { call(CALL_POP_MATRIX); }
+void RecordingBackend::translate(float x, float y, float z) { call(CALL_TRANSLATE); putFloat(x); putFloat(y); putFloat(z); }
+
+void RecordingBackend::rotate(float angle, float x, float y, float z)
+{
+   call(CALL_ROTATE);
+   putFloat(angle); putFloat(x); putFloat(y); putFloat(z);
+}
+
+void RecordingBackend::multMatrix(const float *m)
+{
+   call(CALL_MULT_MATRIX);
+   for (int i = 0; i < 16; i++) putFloat(m[i]);
+}
+
+void RecordingBackend::color3f(float r, float g, float b) { call(CALL_COLOR_3F); putFloat(r); putFloat(g); putFloat(b); }
+
+void RecordingBackend::color3ubv(const unsigned char *rgb)
+{
+   call(CALL_COLOR_3UBV);
+   if (isWriting) out.write((const char *)rgb, 3);
+}
+
+// The frame's calls are totalled before endFrame itself is counted.
+void RecordingBackend::endFrame()
+{
+   if (inFrame > mostInFrame) mostInFrame = inFrame;
+   inFrame = 0;
+   counts[CALL_END_FRAME]++;
+   unsigned char kind = CALL_END_FRAME;
+   if (isWriting) out.write((const char *)&kind, 1);
+}
@@ -0,0 +1,198 @@
+#ifndef RenderBackend_83150
+#define RenderBackend_83150
+
+#include <cstddef>
+#include <string>
+#include <fstream>
+#include <GL/glew.h>
+
+using namespace std;
+
+#define RENDER_GL 0     // Backends: OpenGL, ...
+#define RENDER_NULL 1   // ... one that does nothing, ...
+#define RENDER_RECORD 2 // ... and one that counts each call and writes it out.
+
+// The OpenGL calls a frame is drawn with: drawScene's, AsteroidStore::draw's and TextOverlay::draw's.
+enum RenderCall
+{
+   CALL_CLEAR, CALL_USE_PROGRAM, CALL_BIND_BUFFER, CALL_BUFFER_DATA, CALL_GET_ATTRIB_LOCATION,
+   CALL_ENABLE_VERTEX_ATTRIB_ARRAY, CALL_DISABLE_VERTEX_ATTRIB_ARRAY, CALL_VERTEX_ATTRIB_POINTER,
+   CALL_UNIFORM_2F, CALL_UNIFORM_1I, CALL_ACTIVE_TEXTURE, CALL_BIND_TEXTURE, CALL_VIEWPORT, CALL_ENABLE,
+   CALL_DISABLE, CALL_BLEND_FUNC, CALL_POLYGON_MODE, CALL_LINE_WIDTH, CALL_DRAW_ARRAYS, CALL_LOAD_IDENTITY,
+   CALL_PUSH_MATRIX, CALL_POP_MATRIX, CALL_TRANSLATE, CALL_ROTATE, CALL_MULT_MATRIX, CALL_COLOR_3F,
+   CALL_COLOR_3UBV, CALL_END_FRAME,
+   NUM_RENDER_CALLS
+};
+
+extern const char *renderCallNames[NUM_RENDER_CALLS]; // The OpenGL name of each call, and "endFrame".
+
+// What a frame is drawn through. The drawing code makes its OpenGL calls on a backend rather than
+// directly, so the same frame can be sent to OpenGL, to nothing, which leaves the cost of the
+// program's own code without the driver's, or to a recording of every call. The calls take the
+// arguments of the OpenGL ones.
+class RenderBackend
+{
+public:
+   virtual ~RenderBackend() {}
+   virtual void clear(GLbitfield mask) = 0;
+   virtual void useProgram(GLuint program) = 0;
+   virtual void bindBuffer(GLenum target, GLuint buffer) = 0;
+   virtual void bufferData(GLenum target, size_t size, const void *data, GLenum usage) = 0;
+   virtual GLint getAttribLocation(GLuint program, const char *name) = 0;
+   virtual void enableVertexAttribArray(GLuint index) = 0;
+   virtual void disableVertexAttribArray(GLuint index) = 0;
+   virtual void vertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride,
+                                    size_t offset) = 0; // Offset into the bound buffer.
+   virtual void uniform2f(GLint location, float x, float y) = 0;
+   virtual void uniform1i(GLint location, GLint value) = 0;
+   virtual void activeTexture(GLenum unit) = 0;
+   virtual void bindTexture(GLenum target, GLuint texture) = 0;
+   virtual void viewport(GLint x, GLint y, GLsizei width, GLsizei height) = 0;
+   virtual void enable(GLenum capability) = 0;
+   virtual void disable(GLenum capability) = 0;
+   virtual void blendFunc(GLenum source, GLenum destination) = 0;
+   virtual void polygonMode(GLenum face, GLenum mode) = 0;
+   virtual void lineWidth(float width) = 0;
+   virtual void drawArrays(GLenum mode, GLint first, GLsizei count) = 0;
+   virtual void loadIdentity() = 0;
+   virtual void pushMatrix() = 0;
+   virtual void popMatrix() = 0;
+   virtual void translate(float x, float y, float z) = 0;
+   virtual void rotate(float angle, float x, float y, float z) = 0;
+   virtual void multMatrix(const float *m) = 0;
+   virtual void color3f(float r, float g, float b) = 0;
+   virtual void color3ubv(const unsigned char *rgb) = 0;
+   virtual void endFrame() = 0; // The frame is drawn; makes no OpenGL call.
+};
+
+// Backend passing each call straight to OpenGL.
+class GLBackend : public RenderBackend
+{
+public:
+   void clear(GLbitfield mask) { glClear(mask); }
+   void useProgram(GLuint program) { glUseProgram(program); }
+   void bindBuffer(GLenum target, GLuint buffer) { glBindBuffer(target, buffer); }
+   void bufferData(GLenum target, size_t size, const void *data, GLenum usage) { glBufferData(target, size, data, usage); }
+   GLint getAttribLocation(GLuint program, const char *name) { return glGetAttribLocation(program, name); }
+   void enableVertexAttribArray(GLuint index) { glEnableVertexAttribArray(index); }
+   void disableVertexAttribArray(GLuint index) { glDisableVertexAttribArray(index); }
+   void vertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, size_t offset)
+      { glVertexAttribPointer(index, size, type, normalized, stride, (const void *)offset); }
+   void uniform2f(GLint location, float x, float y) { glUniform2f(location, x, y); }
+   void uniform1i(GLint location, GLint value) { glUniform1i(location, value); }
+   void activeTexture(GLenum unit) { glActiveTexture(unit); }
+   void bindTexture(GLenum target, GLuint texture) { glBindTexture(target, texture); }
+   void viewport(GLint x, GLint y, GLsizei width, GLsizei height) { glViewport(x, y, width, height); }
+   void enable(GLenum capability) { glEnable(capability); }
+   void disable(GLenum capability) { glDisable(capability); }
+   void blendFunc(GLenum source, GLenum destination) { glBlendFunc(source, destination); }
+   void polygonMode(GLenum face, GLenum mode) { glPolygonMode(face, mode); }
+   void lineWidth(float width) { glLineWidth(width); }
+   void drawArrays(GLenum mode, GLint first, GLsizei count) { glDrawArrays(mode, first, count); }
+   void loadIdentity() { glLoadIdentity(); }
+   void pushMatrix() { glPushMatrix(); }
+   void popMatrix() { glPopMatrix(); }
+   void translate(float x, float y, float z) { glTranslatef(x, y, z); }
+   void rotate(float angle, float x, float y, float z) { glRotatef(angle, x, y, z); }
+   void multMatrix(const float *m) { glMultMatrixf(m); }
+   void color3f(float r, float g, float b) { glColor3f(r, g, b); }
+   void color3ubv(const unsigned char *rgb) { glColor3ubv(rgb); }
+   void endFrame() {}
+};
+
+// Backend that does nothing; attribute locations are all 0. It needs no OpenGL context.
+class NullBackend : public RenderBackend
+{
+public:
+   void clear(GLbitfield /*mask*/) {}
+   void useProgram(GLuint /*program*/) {}
+   void bindBuffer(GLenum /*target*/, GLuint /*buffer*/) {}
+   void bufferData(GLenum /*target*/, size_t /*size*/, const void * /*data*/, GLenum /*usage*/) {}
+   GLint getAttribLocation(GLuint /*program*/, const char * /*name*/) { return 0; }
+   void enableVertexAttribArray(GLuint /*index*/) {}
+   void disableVertexAttribArray(GLuint /*index*/) {}
+   void vertexAttribPointer(GLuint /*index*/, GLint /*size*/, GLenum /*type*/, GLboolean /*normalized*/, GLsizei /*stride*/, size_t /*offset*/) {}
+   void uniform2f(GLint /*location*/, float /*x*/, float /*y*/) {}
+   void uniform1i(GLint /*location*/, GLint /*value*/) {}
+   void activeTexture(GLenum /*unit*/) {}
+   void bindTexture(GLenum /*target*/, GLuint /*texture*/) {}
+   void viewport(GLint /*x*/, GLint /*y*/, GLsizei /*width*/, GLsizei /*height*/) {}
+   void enable(GLenum /*capability*/) {}
+   void disable(GLenum /*capability*/) {}
+   void blendFunc(GLenum /*source*/, GLenum /*destination*/) {}
+   void polygonMode(GLenum /*face*/, GLenum /*mode*/) {}
+   void lineWidth(float /*width*/) {}
+   void drawArrays(GLenum /*mode*/, GLint /*first*/, GLsizei /*count*/) {}
+   void loadIdentity() {}
+   void pushMatrix() {}
+   void popMatrix() {}
+   void translate(float /*x*/, float /*y*/, float /*z*/) {}
+   void rotate(float /*angle*/, float /*x*/, float /*y*/, float /*z*/) {}
+   void multMatrix(const float * /*m*/) {}
+   void color3f(float /*r*/, float /*g*/, float /*b*/) {}
+   void color3ubv(const unsigned char * /*rgb*/) {}
+   void endFrame() {}
+};
+
+// Backend that counts the calls of each kind, and of each frame, and, if given a file, writes every
+// call to it. The file starts with RECORDING_CALLS_MAGIC; each call is then a byte, its RenderCall,
+// followed by its arguments in order, each four bytes, an int or a float as the call takes, in the
+// machine's byte order. A matrix is its 16 floats, a color of bytes its 3 bytes, a name its length
+// followed by its characters, and buffer data its size followed by its bytes. It needs no OpenGL context.
+#define RECORDING_CALLS_MAGIC "ASTCALL1"
+
+class RecordingBackend : public RenderBackend
+{
+public:
+   RecordingBackend();
+   int open(const char *fileName); // Write the calls to the file; return 1 if it can be, or report the
+                                   // problem and return 0.
+   int close(); // Finish the file, if any; return 1 if all was written, or report the problem and return 0.
+
+   long long numberCalls(RenderCall call) { return counts[call]; } // Calls of the kind so far.
+   long long numberFrames() { return counts[CALL_END_FRAME]; }
+   long long mostCallsInFrame() { return mostInFrame; } // Calls in the frame with the most, not counting endFrame.
+   void printCounts(); // Print the calls of each kind made, in all and per frame.
+
+   void clear(GLbitfield mask);
+   void useProgram(GLuint program);
+   void bindBuffer(GLenum target, GLuint buffer);
+   void bufferData(GLenum target, size_t size, const void *data, GLenum usage);
+   GLint getAttribLocation(GLuint program, const char *name);
+   void enableVertexAttribArray(GLuint index);
+   void disableVertexAttribArray(GLuint index);
+   void vertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, size_t offset);
+   void uniform2f(GLint location, float x, float y);
+   void uniform1i(GLint location, GLint value);
+   void activeTexture(GLenum unit);
+   void bindTexture(GLenum target, GLuint texture);
+   void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+   void enable(GLenum capability);
+   void disable(GLenum capability);
+   void blendFunc(GLenum source, GLenum destination);
+   void polygonMode(GLenum face, GLenum mode);
+   void lineWidth(float width);
+   void drawArrays(GLenum mode, GLint first, GLsizei count);
+   void loadIdentity();
+   void pushMatrix();
+   void popMatrix();
+   void translate(float x, float y, float z);
+   void rotate(float angle, float x, float y, float z);
+   void multMatrix(const float *m);
+   void color3f(float r, float g, float b);
+   void color3ubv(const unsigned char *rgb);
+   void endFrame();
+
+private:
+   void call(RenderCall call);
+   void putInt(int value) { if (isWriting) out.write((const char *)&value, sizeof(value)); }
+   void putFloat(float value) { if (isWriting) out.write((const char *)&value, sizeof(value)); }
+
+   long long counts[NUM_RENDER_CALLS];
+   long long inFrame, mostInFrame; // Calls in the frame being drawn, and in the frame with the most.
+   ofstream out;
+   string fileName;
+   int isWriting; // Is there a file?
+};
+
+#endif
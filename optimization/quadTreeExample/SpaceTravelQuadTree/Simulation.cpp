@@ -0,0 +1,53 @@
+#include <cstdlib>
+#include <cmath>
+#include "Simulation.h"
+
+using namespace std;
+
+// Add an event at the back of the queue.
+void InputQueue::push(int key, int action)
+{
+   InputEvent event;
+   event.key = key;
+   event.action = action;
+   events.push_back(event);
+}
+
+// Take the event at the front of the queue into event and return 1, or return 0 if the queue is empty.
+int InputQueue::pop(InputEvent &event)
+{
+   if (events.empty()) return 0;
+   event = events.front();
+   events.pop_front();
+   return 1;
+}
+
+// Return the state a fraction alpha of the way from previous to current; the angle is taken the
+// short way round, so that turning through 0 degrees does not swing the craft the long way.
+CraftState interpolateCraft(const CraftState &previous, const CraftState &current, float alpha)
+{
+   CraftState state;
+   float turn = current.angle - previous.angle;
+   if (turn > 180.0) turn -= 360.0;
+   if (turn < -180.0) turn += 360.0;
+
+   state.x = previous.x + alpha * (current.x - previous.x);
+   state.z = previous.z + alpha * (current.z - previous.z);
+   state.angle = previous.angle + alpha * turn;
+   if (state.angle > 360.0) state.angle -= 360.0;
+   if (state.angle < 0.0) state.angle += 360.0;
+   return state;
+}
+
+// Add elapsed seconds to the accumulated time and return the number of whole ticks now due,
+// taking them off the accumulated time. If more than MAX_TICKS_PER_FRAME are due the rest are
+// dropped rather than run late.
+int SimulationClock::advance(double elapsed)
+{
+   int ticks;
+   accumulator += elapsed;
+   ticks = (int)floor(accumulator / tick);
+   accumulator -= ticks * tick;
+   if (ticks > MAX_TICKS_PER_FRAME) ticks = MAX_TICKS_PER_FRAME;
+   return ticks;
+}
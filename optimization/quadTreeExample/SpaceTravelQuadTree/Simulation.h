@@ -0,0 +1,56 @@
+#ifndef Simulation_60417
+#define Simulation_60417
+
+#include <deque>
+
+using namespace std;
+
+#define SIMULATION_TICK (1.0 / 60.0) // Length of a simulation tick in seconds.
+#define MAX_TICKS_PER_FRAME 8 // At most this many ticks are run to catch up before a frame is drawn, 
+                              // so a slow frame cannot make the simulation fall further and further behind.
+
+// Key event as delivered by the window system, queued until the next simulation tick.
+struct InputEvent
+{
+   int key;
+   int action;
+};
+
+// Queue of key events between the window system's callbacks and the simulation.
+class InputQueue
+{
+public:
+   void push(int key, int action); // Add an event at the back of the queue.
+   int pop(InputEvent &event); // Take the event at the front of the queue into event and return 1,
+                               // or return 0 if the queue is empty.
+private:
+   deque<InputEvent> events;
+};
+
+// State of the spacecraft at a tick: the center of the base at (x, 0, z), aligned at angle 
+// degrees to the -z direction.
+struct CraftState
+{
+   float x, z, angle;
+};
+
+// Return the state a fraction alpha of the way from previous to current; the angle is taken 
+// the short way round.
+CraftState interpolateCraft(const CraftState &previous, const CraftState &current, float alpha);
+
+// Fixed-timestep clock. The time passed to advance is accumulated and paid out in whole ticks,
+// so that the simulation advances by the same amount per tick however fast frames are drawn; 
+// what is left over, as a fraction of a tick, tells the renderer how far to interpolate between
+// the states of the last two ticks.
+class SimulationClock
+{
+public:
+   SimulationClock(double tick) { this->tick = tick; accumulator = 0.0; }
+   int advance(double elapsed); // Add elapsed seconds and return the number of ticks now due.
+   float alpha() { return accumulator / tick; } // Fraction of a tick since the last tick.
+   double getTick() { return tick; }
+private:
+   double tick, accumulator;
+};
+
+#endif
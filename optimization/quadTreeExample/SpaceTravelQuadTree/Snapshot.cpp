@@ -0,0 +1,225 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "Snapshot.h"
+
+using namespace std;
+
+static const char SNAPSHOT_MAGIC[8] = "ASTSNAP";
+
+// Return the offset of a section of the given length starting at the next aligned offset from
+// offset, and move offset to its end.
+static long long placeSection(long long &offset, long long length)
+{
+   long long start = (offset + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+   offset = start + length;
+   return start;
+}
+
+// Write the section at its offset, padding with zeroes from the current position.
+static void writeSection(ofstream &out, long long offset, const void *data, long long length)
+{
+   static const char zeroes[SNAPSHOT_ALIGNMENT] = { 0 };
+   out.write(zeroes, offset - (long long)out.tellp());
+   out.write((const char *)data, length);
+}
+
+int saveSnapshot(const char *fileName, SnapshotHeader header, AsteroidStore &asteroids, Quadtree &tree,
+				 const glm::vec3 *vertices, int numVertices)
+{
+   long long n, offset = sizeof(SnapshotHeader);
+
+   memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+   header.version = SNAPSHOT_VERSION;
+   header.nodeBytes = sizeof(QuadtreeNode);
+   header.minY = tree.getMinY();
+   header.maxY = tree.getMaxY();
+   header.numAsteroids = asteroids.size();
+   header.numNodes = tree.numberNodes();
+   header.numListed = tree.numberListed();
+   header.numVertices = numVertices;
+
+   n = header.numAsteroids;
+   header.offsetX = placeSection(offset, n * sizeof(float));
+   header.offsetY = placeSection(offset, n * sizeof(float));
+   header.offsetZ = placeSection(offset, n * sizeof(float));
+   header.offsetR = placeSection(offset, n * sizeof(float));
+   header.offsetRGB = placeSection(offset, n * 3);
+   header.offsetSlot = placeSection(offset, n * sizeof(int));
+   header.offsetNodes = placeSection(offset, (long long)header.numNodes * sizeof(QuadtreeNode));
+   header.offsetLists = placeSection(offset, (long long)header.numListed * sizeof(int));
+   header.offsetVertices = placeSection(offset, (long long)numVertices * sizeof(glm::vec3));
+   header.fileSize = offset;
+
+   ofstream out(fileName, ios::binary | ios::trunc);
+   if (!out)
+   {
+      cerr << "Cannot create snapshot file " << fileName << "." << endl;
+	  return 0;
+   }
+   out.write((const char *)&header, sizeof(header));
+   writeSection(out, header.offsetX, asteroids.cx, n * sizeof(float));
+   writeSection(out, header.offsetY, asteroids.cy, n * sizeof(float));
+   writeSection(out, header.offsetZ, asteroids.cz, n * sizeof(float));
+   writeSection(out, header.offsetR, asteroids.r, n * sizeof(float));
+   writeSection(out, header.offsetRGB, asteroids.rgb, n * 3);
+   writeSection(out, header.offsetSlot, asteroids.getSlots(), n * sizeof(int));
+   writeSection(out, header.offsetNodes, tree.getNodes(), (long long)header.numNodes * sizeof(QuadtreeNode));
+   writeSection(out, header.offsetLists, tree.getAsteroidLists(), (long long)header.numListed * sizeof(int));
+   writeSection(out, header.offsetVertices, vertices, (long long)numVertices * sizeof(glm::vec3));
+   out.close();
+   if (!out)
+   {
+      cerr << "Cannot write snapshot file " << fileName << "." << endl;
+	  return 0;
+   }
+   return 1;
+}
+
+Snapshot::Snapshot()
+{
+   base = NULL;
+   length = 0;
+   file = mapping = NULL;
+}
+
+// Return 1 if the section of count items of the given size at offset lies within the file and is
+// aligned, otherwise 0.
+static int checkSection(const SnapshotHeader &header, long long offset, long long count, long long size)
+{
+   return count >= 0 && offset % SNAPSHOT_ALIGNMENT == 0 && offset >= (long long)sizeof(SnapshotHeader) &&
+          offset + count * size <= header.fileSize;
+}
+
+// Return 1 if the tree in the snapshot, whose sections lie in the file, can be walked without going
+// outside them, otherwise 0: each square's children must come after it in the array of nodes, which
+// rules out cycles, and all four be in it, each leaf's stretch must lie in the list of asteroid ids,
+// and each id listed must be that of an asteroid. It takes a pass over the nodes and one over the
+// list, and changes nothing.
+static int checkTree(const SnapshotHeader &header, const char *base)
+{
+   const QuadtreeNode *nodes = (const QuadtreeNode *)(base + header.offsetNodes);
+   const int *lists = (const int *)(base + header.offsetLists);
+   long long i;
+
+   for (i = 0; i < header.numNodes; i++)
+   {
+      const QuadtreeNode &square = nodes[i];
+	  if (square.firstChild >= 0)
+	  {
+	     if (square.firstChild <= i || square.firstChild + 3LL >= header.numNodes) return 0;
+	  }
+	  else if (square.firstChild != -1 || square.firstAsteroid < 0 || square.numAsteroids < 0 ||
+			   (long long)square.firstAsteroid + square.numAsteroids > header.numListed)
+	     return 0;
+   }
+   for (i = 0; i < header.numListed; i++)
+      if (lists[i] < 0 || lists[i] >= header.numAsteroids) return 0;
+   return 1;
+}
+
+int Snapshot::open(const char *fileName)
+{
+   close();
+
+#ifdef _WIN32
+   HANDLE fileHandle = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+   LARGE_INTEGER fileLength;
+   if (fileHandle == INVALID_HANDLE_VALUE || !GetFileSizeEx(fileHandle, &fileLength))
+   {
+      if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+      cerr << "Cannot open snapshot file " << fileName << "." << endl;
+	  return 0;
+   }
+   file = fileHandle;
+   length = (size_t)fileLength.QuadPart;
+   if (length >= sizeof(SnapshotHeader))
+   {
+      mapping = CreateFileMappingA(fileHandle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	  if (mapping != NULL) base = (char *)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+   }
+#else
+   int descriptor = ::open(fileName, O_RDONLY);
+   struct stat status;
+   if (descriptor < 0 || fstat(descriptor, &status) != 0)
+   {
+      if (descriptor >= 0) ::close(descriptor);
+      cerr << "Cannot open snapshot file " << fileName << "." << endl;
+	  return 0;
+   }
+   length = status.st_size;
+   if (length >= sizeof(SnapshotHeader))
+   {
+      void *address = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+	  if (address != MAP_FAILED) base = (char *)address;
+   }
+   ::close(descriptor); // The mapping stays without it.
+#endif
+
+   if (base == NULL)
+   {
+      cerr << "Cannot map snapshot file " << fileName << "." << endl;
+	  close();
+	  return 0;
+   }
+
+   const SnapshotHeader &header = getHeader();
+   if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.version != SNAPSHOT_VERSION ||
+	   header.nodeBytes != sizeof(QuadtreeNode))
+   {
+      cerr << fileName << " is not a snapshot, or is of another version or build." << endl;
+	  close();
+	  return 0;
+   }
+   if (header.fileSize != (long long)length || header.numNodes < 1 ||
+	   !checkSection(header, header.offsetX, header.numAsteroids, sizeof(float)) ||
+	   !checkSection(header, header.offsetY, header.numAsteroids, sizeof(float)) ||
+	   !checkSection(header, header.offsetZ, header.numAsteroids, sizeof(float)) ||
+	   !checkSection(header, header.offsetR, header.numAsteroids, sizeof(float)) ||
+	   !checkSection(header, header.offsetRGB, header.numAsteroids, 3) ||
+	   !checkSection(header, header.offsetSlot, header.numAsteroids, sizeof(int)) ||
+	   !checkSection(header, header.offsetNodes, header.numNodes, sizeof(QuadtreeNode)) ||
+	   !checkSection(header, header.offsetLists, header.numListed, sizeof(int)) ||
+	   !checkSection(header, header.offsetVertices, header.numVertices, sizeof(glm::vec3)) ||
+	   !checkTree(header, base))
+   {
+      cerr << "Snapshot file " << fileName << " is damaged." << endl;
+	  close();
+	  return 0;
+   }
+   return 1;
+}
+
+void Snapshot::close()
+{
+#ifdef _WIN32
+   if (base != NULL) UnmapViewOfFile(base);
+   if (mapping != NULL) CloseHandle((HANDLE)mapping);
+   if (file != NULL) CloseHandle((HANDLE)file);
+#else
+   if (base != NULL) munmap(base, length);
+#endif
+   base = NULL;
+   length = 0;
+   file = mapping = NULL;
+}
+
+void Snapshot::attach(AsteroidStore &asteroids, Quadtree &tree)
+{
+   const SnapshotHeader &header = getHeader();
+   asteroids.attach(header.numAsteroids, header.columns, (float *)(base + header.offsetX), (float *)(base + header.offsetY),
+      (float *)(base + header.offsetZ), (float *)(base + header.offsetR), (unsigned char *)(base + header.offsetRGB),
+	  (int *)(base + header.offsetSlot));
+   tree.attach((QuadtreeNode *)(base + header.offsetNodes), header.numNodes, (int *)(base + header.offsetLists),
+	  header.numListed, header.minY, header.maxY);
+}
@@ -0,0 +1,63 @@
+#ifndef Snapshot_30962
+#define Snapshot_30962
+
+#include <glm/glm.hpp>
+#include "AsteroidStore.h"
+#include "QuadTree.h"
+
+using namespace std;
+
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_ALIGNMENT 64 // Each section of a snapshot starts at a multiple of this many bytes.
+
+// Header at the start of a snapshot file. The sections follow at the given offsets from the start 
+// of the file: the arrays of the asteroid store, the nodes and lists of asteroid ids of the built
+// quadtree, and the vertex data. The tree refers to nodes and asteroids by index, so nothing in
+// the file depends on where it is loaded. The file is for the kind of machine and build that wrote
+// it: the byte order and the layout of a node are those of the writer.
+struct SnapshotHeader
+{
+   char magic[8];              // "ASTSNAP" and a zero byte.
+   unsigned int version;       // SNAPSHOT_VERSION of the writer.
+   unsigned int nodeBytes;     // sizeof(QuadtreeNode) of the writer.
+   int rows, columns, fillProbability; // Settings the field was generated with.
+   float spacing;
+   unsigned seed;
+   float fieldX, fieldZ, fieldSize; // SW corner and side of the square bounding the field.
+   float minY, maxY;           // Vertical extent of the field.
+   int numAsteroids, numNodes, numListed, numVertices;
+   long long offsetX, offsetY, offsetZ, offsetR, offsetRGB, offsetSlot; // Sections of the store.
+   long long offsetNodes, offsetLists; // Sections of the quadtree.
+   long long offsetVertices;
+   long long fileSize;
+};
+
+// Write a snapshot of the field to the file: header gives the settings and the square bounding
+// the field, the rest is filled in here. Return 1 if done, or report the problem and return 0.
+int saveSnapshot(const char *fileName, SnapshotHeader header, AsteroidStore &asteroids, Quadtree &tree,
+                 const glm::vec3 *vertices, int numVertices);
+
+// A snapshot mapped into memory, copy-on-write, so that the store and tree attached to it can be 
+// used in place with no reading, parsing or fixing up of pointers; pages are read in by the
+// system as they are first touched, and a page written to, e.g. by drifting asteroids, becomes a
+// private copy, leaving the file as it was.
+class Snapshot
+{
+public:
+   Snapshot();
+   ~Snapshot() { close(); }
+   int open(const char *fileName); // Map the file and check its header, and that its tree stays within
+                                   // the file; return 1 if it can be used, or report the problem and
+                                   // return 0.
+   void close(); // Unmap the file; a store and tree attached to it must no longer be used.
+   const SnapshotHeader &getHeader() { return *(SnapshotHeader *)base; }
+   void attach(AsteroidStore &asteroids, Quadtree &tree); // Attach the store and tree to the snapshot.
+   const glm::vec3 *getVertices() { return (glm::vec3 *)(base + getHeader().offsetVertices); }
+
+private:
+   char *base; // Start of the mapped file, NULL if none.
+   size_t length;
+   void *file, *mapping; // Handles of the file and the mapping on Windows.
+};
+
+#endif
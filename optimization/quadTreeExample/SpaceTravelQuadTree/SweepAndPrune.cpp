@@ -0,0 +1,196 @@
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <xmmintrin.h>
+#include "SweepAndPrune.h"
+
+using namespace std;
+
+// Take the current positions and radii of the n spheres and re-sort them on band and then on the
+// low end of their extent along x. The order left by the previous update is the starting point, so
+// for spheres that moved only a little this insertion sort does close to linear work; if the number 
+// of spheres or the largest radius changed the order is rebuilt from scratch.
+void SweepAndPrune::update(const float *x, const float *y, const float *z, const float *r, int n)
+{
+   int i, j, index;
+   float maxR = 0.0;
+   this->x = x; this->y = y; this->z = z; this->r = r;
+
+   for (i = 0; i < n; i++)
+      if (r[i] > maxR) maxR = r[i];
+
+   minX.resize(n);
+   band.resize(n);
+   for (i = 0; i < n; i++)
+      minX[i] = x[i] - r[i];
+
+   if (n != numSpheres || 2.0 * maxR > bandHeight || 4.0 * maxR < bandHeight)
+   {
+      numSpheres = n;
+      bandHeight = (maxR > 0.0) ? 2.0 * maxR : 1.0;
+      for (i = 0; i < n; i++)
+         band[i] = (int)floor(z[i] / bandHeight);
+      order.resize(n);
+      for (i = 0; i < n; i++) order[i] = i;
+      sort(order.begin(), order.end(), [this](int a, int b) 
+         { return band[a] < band[b] || (band[a] == band[b] && minX[a] < minX[b]); });
+   }
+   else
+   {
+      for (i = 0; i < n; i++)
+         band[i] = (int)floor(z[i] / bandHeight);
+      for (i = 1; i < n; i++)
+      {
+         index = order[i];
+         for (j = i; j > 0 && (band[order[j-1]] > band[index] || 
+                               (band[order[j-1]] == band[index] && minX[order[j-1]] > minX[index])); j--) 
+            order[j] = order[j-1];
+         order[j] = index;
+      }
+   }
+
+   // Lay out the values the sweep reads in sorted order, and find where each band starts.
+   sortedMinX.resize(n); sortedMaxX.resize(n); sortedZ.resize(n); sortedR.resize(n);
+   bandStart.clear();
+   for (i = 0; i < n; i++)
+   {
+      index = order[i];
+      sortedMinX[i] = minX[index];
+      sortedMaxX[i] = x[index] + r[index];
+      sortedZ[i] = z[index];
+      sortedR[i] = r[index];
+      if (i == 0 || band[index] != band[order[i-1]]) bandStart.push_back(i);
+   }
+   bandStart.push_back(n);
+}
+
+// Add the pairs of spheres overlapping along x and z with one sphere from sorted positions begin to
+// end - 1 and the other from otherBegin to otherEnd - 1, both ranges sorted on minX. If the ranges
+// are the same each sphere is paired with those after it whose extent along x starts before its own
+// ends; otherwise the two ranges are merged on minX and each sphere is paired with the spheres of 
+// the other range that start after it and before its end.
+void SweepAndPrune::sweep(int begin, int end, int otherBegin, int otherEnd, vector<CollisionPair> &pairs)
+{
+   int i, j, k;
+   CollisionPair pair;
+
+   if (begin == otherBegin)
+   {
+      for (i = begin; i < end; i++)
+         for (j = i + 1; j < end && sortedMinX[j] <= sortedMaxX[i]; j++)
+            if ( fabs(sortedZ[i] - sortedZ[j]) <= sortedR[i] + sortedR[j] )
+            {
+               pair.first = order[i]; pair.second = order[j];
+               pairs.push_back(pair);
+            }
+      return;
+   }
+
+   i = begin; j = otherBegin;
+   while (i < end && j < otherEnd)
+   {
+      if (sortedMinX[i] <= sortedMinX[j])
+      {
+         for (k = j; k < otherEnd && sortedMinX[k] <= sortedMaxX[i]; k++)
+            if ( fabs(sortedZ[i] - sortedZ[k]) <= sortedR[i] + sortedR[k] )
+            {
+               pair.first = order[i]; pair.second = order[k];
+               pairs.push_back(pair);
+            }
+         i++;
+      }
+      else
+      {
+         for (k = i; k < end && sortedMinX[k] <= sortedMaxX[j]; k++)
+            if ( fabs(sortedZ[j] - sortedZ[k]) <= sortedR[j] + sortedR[k] )
+            {
+               pair.first = order[k]; pair.second = order[j];
+               pairs.push_back(pair);
+            }
+         j++;
+      }
+   }
+}
+
+// Broad and narrow phase for the occupied bands firstBand to lastBand - 1: each band is swept
+// against itself and against the band above it if that is occupied. Candidates are confirmed
+// after every band so that the candidate list stays small.
+void SweepAndPrune::sweepBands(int firstBand, int lastBand, vector<CollisionPair> &pairs)
+{
+   int b, unconfirmed;
+
+   for (b = firstBand; b < lastBand; b++)
+   {
+      unconfirmed = pairs.size();
+      sweep(bandStart[b], bandStart[b+1], bandStart[b], bandStart[b+1], pairs);
+      if ( b + 2 < (int)bandStart.size() && 
+           band[order[bandStart[b+1]]] == band[order[bandStart[b]]] + 1 )
+         sweep(bandStart[b], bandStart[b+1], bandStart[b+1], bandStart[b+2], pairs);
+      confirm(pairs, unconfirmed);
+   }
+}
+
+// Narrow phase: of the pairs from position begin on keep those whose spheres intersect, compacting
+// them in place. Four pairs are tested at once with SSE; the last few one at a time.
+void SweepAndPrune::confirm(vector<CollisionPair> &pairs, int begin)
+{
+   int i, k, mask, kept = begin, n = pairs.size();
+   CollisionPair *p = pairs.data();
+
+   for (i = begin; i + 4 <= n; i += 4)
+   {
+      __m128 dx = _mm_sub_ps(_mm_setr_ps(x[p[i].first], x[p[i+1].first], x[p[i+2].first], x[p[i+3].first]),
+                             _mm_setr_ps(x[p[i].second], x[p[i+1].second], x[p[i+2].second], x[p[i+3].second]));
+      __m128 dy = _mm_sub_ps(_mm_setr_ps(y[p[i].first], y[p[i+1].first], y[p[i+2].first], y[p[i+3].first]),
+                             _mm_setr_ps(y[p[i].second], y[p[i+1].second], y[p[i+2].second], y[p[i+3].second]));
+      __m128 dz = _mm_sub_ps(_mm_setr_ps(z[p[i].first], z[p[i+1].first], z[p[i+2].first], z[p[i+3].first]),
+                             _mm_setr_ps(z[p[i].second], z[p[i+1].second], z[p[i+2].second], z[p[i+3].second]));
+      __m128 rr = _mm_add_ps(_mm_setr_ps(r[p[i].first], r[p[i+1].first], r[p[i+2].first], r[p[i+3].first]),
+                             _mm_setr_ps(r[p[i].second], r[p[i+1].second], r[p[i+2].second], r[p[i+3].second]));
+      __m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+      mask = _mm_movemask_ps(_mm_cmple_ps(distanceSquared, _mm_mul_ps(rr, rr)));
+      for (k = 0; k < 4; k++)
+         if (mask & (1 << k)) p[kept++] = p[i + k];
+   }
+
+   for (; i < n; i++)
+   {
+      float dx = x[p[i].first] - x[p[i].second];
+      float dy = y[p[i].first] - y[p[i].second];
+      float dz = z[p[i].first] - z[p[i].second];
+      float rr = r[p[i].first] + r[p[i].second];
+      if (dx*dx + dy*dy + dz*dz <= rr*rr) p[kept++] = p[i];
+   }
+
+   pairs.resize(kept);
+}
+
+// Fill pairs with the intersecting pairs of spheres as of the last update. The occupied bands are
+// split into equal ranges, one for each thread, swept each into its own list, and the lists are 
+// appended in range order afterwards so that the result does not depend on the number of threads.
+// The threads are those of a pool kept from call to call, as the sweep runs every tick. Small sets
+// of spheres are swept on the calling thread alone.
+void SweepAndPrune::findCollisions(vector<CollisionPair> &pairs, int numThreads)
+{
+   int t, numBands = bandStart.size() - 1;
+   pairs.clear();
+   if (numSpheres == 0) return;
+   if (numThreads < 1 || numSpheres < SAP_SERIAL_THRESHOLD) numThreads = 1;
+   if (numThreads > numBands) numThreads = numBands;
+
+   if (numThreads == 1)
+   {
+      sweepBands(0, numBands, pairs);
+      return;
+   }
+
+   threadPairs.resize(numThreads);
+   auto sweepRange = [&](int t)
+   {
+      threadPairs[t].clear();
+      sweepBands(numBands * t / numThreads, numBands * (t + 1) / numThreads, threadPairs[t]);
+   };
+   sweepWorkers.run(numThreads, numThreads, sweepRange);
+   for (t = 0; t < numThreads; t++)
+      pairs.insert(pairs.end(), threadPairs[t].begin(), threadPairs[t].end());
+}
@@ -0,0 +1,57 @@
+#ifndef SweepAndPrune_57312
+#define SweepAndPrune_57312
+
+#include <vector>
+#include "WorkerPool.h"
+
+using namespace std;
+
+#define SAP_SERIAL_THRESHOLD 4096 // Below this many spheres the sweep runs on the calling thread only.
+
+// A pair of spheres, given by their indices into the arrays passed to SweepAndPrune::update.
+struct CollisionPair
+{
+   int first, second;
+};
+
+// Sweep-and-prune broad phase for moving spheres. The plane is cut into bands along z at least
+// as high as the largest sphere is wide, so that spheres can only touch spheres of their own or
+// a neighbouring band, and the spheres are kept sorted on their band and then on the low end of
+// their extent along x. Sorting on x alone would degenerate for the asteroid field, whose columns
+// share the same x. As spheres move only a little between updates the previous order is nearly
+// sorted and re-sorting it by insertion takes close to linear time. A sweep of each band against
+// itself and the next band yields the pairs overlapping along x and z, and a narrow phase four
+// pairs at a time with SSE keeps the pairs whose spheres actually intersect.
+class SweepAndPrune
+{
+public:
+   SweepAndPrune() { numSpheres = 0; bandHeight = 0.0; }
+   void update(const float *x, const float *y, const float *z, // Take the current positions and radii of
+               const float *r, int n);                         // the n spheres and re-sort them.
+
+   void findCollisions(vector<CollisionPair> &pairs, // Fill pairs with the intersecting pairs of spheres,
+                       int numThreads);              // splitting the sweep among up to numThreads threads.
+
+private:
+   void sweepBands(int firstBand, int lastBand,    // Broad and narrow phase for the bands firstBand to
+                   vector<CollisionPair> &pairs);  // lastBand - 1 (indices into bandStart).
+   void sweep(int begin, int end, int otherBegin, // Add the pairs of overlapping spheres, one from sorted 
+              int otherEnd, vector<CollisionPair> &pairs); // positions begin to end - 1 and one from otherBegin
+                                                           // to otherEnd - 1; the same range for both means
+                                                           // the pairs within one band.
+   void confirm(vector<CollisionPair> &pairs, int begin); // Narrow phase: keep the pairs from position begin on
+                                                          // whose spheres intersect, four at a time.
+
+   int numSpheres;
+   float bandHeight;
+   const float *x, *y, *z, *r;  // Positions and radii of the spheres (owned by the caller).
+   vector<int> order;           // Sphere indices sorted on band and then minX.
+   vector<int> band;            // Band of each sphere, by sphere index.
+   vector<float> minX;          // Low end of each sphere's extent along x, by sphere index.
+   vector<float> sortedMinX, sortedMaxX, sortedZ, sortedR; // The same values in sorted order, for the sweep.
+   vector<int> bandStart;       // Sorted position of the first sphere of each occupied band, plus numSpheres.
+   vector< vector<CollisionPair> > threadPairs; // Output of each thread, merged after the sweep.
+   WorkerPool sweepWorkers; // Threads of the sweep, kept from call to call.
+};
+
+#endif
@@ -0,0 +1,159 @@
+#include <cstdlib>
+#include <GL/glew.h>
+#include <GL/glfw3.h>
+#include "TextOverlay.h"
+#include "Trace.h"
+
+using namespace std;
+
+GLuint InitShader(const char* vShaderFile, const char* fShaderFile);
+
+// The font: for each character from space to ~ its five columns, left to right, each a byte with
+// the top row in bit 0.
+static const unsigned char FONT_COLUMNS[TEXT_NUM_CHARS][5] = {
+   { 0x00, 0x00, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x5F, 0x00, 0x00 }, { 0x00, 0x07, 0x00, 0x07, 0x00 }, // space ! "
+   { 0x14, 0x7F, 0x14, 0x7F, 0x14 }, { 0x24, 0x2A, 0x7F, 0x2A, 0x12 }, { 0x23, 0x13, 0x08, 0x64, 0x62 }, // # $ %
+   { 0x36, 0x49, 0x56, 0x20, 0x50 }, { 0x00, 0x08, 0x07, 0x03, 0x00 }, { 0x00, 0x1C, 0x22, 0x41, 0x00 }, // & ' (
+   { 0x00, 0x41, 0x22, 0x1C, 0x00 }, { 0x2A, 0x1C, 0x7F, 0x1C, 0x2A }, { 0x08, 0x08, 0x3E, 0x08, 0x08 }, // ) * +
+   { 0x00, 0x80, 0x70, 0x30, 0x00 }, { 0x08, 0x08, 0x08, 0x08, 0x08 }, { 0x00, 0x00, 0x60, 0x60, 0x00 }, // , - .
+   { 0x20, 0x10, 0x08, 0x04, 0x02 }, { 0x3E, 0x51, 0x49, 0x45, 0x3E }, { 0x00, 0x42, 0x7F, 0x40, 0x00 }, // / 0 1
+   { 0x72, 0x49, 0x49, 0x49, 0x46 }, { 0x21, 0x41, 0x49, 0x4D, 0x33 }, { 0x18, 0x14, 0x12, 0x7F, 0x10 }, // 2 3 4
+   { 0x27, 0x45, 0x45, 0x45, 0x39 }, { 0x3C, 0x4A, 0x49, 0x49, 0x31 }, { 0x41, 0x21, 0x11, 0x09, 0x07 }, // 5 6 7
+   { 0x36, 0x49, 0x49, 0x49, 0x36 }, { 0x46, 0x49, 0x49, 0x29, 0x1E }, { 0x00, 0x00, 0x14, 0x00, 0x00 }, // 8 9 :
+   { 0x00, 0x40, 0x34, 0x00, 0x00 }, { 0x00, 0x08, 0x14, 0x22, 0x41 }, { 0x14, 0x14, 0x14, 0x14, 0x14 }, // ; < =
+   { 0x00, 0x41, 0x22, 0x14, 0x08 }, { 0x02, 0x01, 0x59, 0x09, 0x06 }, { 0x3E, 0x41, 0x5D, 0x59, 0x4E }, // > ? @
+   { 0x7C, 0x12, 0x11, 0x12, 0x7C }, { 0x7F, 0x49, 0x49, 0x49, 0x36 }, { 0x3E, 0x41, 0x41, 0x41, 0x22 }, // A B C
+   { 0x7F, 0x41, 0x41, 0x41, 0x3E }, { 0x7F, 0x49, 0x49, 0x49, 0x41 }, { 0x7F, 0x09, 0x09, 0x09, 0x01 }, // D E F
+   { 0x3E, 0x41, 0x41, 0x51, 0x73 }, { 0x7F, 0x08, 0x08, 0x08, 0x7F }, { 0x00, 0x41, 0x7F, 0x41, 0x00 }, // G H I
+   { 0x20, 0x40, 0x41, 0x3F, 0x01 }, { 0x7F, 0x08, 0x14, 0x22, 0x41 }, { 0x7F, 0x40, 0x40, 0x40, 0x40 }, // J K L
+   { 0x7F, 0x02, 0x1C, 0x02, 0x7F }, { 0x7F, 0x04, 0x08, 0x10, 0x7F }, { 0x3E, 0x41, 0x41, 0x41, 0x3E }, // M N O
+   { 0x7F, 0x09, 0x09, 0x09, 0x06 }, { 0x3E, 0x41, 0x51, 0x21, 0x5E }, { 0x7F, 0x09, 0x19, 0x29, 0x46 }, // P Q R
+   { 0x26, 0x49, 0x49, 0x49, 0x32 }, { 0x03, 0x01, 0x7F, 0x01, 0x03 }, { 0x3F, 0x40, 0x40, 0x40, 0x3F }, // S T U
+   { 0x1F, 0x20, 0x40, 0x20, 0x1F }, { 0x3F, 0x40, 0x38, 0x40, 0x3F }, { 0x63, 0x14, 0x08, 0x14, 0x63 }, // V W X
+   { 0x03, 0x04, 0x78, 0x04, 0x03 }, { 0x61, 0x59, 0x49, 0x4D, 0x43 }, { 0x00, 0x7F, 0x41, 0x41, 0x41 }, // Y Z [
+   { 0x02, 0x04, 0x08, 0x10, 0x20 }, { 0x00, 0x41, 0x41, 0x41, 0x7F }, { 0x04, 0x02, 0x01, 0x02, 0x04 }, // \ ] ^
+   { 0x40, 0x40, 0x40, 0x40, 0x40 }, { 0x00, 0x03, 0x07, 0x08, 0x00 }, { 0x20, 0x54, 0x54, 0x78, 0x40 }, // _ ` a
+   { 0x7F, 0x28, 0x44, 0x44, 0x38 }, { 0x38, 0x44, 0x44, 0x44, 0x28 }, { 0x38, 0x44, 0x44, 0x28, 0x7F }, // b c d
+   { 0x38, 0x54, 0x54, 0x54, 0x18 }, { 0x00, 0x08, 0x7E, 0x09, 0x02 }, { 0x18, 0xA4, 0xA4, 0x9C, 0x78 }, // e f g
+   { 0x7F, 0x08, 0x04, 0x04, 0x78 }, { 0x00, 0x44, 0x7D, 0x40, 0x00 }, { 0x20, 0x40, 0x40, 0x3D, 0x00 }, // h i j
+   { 0x7F, 0x10, 0x28, 0x44, 0x00 }, { 0x00, 0x41, 0x7F, 0x40, 0x00 }, { 0x7C, 0x04, 0x78, 0x04, 0x78 }, // k l m
+   { 0x7C, 0x08, 0x04, 0x04, 0x78 }, { 0x38, 0x44, 0x44, 0x44, 0x38 }, { 0xFC, 0x18, 0x24, 0x24, 0x18 }, // n o p
+   { 0x18, 0x24, 0x24, 0x18, 0xFC }, { 0x7C, 0x08, 0x04, 0x04, 0x08 }, { 0x48, 0x54, 0x54, 0x54, 0x24 }, // q r s
+   { 0x04, 0x04, 0x3F, 0x44, 0x24 }, { 0x3C, 0x40, 0x40, 0x20, 0x7C }, { 0x1C, 0x20, 0x40, 0x20, 0x1C }, // t u v
+   { 0x3C, 0x40, 0x30, 0x40, 0x3C }, { 0x44, 0x28, 0x10, 0x28, 0x44 }, { 0x4C, 0x90, 0x90, 0x90, 0x7C }, // w x y
+   { 0x44, 0x64, 0x54, 0x4C, 0x44 }, { 0x00, 0x08, 0x36, 0x41, 0x00 }, { 0x00, 0x00, 0x77, 0x00, 0x00 }, // z { |
+   { 0x00, 0x41, 0x36, 0x08, 0x00 }, { 0x02, 0x01, 0x02, 0x04, 0x02 }                                    // } ~
+};
+
+#define ATLAS_ROWS ((TEXT_NUM_CHARS + TEXT_ATLAS_COLUMNS - 1) / TEXT_ATLAS_COLUMNS)
+#define ATLAS_WIDTH (TEXT_ATLAS_COLUMNS * TEXT_GLYPH_WIDTH)
+#define ATLAS_HEIGHT (ATLAS_ROWS * TEXT_GLYPH_HEIGHT)
+
+// The atlas holds only coverage, in the alpha of each texel, and is sampled texel for texel, with
+// no filtering, so the glyphs stay sharp when scaled up.
+void TextOverlay::setup()
+{
+   int c, i, j;
+   vector<unsigned char> texels(ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+   for (c = 0; c < TEXT_NUM_CHARS; c++)
+   {
+      int left = (c % TEXT_ATLAS_COLUMNS) * TEXT_GLYPH_WIDTH, top = (c / TEXT_ATLAS_COLUMNS) * TEXT_GLYPH_HEIGHT;
+	  for (i = 0; i < 5; i++)
+	     for (j = 0; j < TEXT_GLYPH_HEIGHT; j++)
+		    if (FONT_COLUMNS[c][i] & (1 << j)) texels[(top + j) * ATLAS_WIDTH + left + i] = 255;
+   }
+
+   glGenTextures(1, &atlas);
+   glBindTexture(GL_TEXTURE_2D, atlas);
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_ALPHA, GL_UNSIGNED_BYTE, texels.data());
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+   glBindTexture(GL_TEXTURE_2D, 0);
+
+   glGenBuffers(1, &buffer);
+
+   program = InitShader("textvshader.glsl", "textfshader.glsl");
+   positionLoc = glGetAttribLocation(program, "vPosition");
+   texCoordLoc = glGetAttribLocation(program, "vTexCoord");
+   colorLoc = glGetAttribLocation(program, "vColor");
+   screenSizeLoc = glGetUniformLocation(program, "screenSize");
+   atlasLoc = glGetUniformLocation(program, "atlas");
+}
+
+// Each glyph is two triangles, six vertices, so that all the text is one list of triangles.
+void TextOverlay::addText(float x, float y, const char *text, unsigned char r, unsigned char g, unsigned char b)
+{
+   static const int corners[6][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 0 }, { 1, 1 }, { 0, 1 } };
+   float left = x;
+   const char *c;
+   int k;
+
+   for (c = text; *c != '\0'; c++)
+   {
+      if (*c == '\n')
+	  {
+	     x = left;
+		 y += TEXT_LINE_HEIGHT;
+		 continue;
+	  }
+	  int glyph = (unsigned char)*c - TEXT_FIRST_CHAR;
+	  if (glyph < 0 || glyph >= TEXT_NUM_CHARS) glyph = '?' - TEXT_FIRST_CHAR;
+	  float u = (float)((glyph % TEXT_ATLAS_COLUMNS) * TEXT_GLYPH_WIDTH) / ATLAS_WIDTH;
+	  float v = (float)((glyph / TEXT_ATLAS_COLUMNS) * TEXT_GLYPH_HEIGHT) / ATLAS_HEIGHT;
+	  if (glyph != 0) // Spaces take room but need no quad.
+	     for (k = 0; k < 6; k++)
+		 {
+		    TextVertex vertex;
+			vertex.x = x + corners[k][0] * TEXT_GLYPH_WIDTH * TEXT_SCALE;
+			vertex.y = y + corners[k][1] * TEXT_GLYPH_HEIGHT * TEXT_SCALE;
+			vertex.u = u + corners[k][0] * (float)TEXT_GLYPH_WIDTH / ATLAS_WIDTH;
+			vertex.v = v + corners[k][1] * (float)TEXT_GLYPH_HEIGHT / ATLAS_HEIGHT;
+			vertex.rgba[0] = r; vertex.rgba[1] = g; vertex.rgba[2] = b; vertex.rgba[3] = 255;
+			vertices.push_back(vertex);
+		 }
+	  x += TEXT_GLYPH_WIDTH * TEXT_SCALE;
+   }
+}
+
+// The text is blended over the scene with the depth test off. The attribute arrays enabled here
+// are disabled again, as the scene's program does not use them.
+void TextOverlay::draw(RenderBackend &backend, int width, int height)
+{
+   TRACE_SCOPE("TextOverlay::draw");
+   numUploaded = vertices.size() * sizeof(TextVertex);
+   if (vertices.empty()) return;
+
+   backend.useProgram(program);
+   backend.bindBuffer(GL_ARRAY_BUFFER, buffer);
+   {
+      TRACE_SCOPE("upload text");
+      backend.bufferData(GL_ARRAY_BUFFER, numUploaded, vertices.data(), GL_STREAM_DRAW);
+   }
+   backend.enableVertexAttribArray(positionLoc);
+   backend.vertexAttribPointer(positionLoc, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), 0);
+   backend.enableVertexAttribArray(texCoordLoc);
+   backend.vertexAttribPointer(texCoordLoc, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), 2 * sizeof(float));
+   backend.enableVertexAttribArray(colorLoc);
+   backend.vertexAttribPointer(colorLoc, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(TextVertex), 4 * sizeof(float));
+
+   backend.uniform2f(screenSizeLoc, (float)width, (float)height);
+   backend.activeTexture(GL_TEXTURE0);
+   backend.bindTexture(GL_TEXTURE_2D, atlas);
+   backend.uniform1i(atlasLoc, 0);
+
+   backend.viewport(0, 0, width, height);
+   backend.disable(GL_DEPTH_TEST);
+   backend.enable(GL_BLEND);
+   backend.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+   backend.drawArrays(GL_TRIANGLES, 0, vertices.size());
+   backend.disable(GL_BLEND);
+   backend.enable(GL_DEPTH_TEST);
+
+   backend.bindTexture(GL_TEXTURE_2D, 0);
+   backend.disableVertexAttribArray(positionLoc);
+   backend.disableVertexAttribArray(texCoordLoc);
+   backend.disableVertexAttribArray(colorLoc);
+}
@@ -0,0 +1,53 @@
+#ifndef TextOverlay_57129
+#define TextOverlay_57129
+
+#include <vector>
+#include <GL/glew.h>
+#include "RenderBackend.h"
+
+using namespace std;
+
+#define TEXT_FIRST_CHAR 32 // Characters of the font: the printable ASCII ones, from space ...
+#define TEXT_NUM_CHARS 95  // ... to ~; any other is drawn as ?.
+#define TEXT_GLYPH_WIDTH 6  // Cell of a glyph in the atlas, in texels: 5 columns and a gap ...
+#define TEXT_GLYPH_HEIGHT 8 // ... by 7 rows and a row for descenders.
+#define TEXT_ATLAS_COLUMNS 16 // Glyphs across the atlas.
+#define TEXT_SCALE 2 // Pixels on the screen for a texel of a glyph.
+#define TEXT_LINE_HEIGHT ((TEXT_GLYPH_HEIGHT + 2) * TEXT_SCALE) // Pixels from a line of text to the next.
+
+// Vertex of a glyph's quad: the position in pixels from the top left of the window, the texture
+// co-ordinates in the atlas and the color.
+struct TextVertex
+{
+   float x, y, u, v;
+   unsigned char rgba[4];
+};
+
+// Text drawn over the window. The glyphs of a built-in 5 by 7 pixel font are laid out in a single
+// texture, the atlas, so any amount of text is a list of textured quads: the text of a frame is
+// gathered with addText, and draw uploads the quads in one buffer and draws them in one call.
+class TextOverlay
+{
+public:
+   TextOverlay() { program = buffer = atlas = 0; numUploaded = 0; }
+   void setup(); // Make the atlas, buffer and shader program; a GL context must be current.
+
+   void clear() { vertices.clear(); } // Start the text of a frame.
+   void addText(float x, float y, const char *text, // Add text with the top left of its first glyph
+                unsigned char r, unsigned char g,   // at (x, y), in pixels from the top left of the
+                unsigned char b);                   // window, in the color; a newline starts a line
+                                                    // TEXT_LINE_HEIGHT further down.
+   void draw(RenderBackend &backend, int width, int height); // Draw all the text added over the window of
+                                                             // the size, through the backend.
+
+   int numberDrawCalls() { return vertices.empty() ? 0 : 1; } // Draw calls made by draw.
+   size_t bytesUploaded() { return numUploaded; } // Bytes of vertices uploaded by the last draw.
+
+private:
+   vector<TextVertex> vertices;
+   GLuint program, buffer, atlas;
+   GLint positionLoc, texCoordLoc, colorLoc, screenSizeLoc, atlasLoc;
+   size_t numUploaded;
+};
+
+#endif
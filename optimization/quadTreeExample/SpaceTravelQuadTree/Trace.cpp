@@ -0,0 +1,153 @@
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include <mutex>
+#include <iostream>
+#include <fstream>
+#include "Trace.h"
+
+using namespace std;
+
+atomic<int> isTraceOn(0);
+static chrono::steady_clock::time_point traceStart;
+
+// An event as recorded: times in nanoseconds since tracing started.
+struct TraceRecord
+{
+   const char *name;
+   long long start, duration;
+};
+
+// Ring buffer of the events of a thread, or of threads one after another, shown as one track.
+struct TraceRing
+{
+   vector<TraceRecord> events; // TRACE_RING_EVENTS of them; event i is at i % TRACE_RING_EVENTS.
+   long long numRecorded;
+   int track;                  // Thread id of the track in the trace.
+   const char *name;           // Name of the track, NULL for none.
+};
+
+static mutex ringsLock; // Guards the lists of rings, not the rings themselves.
+static vector<TraceRing *> rings; // Every ring, in the order made.
+static vector<TraceRing *> freeRings; // Rings of threads that have ended, to be taken by the next.
+
+// The ring of a thread, handed on when the thread ends unless the thread was named, as the name
+// would not fit the next.
+struct TraceRingHolder
+{
+   TraceRingHolder() { ring = NULL; }
+   ~TraceRingHolder()
+   {
+      if (ring == NULL || ring->name != NULL) return;
+	  lock_guard<mutex> guard(ringsLock);
+	  freeRings.push_back(ring);
+   }
+   TraceRing *ring;
+};
+
+static thread_local TraceRingHolder threadRing;
+
+// Return the calling thread's ring, taking one when the thread first records.
+static TraceRing *ringOfThread()
+{
+   if (threadRing.ring != NULL) return threadRing.ring;
+   lock_guard<mutex> guard(ringsLock);
+   if (!freeRings.empty())
+   {
+      threadRing.ring = freeRings.back();
+	  freeRings.pop_back();
+   }
+   else
+   {
+      TraceRing *ring = new TraceRing;
+	  ring->events.resize(TRACE_RING_EVENTS);
+	  ring->numRecorded = 0;
+	  ring->track = rings.size() + 1;
+	  ring->name = NULL;
+	  rings.push_back(ring);
+	  threadRing.ring = ring;
+   }
+   return threadRing.ring;
+}
+
+long long traceNow()
+{
+   return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - traceStart).count();
+}
+
+long long traceBegin()
+{
+   ringOfThread();
+   return traceNow();
+}
+
+void traceEvent(const char *name, long long start, long long duration)
+{
+   TraceRing *ring = ringOfThread();
+   TraceRecord &record = ring->events[ring->numRecorded % TRACE_RING_EVENTS];
+   record.name = name;
+   record.start = start;
+   record.duration = duration;
+   ring->numRecorded++;
+}
+
+// Tracing starts before the threads that are traced, so they see the start time.
+void startTracing()
+{
+   traceStart = chrono::steady_clock::now();
+   isTraceOn.store(1, memory_order_release);
+}
+
+void nameTraceThread(const char *name)
+{
+   if (isTraceOn.load(memory_order_relaxed)) ringOfThread()->name = name;
+}
+
+// Each event is a complete event ("X"), with its start and duration in microseconds, to the
+// nanosecond; each named track has a thread_name metadata event.
+int writeTrace(const char *fileName)
+{
+   int i, isFirst = 1;
+   long long j, numDropped = 0;
+
+   isTraceOn.store(0, memory_order_relaxed);
+   lock_guard<mutex> guard(ringsLock);
+   ofstream out(fileName);
+   if (!out)
+   {
+      cerr << "Cannot write the trace " << fileName << "." << endl;
+	  return 0;
+   }
+   out.setf(ios::fixed);
+   out.precision(3);
+
+   out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [" << endl;
+   for (i = 0; i < (int)rings.size(); i++)
+   {
+      TraceRing *ring = rings[i];
+	  if (ring->name != NULL)
+	  {
+	     out << (isFirst ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << ring->track
+			 << ", \"args\": {\"name\": \"" << ring->name << "\"}}";
+		 isFirst = 0;
+	  }
+	  long long first = ring->numRecorded > TRACE_RING_EVENTS ? ring->numRecorded - TRACE_RING_EVENTS : 0;
+	  numDropped += first;
+	  for (j = first; j < ring->numRecorded; j++)
+	  {
+	     const TraceRecord &record = ring->events[j % TRACE_RING_EVENTS];
+		 out << (isFirst ? "" : ",\n") << "{\"name\": \"" << record.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+			 << ring->track << ", \"ts\": " << record.start / 1000.0 << ", \"dur\": " << record.duration / 1000.0 << "}";
+		 isFirst = 0;
+	  }
+   }
+   out << endl << "]}" << endl;
+
+   if (!out)
+   {
+      cerr << "Cannot write the trace " << fileName << "." << endl;
+	  return 0;
+   }
+   if (numDropped > 0) cout << "The oldest " << numDropped << " events of the trace were overwritten." << endl;
+   return 1;
+}
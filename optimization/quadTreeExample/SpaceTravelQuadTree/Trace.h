@@ -0,0 +1,52 @@
+#ifndef Trace_71536
+#define Trace_71536
+
+#include <atomic>
+
+using namespace std;
+
+#define TRACE_RING_EVENTS 65536 // Events kept for each thread; once full, the oldest are overwritten.
+
+// Timeline tracing. A TRACE_SCOPE marks a block of code: when tracing is on, the time the block
+// starts and how long it takes are recorded, in nanoseconds, when it ends, in a ring buffer of
+// the thread's own, so recording takes no lock. When tracing is off a scope costs one relaxed
+// atomic load and a branch. The events are written out as Chrome trace-event JSON, which
+// chrome://tracing and Perfetto open as a timeline with a track for each thread.
+//
+// Threads started for a single piece of work, as by the parallel traversals, hand their ring on
+// when they end to the next thread started, so their events share a track rather than each
+// thread taking a ring of its own.
+
+extern atomic<int> isTraceOn; // Set while tracing.
+
+long long traceNow(); // Nanoseconds since tracing started.
+long long traceBegin(); // The same, for an event starting on the calling thread, which is given a ring
+                        // now if it has none, so that its events on the ring's track do not overlap
+                        // those of the thread that had the ring before.
+void traceEvent(const char *name, long long start, long long duration); // Record an event on the calling
+                                                                         // thread's ring; the name must be
+                                                                         // a string literal, as only the
+                                                                         // pointer is kept.
+
+// Record the enclosing block as an event of the given name, if tracing is on.
+class TraceScope
+{
+public:
+   TraceScope(const char *name) { this->name = name; start = isTraceOn.load(memory_order_relaxed) ? traceBegin() : -1; }
+   ~TraceScope() { if (start >= 0) traceEvent(name, start, traceNow() - start); }
+private:
+   const char *name;
+   long long start; // -1 if tracing was off when the block started.
+};
+
+#define TRACE_JOIN(a, b) a##b
+#define TRACE_NAME(line) TRACE_JOIN(traceScope, line)
+#define TRACE_SCOPE(name) TraceScope TRACE_NAME(__LINE__)(name)
+
+void startTracing(); // Start recording events, timed from now.
+void nameTraceThread(const char *name); // Name the calling thread's track; the name must be a string literal.
+int writeTrace(const char *fileName); // Stop tracing and write the events recorded to the file as Chrome
+                                      // trace-event JSON; no traced thread may be running. Return 1 if
+                                      // written, or report the problem and return 0.
+
+#endif
@@ -0,0 +1,66 @@
+#include <cstdlib>
+#include "WorkerPool.h"
+
+using namespace std;
+
+// The workers are told of a pass by a new generation and count themselves out of it, so the pass
+// returns only when all have seen it, and none can take a task of the next in place of this one.
+void WorkerPool::runTasks(int numThreads, int numTasks, void (*call)(void *, int), void *task)
+{
+   int t;
+   if (numThreads < 1) numThreads = 1;
+   if ((int)workers.size() != numThreads - 1)
+   {
+      stop();
+	  for (t = 1; t < numThreads; t++) workers.push_back(thread(&WorkerPool::work, this, generation));
+   }
+
+   {
+      lock_guard<mutex> guard(lock);
+	  this->call = call;
+	  this->task = task;
+	  this->numTasks = numTasks;
+	  nextTask.store(0);
+	  numBusy = workers.size();
+	  generation++;
+   }
+   wake.notify_all();
+   takeTasks();
+
+   unique_lock<mutex> guard(lock);
+   done.wait(guard, [this] { return numBusy == 0; });
+}
+
+void WorkerPool::takeTasks()
+{
+   int i;
+   while ((i = nextTask.fetch_add(1)) < numTasks) call(task, i);
+}
+
+void WorkerPool::work(unsigned seen)
+{
+   unique_lock<mutex> guard(lock);
+   while (true)
+   {
+      wake.wait(guard, [&] { return isStopping || generation != seen; });
+	  if (isStopping) return;
+	  seen = generation;
+	  guard.unlock();
+	  takeTasks();
+	  guard.lock();
+	  if (--numBusy == 0) done.notify_one();
+   }
+}
+
+void WorkerPool::stop()
+{
+   int t;
+   {
+      lock_guard<mutex> guard(lock);
+	  isStopping = 1;
+   }
+   wake.notify_all();
+   for (t = 0; t < (int)workers.size(); t++) workers[t].join();
+   workers.clear();
+   isStopping = 0;
+}
@@ -0,0 +1,47 @@
+#ifndef WorkerPool_40729
+#define WorkerPool_40729
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+// Threads kept from one parallel pass to the next, for work done over and over, such as the gravity
+// of every tick, where starting threads for each pass would cost more than a short pass saves, and
+// allocate every time. A pass hands out the indices of its tasks to the workers and the calling
+// thread, which take them one at a time until none is left, and returns once every worker is done.
+// Workers are started when the number of threads asked for changes, and otherwise wait, asleep,
+// for the next pass.
+class WorkerPool
+{
+public:
+   WorkerPool() { call = NULL; task = NULL; numTasks = numBusy = isStopping = 0; generation = 0; }
+   ~WorkerPool() { stop(); }
+   template <class Task> void run(int numThreads, int numTasks, Task &task) // Call task(i) for each i from 0 to
+   {                                                                        // numTasks - 1, on up to numThreads
+      runTasks(numThreads, numTasks, &callTask<Task>, &task);               // threads, the calling thread among
+   }                                                                        // them.
+
+private:
+   template <class Task> static void callTask(void *task, int i) { (*(Task *)task)(i); }
+   void runTasks(int numThreads, int numTasks, void (*call)(void *, int), void *task);
+   void takeTasks(); // Run tasks of the pass until none is left.
+   void work(unsigned seen); // Loop of a worker, started after pass seen.
+   void stop(); // Stop the workers and wait for them to end.
+
+   vector<thread> workers;
+   mutex lock;
+   condition_variable wake, done;
+   void (*call)(void *, int); // The pass under way: what to call on each task ...
+   void *task;
+   int numTasks;              // ... and how many there are.
+   atomic<int> nextTask;      // Index of the next task to take.
+   int numBusy;               // Workers yet to finish the pass.
+   int isStopping;
+   unsigned generation;       // Number of the pass.
+};
+
+#endif
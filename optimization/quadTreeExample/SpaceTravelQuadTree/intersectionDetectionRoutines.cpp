@@ -168,6 +168,55 @@ int checkQuadrilateralsIntersection(float x1, float y1, float x2, float y2,
    else return 0;
 }
 
+// Return 1 if the side from (x1,y1) to (x2,y2) of a convex quadrilateral whose other vertices are (x3,y3)
+// and (x4,y4) separates the quadrilateral from the axes-parallel rectangle [minX,maxX] by [minY,maxY],
+// otherwise return 0.
+static int checkSideSeparates(float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4,
+							  float minX, float maxX, float minY, float maxY)
+{
+   // Project on the normal (nx,ny) of the side; the rectangle's extent along it is given by the
+   // corners nearest and furthest in its direction.
+   float nx = y2 - y1, ny = x1 - x2;
+   float side = nx*x1 + ny*y1, p3 = nx*x3 + ny*y3, p4 = nx*x4 + ny*y4;
+   float quadMin = side, quadMax = side;
+   float rectMin, rectMax;
+
+   if (p3 < quadMin) quadMin = p3; 
+   if (p3 > quadMax) quadMax = p3;
+   if (p4 < quadMin) quadMin = p4; 
+   if (p4 > quadMax) quadMax = p4;
+   rectMin = nx*(nx >= 0 ? minX : maxX) + ny*(ny >= 0 ? minY : maxY);
+   rectMax = nx*(nx >= 0 ? maxX : minX) + ny*(ny >= 0 ? maxY : minY);
+   return (rectMax < quadMin) || (rectMin > quadMax);
+}
+
+// Return 1 if the convex quadrilateral with vertices (x1,y1), (x2,y2), (x3,y3) and (x4,y4) intersects
+// the axes-parallel rectangle with diagonally opposite corners at (x5,y5) and (x6,y6), otherwise
+// return 0: the same answer as checkQuadrilateralsIntersection with the rectangle as the second
+// quadrilateral, but by separating axes, with a projection on each of six directions.
+int checkConvexQuadrilateralRectangleIntersection(float x1, float y1, float x2, float y2,
+												  float x3, float y3, float x4, float y4,
+												  float x5, float y5, float x6, float y6)
+{
+   float minX = (x5 < x6) ? x5 : x6, maxX = (x5 < x6) ? x6 : x5;
+   float minY = (y5 < y6) ? y5 : y6, maxY = (y5 < y6) ? y6 : y5;
+
+   // Two convex polygons, taken closed, are disjoint just if there is a line parallel to a side of
+   // one of them with the two on either side of it. The rectangle's sides first: the quadrilateral's
+   // bounding box must overlap the rectangle.
+   if (x1 < minX && x2 < minX && x3 < minX && x4 < minX) return 0;
+   if (x1 > maxX && x2 > maxX && x3 > maxX && x4 > maxX) return 0;
+   if (y1 < minY && y2 < minY && y3 < minY && y4 < minY) return 0;
+   if (y1 > maxY && y2 > maxY && y3 > maxY && y4 > maxY) return 0;
+
+   // Then the quadrilateral's sides; a side of no length has no direction, and separates nothing.
+   if (checkSideSeparates(x1, y1, x2, y2, x3, y3, x4, y4, minX, maxX, minY, maxY)) return 0;
+   if (checkSideSeparates(x2, y2, x3, y3, x4, y4, x1, y1, minX, maxX, minY, maxY)) return 0;
+   if (checkSideSeparates(x3, y3, x4, y4, x1, y1, x2, y2, minX, maxX, minY, maxY)) return 0;
+   if (checkSideSeparates(x4, y4, x1, y1, x2, y2, x3, y3, minX, maxX, minY, maxY)) return 0;
+   return 1;
+}
+
 // Return 1 if the axes-parallel rectangle with diagonally opposite corners at (x1,y1) and (x2,y2)
 // intersects the disc centered (x3,y3) of radius r, otherwise return 0.
 int checkDiscRectangleIntersection(float x1, float y1, float x2, float y2, float x3, float y3, float r)
@@ -206,3 +255,74 @@ int checkDiscRectangleIntersection(float x1, float y1, float x2, float y2, float
 }
 
 
+// Return 1 if the ray from (x,y) with direction (dx,dy) meets the axes-parallel rectangle with diagonally
+// opposite corners at (x1,y1) and (x2,y2) for a ray parameter in [0,tMax], otherwise return 0. On
+// success *tEnter is set to the parameter at which the ray enters the rectangle (0 if it starts inside).
+int checkRayRectangleIntersection(float x, float y, float dx, float dy,
+								  float x1, float y1, float x2, float y2, float tMax, float *tEnter)
+{
+   float tNear = 0.0, tFar = tMax, t1, t2, temp;
+
+   // Clip the parameter interval [0,tMax] against the slab between the two vertical sides and then
+   // against the slab between the two horizontal sides; the ray meets the rectangle if anything is left.
+   if (dx == 0.0)
+   {
+      // Ray parallel to the vertical sides: it is in the slab throughout or never.
+      if ( (x < x1 && x < x2) || (x > x1 && x > x2) ) return 0;
+   }
+   else
+   {
+      t1 = (x1 - x) / dx; t2 = (x2 - x) / dx;
+	  if (t1 > t2) { temp = t1; t1 = t2; t2 = temp; }
+	  if (t1 > tNear) tNear = t1;
+	  if (t2 < tFar) tFar = t2;
+	  if (tNear > tFar) return 0;
+   }
+
+   if (dy == 0.0)
+   {
+      if ( (y < y1 && y < y2) || (y > y1 && y > y2) ) return 0;
+   }
+   else
+   {
+      t1 = (y1 - y) / dy; t2 = (y2 - y) / dy;
+	  if (t1 > t2) { temp = t1; t1 = t2; t2 = temp; }
+	  if (t1 > tNear) tNear = t1;
+	  if (t2 < tFar) tFar = t2;
+	  if (tNear > tFar) return 0;
+   }
+
+   *tEnter = tNear;
+   return 1;
+}
+
+// Return 1 if the ray from (x,y,z) with unit direction (dx,dy,dz) meets the sphere centered (x1,y1,z1)
+// of radius r for a ray parameter in [0,tMax], otherwise return 0. On success *t is set to the parameter
+// of the first point of the sphere on the ray (0 if the ray starts inside the sphere).
+int checkRaySphereIntersection(float x, float y, float z, float dx, float dy, float dz,
+							   float x1, float y1, float z1, float r, float tMax, float *t)
+{
+   // Points of the ray are (x,y,z) + s(dx,dy,dz); with (dx,dy,dz) a unit vector, the sphere is met
+   // where s*s - 2*b*s + c = 0 with b the projection of the center offset on the ray.
+   float ox = x1 - x, oy = y1 - y, oz = z1 - z;
+   float b = ox*dx + oy*dy + oz*dz;
+   float c = ox*ox + oy*oy + oz*oz - r*r;
+   float disc, s;
+
+   if (c <= 0.0) // Ray starts inside the sphere.
+   {
+      *t = 0.0;
+	  return 1;
+   }
+   if (b <= 0.0) return 0; // Sphere is behind the ray origin.
+
+   disc = b*b - c;
+   if (disc < 0.0) return 0;
+
+   s = b - sqrt(disc);
+   if (s > tMax) return 0;
+
+   *t = s;
+   return 1;
+}
+
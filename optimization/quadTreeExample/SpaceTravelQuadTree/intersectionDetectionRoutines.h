@@ -54,9 +54,31 @@ int checkQuadrilateralsIntersection(float x1, float y1, float x2, float y2,
 	float x7, float y7, float x8, float y8);
 
 
+// Return 1 if the convex quadrilateral with vertices (x1,y1), (x2,y2), (x3,y3) and (x4,y4) intersects
+// the axes-parallel rectangle with diagonally opposite corners at (x5,y5) and (x6,y6), otherwise
+// return 0: the same answer as checkQuadrilateralsIntersection with the rectangle as the second
+// quadrilateral, but by separating axes, with a projection on each of six directions.
+int checkConvexQuadrilateralRectangleIntersection(float x1, float y1, float x2, float y2,
+	float x3, float y3, float x4, float y4, float x5, float y5, float x6, float y6);
+
+
 // Return 1 if the axes-parallel rectangle with diagonally opposite corners at (x1,y1) and (x2,y2)
 // intersects the disc centered (x3,y3) of radius r, otherwise return 0.
 int checkDiscRectangleIntersection(float x1, float y1, float x2, float y2, float x3, float y3, float r);
 
 
+// Return 1 if the ray from (x,y) with direction (dx,dy) meets the axes-parallel rectangle with diagonally
+// opposite corners at (x1,y1) and (x2,y2) for a ray parameter in [0,tMax], otherwise return 0. On
+// success *tEnter is set to the parameter at which the ray enters the rectangle (0 if it starts inside).
+int checkRayRectangleIntersection(float x, float y, float dx, float dy,
+	float x1, float y1, float x2, float y2, float tMax, float *tEnter);
+
+
+// Return 1 if the ray from (x,y,z) with unit direction (dx,dy,dz) meets the sphere centered (x1,y1,z1)
+// of radius r for a ray parameter in [0,tMax], otherwise return 0. On success *t is set to the parameter
+// of the first point of the sphere on the ray (0 if the ray starts inside the sphere).
+int checkRaySphereIntersection(float x, float y, float z, float dx, float dy, float dz,
+	float x1, float y1, float z1, float r, float tMax, float *t);
+
+
 #endif
\ No newline at end of file
@@ -0,0 +1,8 @@
+#version 120
+attribute vec4 vPosition;
+attribute vec4 vColor;
+void main()
+{
+    gl_Position    = gl_ModelViewProjectionMatrix * vPosition;
+    gl_FrontColor  = vColor;
+}
\ No newline at end of file
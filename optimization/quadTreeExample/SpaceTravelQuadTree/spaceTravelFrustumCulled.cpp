@@ -8,19 +8,82 @@
 // Frustum culling is implemented by means of a quadtree data structure.
 // 
 // COMPILE NOTE: File intersectionDetectionRoutines.cpp must be in the same folder.
-// EXECUTION NOTE: If ROWS and COLUMNS are large the quadtree takes time to build so
-//                 the display may take several seconds to come up.
-//
-// User-defined constants: 
-// ROWS is the number of rows of  asteroids.
-// COLUMNS is the number of columns of asteroids.
-// FILL_PROBABILITY is the percentage probability that a particular row-column slot
-// will be filled with an asteroid.
+// EXECUTION NOTE: The quadtree is built in the background, so the display comes up at once, but
+//                 if the rows and columns are many frustum culling is done by brute force, and 
+//                 slowly, for the several seconds until the quadtree is ready.
 //
 // Interaction:
 // Press the left/right arrow keys to turn the craft.
 // Press the up/down arrow keys to move the craft.
 // Press space to toggle between frustum culling enabled and disabled.
+// Press m to toggle between the asteroids drifting and standing still.
+// Press g to cycle the gravity between drifting asteroids through off, Barnes-Hut and direct summation.
+// Press c to show or hide the performance counters.
+// Press q to show or hide the squares of the quadtree that culling visits, over the fixed camera's
+//         view, colored by what it did with them, along with both frusta (a bounded field only).
+//
+// Command line (see Config.h; each setting may also be given in a file read with --config FILE):
+// --rows N and --columns N give the number of rows and columns of asteroids (100 each by default).
+// --fill P is the percentage probability that a particular row-column slot will be filled with
+//          an asteroid (100 by default).
+// --spacing D is the distance between neighbouring rows and columns of asteroids (30 by default).
+// --seed S seeds the random numbers that fill and color the field, so that a field can be had 
+//          again; by default the seed is the time, and it is reported at the start.
+// --threads N sets the number of threads the field is generated, culled and moved with (one per
+//             core by default); the field, and what is drawn of it, is the same for any number.
+// --stream 1 flies through an unbounded field generated in chunks around the spacecraft, which
+//            keep to --budget MB of memory (64 by default); the asteroids do not drift.
+// --save FILE writes a snapshot of the field and its quadtree to FILE once they are set up, and
+//             --load FILE maps them from the snapshot instead, which takes no time to speak of.
+// --headless TICKS runs the simulation for TICKS ticks without a window, as fast as it can, with the
+//                  asteroids drifting, and reports the simulated time against the time taken; with
+//                  --stream 1 it flies the spacecraft straight ahead and reports on the chunks.
+// --gravity off|bh|direct sets the gravity between drifting asteroids from the start.
+// --benchmark FRAMES benchmarks the frustum culling of the field without a window: the quadtree is
+//                    built, and the frusta of both viewports culled for each frame of a scripted 
+//                    flight, by the quadtree and by brute force, and the build time and per-frame
+//                    latency, nodes visited, tests, asteroids visible (each once) and draw commands
+//                    issued are reported; --report FILE writes them to FILE, as CSV if it ends in
+//                    .csv and otherwise as JSON. The memory allocated is reported as well (see
+//                    --allocations). It fails if the quadtree misses an asteroid brute force finds,
+//                    or if a frame issues more draw commands than there are asteroids visible.
+// --microbenchmark N times each of the intersection routines on N random inputs, and on N each of
+//                    collinear, degenerate and just touching ones, and the accelerated routine the
+//                    quadtree culls with on the same inputs as the original it replaces, checking
+//                    that they give the same answers but for degenerate inputs, where differences
+//                    are only reported; --report FILE writes the timings to FILE. 
+// --record FILE writes the key events, stamped with the tick each was applied at, and the settings
+//               of the field, the seed among them, to FILE when the program ends; --replay FILE 
+//               flies the same flight over the same field from them, and ends where the recording
+//               did, reporting the frame times. With --unthrottled 1 the replay runs a tick a 
+//               frame, as fast as the frames can be drawn, so that runs can be compared.
+// --trace FILE records when each phase of setup and of each frame (culling, drawing each viewport,
+//              uploading the text, swapping, the collision check and so on) starts and ends, on
+//              every thread, and writes the timeline to FILE as Chrome trace-event JSON, to be
+//              opened in chrome://tracing or Perfetto.
+// --offscreen FRAMES draws FRAMES frames with no window, into a framebuffer of the window's size, by 
+//                    EGL with no display (llvmpipe on a machine with no GPU), as fast as they can be
+//                    drawn, and reports the frame times; unless it is a replay it flies the scripted 
+//                    flight of the benchmark with culling on. Only a build with OFFSCREEN_EGL defined,
+//                    linked with EGL, can. With --backend null the frames are drawn through a backend
+//                    that throws the OpenGL calls away, with no OpenGL at all, which leaves the cost 
+//                    of the program's own code; with --backend record the calls are counted, and 
+//                    checked against the counters' draw calls, and --calls FILE writes them to FILE.
+// --quadtree 1 shows the squares of the quadtree, as q does, from the start.
+// --allocations 1 counts the blocks and bytes allocated, and the most live at once, in setting up, in
+//                 building the quadtree, which is then built before the frames start rather than
+//                 alongside them, and over the frames, or the ticks without a window, and reports 
+//                 them at the end. A benchmark always counts them, for each frame as well, and fails
+//                 if a frame after the first few allocates anything.
+// --regress DIR runs the regression suite without a window: over fields of 100, 200 and 400 rows and
+//               columns it times building the quadtree, following the scripted flight of the
+//               benchmark with culling, a ray cast ahead and the spacecraft's sphere swept on each
+//               frame, and sweep-and-prune over drifting asteroids, five times each, and compares
+//               the medians, and the work done and results, with the baselines in the directory DIR,
+//               one file a scenario. It fails if a time grows by more than its tolerance (25% unless
+//               the file says otherwise), or a count changes, or there is no baseline; --report FILE
+//               writes each metric, its baseline and the change to FILE. --rebaseline 1 writes the
+//               medians to DIR as the new baselines, keeping their tolerances.
 // 
 // Sumanta Guha.
 ////////////////////////////////////////////////////////////////////////////////////// 
@@ -28,6 +91,9 @@
 #include <cstdlib>
 #include <ctime> 
 #include <cmath>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <GL/glew.h>
@@ -35,9 +101,30 @@
 #include <glm/glm.hpp>
 #include <list>
 #include <vector>
+#include <thread>
+#include <atomic>
 #include "intersectionDetectionRoutines.h"
-#include "Asteroid.h"
+#include "Meshes.h"
+#include "AsteroidStore.h"
+#include "FieldGenerator.h"
 #include "QuadTree.h"
+#include "SweepAndPrune.h"
+#include "Gravity.h"
+#include "Simulation.h"
+#include "FramePipeline.h"
+#include "Benchmark.h"
+#include "Microbenchmark.h"
+#include "Regression.h"
+#include "OffscreenContext.h"
+#include "RenderBackend.h"
+#include "Config.h"
+#include "ChunkedField.h"
+#include "Snapshot.h"
+#include "InputRecording.h"
+#include "FrameCounters.h"
+#include "TextOverlay.h"
+#include "Trace.h"
+#include "AllocationTracker.h"
 
 using namespace std;
 
@@ -45,26 +132,42 @@ using namespace std;
 #pragma comment ( lib, "glew32.lib" )
 #pragma comment ( lib, "glfw3.lib" )
 
-#define ROWS 100  // Number of rows of asteroids.
-#define COLUMNS 100 // Number of columns of asteroids.
-#define FILL_PROBABILITY 100 // Percentage probability that a particular row-column slot will be 
-                             // filled with an asteroid. It should be an integer between 0 and 100.
 #define WINDOW_X 1600
 #define WINDOW_Y 800
+#define CRAFT_SPEED 30.0 // Speed of the spacecraft while an up/down arrow key is held, per second.
+#define CRAFT_TURN_RATE 150.0 // Turning rate of the spacecraft while a left/right arrow key is held, 
+                              // in degrees per second.
+#define CRAFT_RADIUS 7.072 // Radius of the spacecraft's bounding sphere used for collision detection.
+#define CONTACT_GAP 0.01 // Distance the spacecraft stops short of an asteroid it runs into.
+#define DRIFT_SPEED 0.25 // Largest speed along x or z of a drifting asteroid, per tick.
 
 // Globals.
+static Config config; // Size of the asteroid field and the rest of the settings of the run.
 static int width, height; // Size of the OpenGL window.
-static float angle = 0.0; // Angle of the spacecraft.
-static float xVal = 0, zVal = 0; // Co-ordinates of the spacecraft.
+static CraftState craft = { 0.0, 0.0, 0.0 }; // State of the spacecraft at the last tick ...
+static CraftState previousCraft = craft; // ... and at the tick before, drawn interpolated in between.
+static int isLeftHeld = 0, isRightHeld = 0, isUpHeld = 0, isDownHeld = 0; // Arrow keys held down.
 static int isFrustumCulled = 0;
 static int isCollision = 0; // Is there collision between the spacecraft and an asteroid?
+static int isAsteroidsMoving = 0; // Are the asteroids drifting?
+static int gravityMode = GRAVITY_OFF; // Gravity between drifting asteroids (see Gravity.h).
+static float fieldX, fieldZ, fieldSize; // SW corner and side of the square bounding the asteroid field.
+static int isQuadtreeStale = 0; // Have asteroids moved since the quadtree was built?
+static int tickCount = 0; // Ticks simulated so far.
+static int isCountersShown = 1; // Are the performance counters shown over the scene?
+static int isQuadtreeShown = 0; // Are the squares the culling visits shown over the fixed camera's view?
+
 
+// the cone for the spaceship and the sphere for the asteroids, computed at compile time
+constexpr ConeMesh<10> coneMesh(10.0, 5.0);
+constexpr SphereLod<0>::Mesh sphereMesh(SPHERE_SIZE);
+static_assert(sizeof(MeshVertex) == sizeof(glm::vec3), "Mesh vertices are copied in as glm::vec3.");
 
 // vertex counting for where everything goes in the global array
 // fixed number of vertices for cone and sphere
-#define CONE_VERTEX_COUNT 12
+#define CONE_VERTEX_COUNT (ConeMesh<10>::VERTEX_COUNT)
 #define LINE_VERTEX_COUNT 2
-// #define SPHERE_VERTEX_COUNT 288 // moved to Asteroids.h because asteroids draw themselves
+// #define SPHERE_VERTEX_COUNT 288 // moved to AsteroidStore.h because asteroids draw themselves
 
 // initial indices where data starts getting drawn for different data types
 int cone_index = 0;
@@ -72,168 +175,47 @@ int line_index = cone_index + CONE_VERTEX_COUNT;
 int sphere_index = line_index + LINE_VERTEX_COUNT;
 
 // shader stuff
-glm::vec3 points[CONE_VERTEX_COUNT+LINE_VERTEX_COUNT+SPHERE_VERTEX_COUNT*ROWS*COLUMNS]; // addition of all rows/cols for asteroid vertices + spaceship vertices + line vertices  
+// spaceship vertices + line vertices + one sphere; every asteroid draws the same sphere, translated 
+// and scaled, so the vertex data does not grow with the field
+vector<glm::vec3> points(CONE_VERTEX_COUNT + LINE_VERTEX_COUNT + SPHERE_VERTEX_COUNT);
 GLuint  myShaderProgram;
 GLuint InitShader(const char* vShaderFile, const char* fShaderFile);
 GLuint	myBuffer;
 
 // the asteroids and quad tree from the initial program
-Asteroid **arrayAsteroids; // Global array of asteroids.
+AsteroidStore asteroids; // Global store of asteroids.
 Quadtree asteroidsQuadtree; // Global quadtree.
-
-//static long font = (long)GLUT_BITMAP_8_BY_13; // Font selection.
-// Routine to draw a bitmap character string.
-// DOES NOT WORK WITHOUT GLUT
-void writeBitmapString(void *font, char *string)
-{  
-   char *c;
-//   for (c = string; *c != '\0'; c++) glutBitmapCharacter(font, *c);
-} 
-
-// function obtained from tutorial at:
-// http://www.freemancw.com/2012/06/opengl-cone-function/
-// used in drawing a cone
-glm::vec3  perp(const glm::vec3 &v) {
-	float min = fabs(v.x);
-	glm::vec3 cardinalAxis( 1, 0, 0 );
-
-	if (fabs(v.y) < min) {
-		min = fabs(v.y);
-		cardinalAxis = glm::vec3( 0, 1, 0);
-	}
-
-	if (fabs(v.z) < min) {
-		cardinalAxis = glm::vec3(0, 0, 1);
-	}
-
-	return glm::cross(v, cardinalAxis);
-}
-
-// function derived from tutorial at:
-// http://www.freemancw.com/2012/06/opengl-cone-function/
-void CreateCone(const glm::vec3 &d, const glm::vec3 &a,
-	const float h, const float rd, const int n, int offset) {
-	glm::vec3 c;
-	c.x = a.x + (-d.x * h);
-	c.y = a.y + (-d.y * h);
-	c.z = a.z + (-d.z * h);
-	glm::vec3 e0 = perp(d);
-	glm::vec3 e1 = glm::cross(e0, d);
-	float angInc = 360.0 / n * (PI / 180.0f);
-
-	// calculate points around directrix
-	vector <glm::vec3> pts;
-	for (int i = 0; i < n; ++i) {
-		float rad = angInc * i;
-		glm::vec3 p = c + (((e0 * cos(rad)) + (e1 * sin(rad))) * rd);
-		pts.push_back(p);
-	}
-
-	// draw cone top
-	int i = 0;
-	int o = offset + i;
-	points[o].x = a.x;
-	points[o].y = a.y;
-	points[o].z = a.z;
-
-	for (i = 1; i < n+1; ++i) {
-		o = i + offset;
-		points[o].x = pts[i - 1].x;
-		points[o].y = pts[i - 1].y;
-		points[o].z = pts[i - 1].z;
-	}
-
-	o = i + offset;
-	points[o].x = pts[0].x;
-	points[o].y = pts[0].y;
-	points[o].z = pts[0].z;
-
-	// original tutorial has cone bottom
-	// not necessary when cone is a spaceship!
-}
-
-const int space = 30;
-float* sinCalc = new float[360 - space];
-float* cosCalc = new float[360 - space];
-bool calculated = false;
-
-// function derived from tutorial at:
-// http://www.swiftless.com/tutorials/opengl/sphere.html
-void CreateSphere(double R, double H, double K, double Z, int offset) {
-	int n;
-	double a;
-	double b;
-	n = 0;
-
-	if (!calculated)
-	{
-		for (b = 0; b <= 90 - space; b += space)
-		{
-			for (a = 0; a <= 360 - space; a += space)
-			{
-				sinCalc[(int)a] = sin((a) / 180 * PI);
-				sinCalc[(int)b] = sin((b) / 180 * PI);
-				cosCalc[(int)a] = cos((a) / 180 * PI);
-				cosCalc[(int)b] = cos((b) / 180 * PI);
-				sinCalc[(int)(a + space)] = sin((a + space) / 180 * PI);
-				sinCalc[(int)(b + space)] = sin((b + space) / 180 * PI);
-				cosCalc[(int)(a + space)] = cos((a + space) / 180 * PI);
-				cosCalc[(int)(b + space)] = cos((b + space) / 180 * PI);
-			}
-		}
-		calculated = true;
-	}
-
-	// draw the front half
-	for (b = 0; b <= 90 - space; b += space){
-		for (a = 0; a <= 360 - space; a += space){
-
-			points[n + offset].x = R * sinCalc[(int)a] * sinCalc[(int)b] - H;
-			points[n + offset].y = R * cosCalc[(int)a] * sinCalc[(int)b] + K;
-			points[n + offset].z = R * cosCalc[(int)b] - Z;
-			n++;
-
-			points[n + offset].x = R * sinCalc[(int)a] * sinCalc[(int)(b + space)] - H;
-			points[n + offset].y = R * cosCalc[(int)a] * sinCalc[(int)(b + space)] + K;
-			points[n + offset].z = R * cosCalc[(int)(b + space)] - Z;
-			n++;
-			points[n + offset].x = R * sinCalc[(int)(a + space)] * sinCalc[(int)b] - H;
-			points[n + offset].y = R * cosCalc[(int)(a + space)] * sinCalc[(int)b] + K;
-			points[n + offset].z = R * cosCalc[(int)b] - Z;
-			n++;
-			points[n + offset].x = R * sinCalc[(int)(a + space)] * sinCalc[(int)(b + space)] - H;
-			points[n + offset].y = R * cosCalc[(int)(a + space)] * sinCalc[(int)(b + space)] + K;
-			points[n + offset].z = R * cosCalc[(int)(b + space)] - Z;
-			n++;
-		}
-	}
-
-	// draw the back half
-	for (b = 0; b <= 90 - space; b += space){
-		for (a = 0; a <= 360 - space; a += space){
-
-			points[n + offset].x = R * sinCalc[(int)a] * sinCalc[(int)b] - H;
-			points[n + offset].y = R * cosCalc[(int)a] * sinCalc[(int)b] + K;
-			points[n + offset].z = -1 * (R * cosCalc[(int)b]) - Z;
-			n++;
-
-			points[n + offset].x = R * sinCalc[(int)a] * sinCalc[(int)(b + space)] - H;
-			points[n + offset].y = R * cosCalc[(int)a] * sinCalc[(int)(b + space)] + K;
-			points[n + offset].z = -1 * (R * cosCalc[(int)(b + space)]) - Z;
-			n++;
-			points[n + offset].x = R * sinCalc[(int)(a + space)] * sinCalc[(int)b] - H;
-			points[n + offset].y = R * cosCalc[(int)(a + space)] * sinCalc[(int)b] + K;
-			points[n + offset].z = -1 * (R * cosCalc[(int)b]) - Z;
-			n++;
-			points[n + offset].x = R * sinCalc[(int)(a + space)] * sinCalc[(int)(b + space)] - H;
-			points[n + offset].y = R * cosCalc[(int)(a + space)] * sinCalc[(int)(b + space)] + K;
-			points[n + offset].z = -1 * (R * cosCalc[(int)(b + space)]) - Z;
-			n++;
-		}
-	}
-
-}
-
+ChunkedField *streamedField = NULL; // Unbounded field, in place of the two above, if streamed.
+Snapshot fieldSnapshot; // Snapshot the store and quadtree are attached to, if loaded.
+thread quadtreeBuilder; // Thread building the quadtree at start-up ...
+atomic<int> isQuadtreePublished(0); // ... which sets this once it has finished with the tree; only 
+                                    // then may any other thread use it.
+
+// Drifting asteroids: the velocity of each asteroid in the store, and the positions and masses
+// gathered for the gravity computation.
+vector<float> driftVelocityX, driftVelocityZ;
+vector<glm::vec3> driftPositions, driftAccelerations;
+vector<float> driftMasses;
+SweepAndPrune asteroidsBroadPhase;
+vector<CollisionPair> asteroidCollisions;
+
+FramePipeline framePipeline; // Culls the next frame while the current one is drawn.
+vector< vector<int> > visibleAsteroids; // Asteroids let through by culling to each frustum, on the culling thread.
+vector<int> drawnMarks; // Stamps of the asteroids given draw commands, to give each only one a viewport,
+int drawnMark = 0;      // on the culling thread.
+
+InputQueue inputQueue; // Key events waiting for the next simulation tick.
+InputRecording inputRecording; // Key events applied, if recorded, or to be applied, if replayed.
+SimulationClock simulationClock(SIMULATION_TICK);
+
+TextOverlay overlay; // Messages and performance counters drawn over the scene.
+QuadtreeView quadtreeView; // Debug view of the culling, drawn over the fixed camera's viewport ...
+vector<NodeVisit> nodeVisits; // ... from the squares visited, found on the culling thread.
+GLBackend glBackend; // What the frames can be drawn through ...
+NullBackend nullBackend;
+RecordingBackend recordingBackend;
+RenderBackend *renderer = &glBackend; // ... and what they are, as set by --backend.
+CounterAverages counterAverages; // Counters of the frames drawn, averaged for showing. 
 
 // OpenGL window reshape routine.
 void resize(GLFWwindow* window, int w, int h)
@@ -249,20 +231,87 @@ void resize(GLFWwindow* window, int w, int h)
 	height = h;
 }
 
-// Initialization routine.
-void setup(void) 
+// Routine run on a thread of its own at start-up to build the quadtree over the field, so that the
+// window can come up at once. The tree is published, for the drawing and collision queries to use
+// in place of brute force, only when it is complete.
+void buildQuadtree(void)
 {
-   int i, j;
-   float initialSize;
-   // create meory for each potential asteroid
-   arrayAsteroids = new Asteroid *[ROWS];
-   for (int i = 0; i < ROWS; i++) {
-	   arrayAsteroids[i] = new Asteroid[COLUMNS];
-   }
+   nameTraceThread("Quadtree builder");
+   int phase = beginAllocationPhase(ALLOCATION_BUILD);
+   chrono::steady_clock::time_point start = chrono::steady_clock::now();
+   asteroidsQuadtree.initialize( fieldX, fieldZ, fieldSize );
+   double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+   setAllocationPhase(phase);
+
+   isQuadtreePublished.store(1, memory_order_release);
+   cout << "Quadtree ready after " << elapsed * 1000.0 << " ms." << endl;
+}
+
+// Routine to wait for the build of the quadtree at start-up to finish, if it has not.
+void finishQuadtreeBuild(void)
+{
+   if (quadtreeBuilder.joinable()) quadtreeBuilder.join();
+}
+
+// Routine to stop the threads that work alongside the main thread, at the end of the program: the
+// frame pipeline's, the quadtree builder and the chunk generators of a streamed field.
+void stopThreads(void)
+{
+   framePipeline.stop();
+   finishQuadtreeBuild();
+   delete streamedField;
+   streamedField = NULL;
+}
+
+// Return the number of threads to spread work over: as set, or else one per core.
+int numberThreads(void)
+{
+   if (config.threads > 0) return config.threads;
+   return max(1, (int)thread::hardware_concurrency());
+}
+
+// Initialization routine for the asteroid field, the quadtree and the vertex data, generated or
+// loaded from a snapshot; it makes no OpenGL calls, so it serves the headless simulation as well.
+// A generated quadtree is left building in the background, unless it is to be saved in a snapshot.
+// Return 1 if done, or report the problem and return 0.
+int setupField(void) 
+{
+   TRACE_SCOPE("setupField");
+   float firstX, firstZ;
+   int rows = config.rows, columns = config.columns;
+   float spacing = config.spacing;
+   // the store takes only the slots that are filled
+   asteroids.reset(columns);
 
    // create the quad tree for the asteroids
-   asteroidsQuadtree.setRowsCols(ROWS, COLUMNS);
-   asteroidsQuadtree.setArray(arrayAsteroids);
+   asteroidsQuadtree.setStore(&asteroids);
+
+   if (config.isStreamed && (!config.loadFile.empty() || !config.saveFile.empty()))
+   {
+      cerr << "An unbounded field cannot be saved or loaded." << endl;
+	  return 0;
+   }
+   if (!config.loadFile.empty())
+   {
+      // The snapshot is used where it is mapped, except for the vertex data, which the vertex
+	  // buffer takes a copy of anyway.
+      if (!fieldSnapshot.open(config.loadFile.c_str())) return 0;
+	  const SnapshotHeader &header = fieldSnapshot.getHeader();
+	  if (header.numVertices != (int)points.size())
+	  {
+	     cerr << "The snapshot's vertex data is not laid out as this program's." << endl;
+		 return 0;
+	  }
+	  fieldSnapshot.attach(asteroids, asteroidsQuadtree);
+	  isQuadtreePublished = 1;
+	  points.assign(fieldSnapshot.getVertices(), fieldSnapshot.getVertices() + header.numVertices);
+	  config.rows = header.rows; config.columns = header.columns; config.fillProbability = header.fillProbability;
+	  config.spacing = header.spacing; config.seed = header.seed;
+	  fieldX = header.fieldX; fieldZ = header.fieldZ; fieldSize = header.fieldSize;
+	  srand(config.seed);
+	  return 1;
+   }
+   srand(config.seed);
 
    // create the line for the middle of the screen
    points[line_index].x = 0;
@@ -272,45 +321,49 @@ void setup(void)
    points[line_index + 1].y = 5;
    points[line_index + 1].z = -6;
 
-   // create the cone for a spaceship
-   glm::vec3 direction( 0, 1, 0 );
-   glm::vec3 apex(0, 10, 0);
-   CreateCone(direction, apex, 10, 5, 10, cone_index);
-
-   // create where the spheres are going in the field   
-   int index = sphere_index;
-   // Initialize global arrayAsteroids.
-   for (i = 0; i<ROWS; i++)
-	for (j=0; j<COLUMNS; j++)
-		  if (rand() % 100 < FILL_PROBABILITY)
-			  // If rand()%100 >= FILL_PROBABILITY the default constructor asteroid remains in the slot which
-			  // indicates that there is no asteroid there because the default's radius is 0.
-		  {
-	   // Position the asteroids depending on if there is an even or odd number of columns
-	   // so that the spacecraft faces the middle of the asteroid field.
-	   if (COLUMNS % 2) // Odd number of columns. 
-	   {
-		   arrayAsteroids[i][j] = Asteroid(30.0*(-COLUMNS / 2 + j), 0.0, -40.0 - 30.0*i, 3.0,
-			   rand() % 256, rand() % 256, rand() % 256);
-		   arrayAsteroids[i][j].setIndex(index);
-		   CreateSphere(SPHERE_SIZE, 0, 0, 0, index);
-		   index += SPHERE_VERTEX_COUNT;
-	   }
-	   else // Even number of columns. 
-	   {
-		   arrayAsteroids[i][j] = Asteroid(15.0 + 30.0*(-COLUMNS / 2 + j), 0.0, -40.0 - 30.0*i, 3.0,
-			   rand() % 256, rand() % 256, rand() % 256);
-		   arrayAsteroids[i][j].setIndex(index);
-		   CreateSphere(SPHERE_SIZE, 0, 0, 0, index);
-		   index += SPHERE_VERTEX_COUNT;
-	   }
-		  }
-
-   // Initialize global asteroidsQuadtree - the root square bounds the entire asteroid field.
-   if (ROWS <= COLUMNS) initialSize = (COLUMNS - 1)*30.0 + 6.0;
-   else initialSize = (ROWS - 1)*30.0 + 6.0;
-   asteroidsQuadtree.initialize( -initialSize/2.0, -37.0, initialSize );
-   
+   // copy in the cone for a spaceship and the sphere all the asteroids share
+   memcpy(&points[cone_index], coneMesh.vertices, sizeof(coneMesh.vertices));
+   memcpy(&points[sphere_index], sphereMesh.vertices, sizeof(sphereMesh.vertices));
+
+   if (config.isStreamed)
+   {
+      streamedField = new ChunkedField(config.seed, config.fillProbability, spacing, ASTEROID_RADIUS,
+		  (size_t)config.budget * 1024 * 1024, numberThreads());
+	  streamedField->update(craft.x, craft.z, craft.angle);
+	  return 1;
+   }
+
+   // Initialize global asteroids, in parallel; each slot is filled and colored from random numbers
+   // of its own, so the field is the same for any number of threads. Empty slots take no room in 
+   // the store. The spacecraft faces the middle of the asteroid field.
+   layOutField(rows, columns, spacing, ASTEROID_RADIUS, firstX, firstZ, fieldX, fieldZ, fieldSize);
+   generateField(asteroids, rows, columns, config.fillProbability, config.seed, firstX, firstZ, spacing,
+                 ASTEROID_RADIUS, numberThreads());
+
+   // Initialize global asteroidsQuadtree - the root square bounds the entire asteroid field. While
+   // allocations are tracked it is built here, so that what the build allocates is counted alone.
+   if (config.saveFile.empty() && !config.isAllocationTracked)
+   {
+      quadtreeBuilder = thread(buildQuadtree);
+	  return 1;
+   }
+   buildQuadtree();
+   if (config.saveFile.empty()) return 1;
+   SnapshotHeader header;
+   memset(&header, 0, sizeof(header));
+   header.rows = rows; header.columns = columns; header.fillProbability = config.fillProbability;
+   header.spacing = spacing; header.seed = config.seed;
+   header.fieldX = fieldX; header.fieldZ = fieldZ; header.fieldSize = fieldSize;
+   if (!saveSnapshot(config.saveFile.c_str(), header, asteroids, asteroidsQuadtree, points.data(), points.size()))
+      return 0;
+   cout << "Snapshot written to " << config.saveFile << "." << endl;
+   return 1;
+}
+
+// Initialization routine for the graphics.
+void setupGraphics(void)
+{
+   TRACE_SCOPE("setupGraphics");
    // initialize the graphics
    glEnable(GL_DEPTH_TEST);
    glClearColor (0.0, 0.0, 0.0, 0.0);
@@ -330,7 +383,7 @@ void setup(void)
    glGenBuffers(1, &aBuffer);
    myBuffer = aBuffer;
    glBindBuffer(GL_ARRAY_BUFFER, myBuffer);
-   glBufferData(GL_ARRAY_BUFFER, sizeof(points), points, GL_STATIC_DRAW);
+   glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(glm::vec3), points.data(), GL_STATIC_DRAW);
 
    // Load shaders and use the resulting shader program
    GLuint program = InitShader("vshader.glsl", "fshader.glsl");
@@ -342,6 +395,8 @@ void setup(void)
    glEnableVertexAttribArray(loc);
    glVertexAttribPointer(loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
 
+   overlay.setup();
+   quadtreeView.setup();
 }
 
 // Function to check if two spheres centered at (x1,y1,z1) and (x2,y2,z2) with
@@ -352,26 +407,210 @@ int checkSpheresIntersection(float x1, float y1, float z1, float r1,
    return ( (x1-x2)*(x1-x2) + (y1-y2)*(y1-y2) + (z1-z2)*(z1-z2) <= (r1+r2)*(r1+r2) );
 }
 
-// Function to check if the spacecraft collides with an asteroid when the center of the base
-// of the craft is at (x, 0, z) and it is aligned at an angle a to to the -z direction.
-// Collision detection is approximate as instead of the spacecraft we use a bounding sphere.
-int asteroidCraftCollision( float x, float z, float a)
+// Routine to bring the quadtree up to date if asteroids have moved since it was built, in place
+// when no square need be split or joined. This is left until the tree is needed, so ticks that do
+// not use it (several may run per frame) do not pay for it, nor does a headless run without
+// gravity or spacecraft movement.
+void refreshQuadtree(void)
+{
+   finishQuadtreeBuild();
+   if (isQuadtreeStale)
+   {
+      asteroidsQuadtree.refresh( fieldX, fieldZ, fieldSize );
+	  isQuadtreeStale = 0;
+   }
+}
+
+// Routine to append the commands to draw all the asteroids, of the field or of the resident chunks
+// of a streamed field.
+void collectFieldAll(vector<AsteroidDrawCommand> &commands)
 {
-   int i,j;
-
-   float xSphereCalc = x - 5 * sin((PI / 180.0) * a);
-   float zSphereCalc = z - 5 * cos((PI / 180.0) * a);
-
-   // Check for collision with each asteroid.
-   for (i = 0; i<ROWS; i++)
-   for (j=0; j<COLUMNS; j++)
-		 if (arrayAsteroids[i][j].getRadius() > 0 ) // If asteroid exists.
-            if ( checkSpheresIntersection(xSphereCalc, 0.0,
-				zSphereCalc, 7.072,
-		         arrayAsteroids[i][j].getCenterX(), arrayAsteroids[i][j].getCenterY(), 
-		         arrayAsteroids[i][j].getCenterZ(), arrayAsteroids[i][j].getRadius() ) )
-		       return 1;
-   return 0;
+   if (streamedField != NULL) streamedField->collectAllDrawCommands(commands);
+   else asteroids.appendAllDrawCommands(commands);
+}
+
+// Brute-force stand-in for Quadtree::sweepSphere while the quadtree is being built: each asteroid,
+// grown by the radius, is tested against the segment from start to end.
+SweepHit sweepSphereBruteForce(const glm::vec3 &start, const glm::vec3 &end, float radius)
+{
+   int id, n = asteroids.size();
+   float t, length = glm::length(end - start), best = length;
+   glm::vec3 direction = (length > 0.0) ? (end - start) / length : glm::vec3(1.0, 0.0, 0.0);
+   SweepHit sweep;
+   sweep.asteroid = -1;
+   sweep.timeOfImpact = 1.0;
+
+   for (id = 0; id < n; id++)
+      if ( checkRaySphereIntersection(start.x, start.y, start.z, direction.x, direction.y, direction.z,
+		   asteroids.cx[id], asteroids.cy[id], asteroids.cz[id], asteroids.r[id] + radius, best, &t) 
+		 )
+	     if (sweep.asteroid < 0 || t < best)
+		 {
+		    sweep.asteroid = id;
+			best = t;
+		 }
+   if (sweep.asteroid >= 0) sweep.timeOfImpact = (length > 0.0) ? best / length : 0.0;
+   return sweep;
+}
+
+// Routine to append to commands[k] the commands to draw only the asteroids in leaf squares that
+// intersect frustum k, each once, from the quadtree of the field or of each resident chunk of a streamed field,
+// in a single traversal for all the frusta, which for a large field is shared among the threads;
+// until the quadtree of the field is ready each asteroid is tested. The work is added to stats.
+void collectFieldCulled(const Frustum *frusta, int numFrusta, vector<AsteroidDrawCommand> *commands,
+						CullStats &stats)
+{
+   int k;
+   if (streamedField != NULL)
+   {
+      streamedField->collectDrawCommands(frusta, numFrusta, commands, &stats);
+	  return;
+   }
+   if ((int)visibleAsteroids.size() < numFrusta) visibleAsteroids.resize(numFrusta);
+   for (k = 0; k < numFrusta; k++) visibleAsteroids[k].clear();
+   if (!isQuadtreePublished.load(memory_order_acquire)) 
+      collectAsteroidsBruteForce(asteroids, frusta, numFrusta, visibleAsteroids.data(), &stats);
+   else
+   {
+      refreshQuadtree();
+	  asteroidsQuadtree.resetCullStats();
+	  asteroidsQuadtree.collectAsteroids(frusta, numFrusta, visibleAsteroids.data(), numberThreads());
+	  stats.nodesVisited += asteroidsQuadtree.getCullStats().nodesVisited;
+	  stats.tests += asteroidsQuadtree.getCullStats().tests;
+   }
+   TRACE_SCOPE("appendDrawCommands");
+   for (k = 0; k < numFrusta; k++)
+      asteroids.appendDrawCommands(visibleAsteroids[k].data(), visibleAsteroids[k].size(), drawnMarks, drawnMark, 
+								   commands[k]);
+}
+
+// Routine to make the commands of a frame for the view, on the culling thread of the frame pipeline:
+// the asteroids to draw in each viewport, all of them or those let through by frustum culling, with
+// the frusta of both viewports culled in one traversal. Only the fixed camera's viewport is given
+// commands when culling is off, as the other draws the same. The time and work are kept with the
+// frame, for the counters. If the view shows the quadtree, the lines of the squares the quadtree's
+// traversal visited are made here too, after the time is taken, as the quadtree may be rebuilt
+// here and so is not to be read by the drawing thread.
+void cullFrame(const ViewState &view, FrameCommands &frame)
+{
+   TRACE_SCOPE("cullFrame");
+   Frustum frusta[FRAME_VIEWPORTS];
+   int k;
+   chrono::steady_clock::time_point start = chrono::steady_clock::now();
+   for (k = 0; k < FRAME_VIEWPORTS; k++) frame.viewports[k].clear();
+   frame.cullStats.nodesVisited = frame.cullStats.tests = 0;
+
+   if (!view.isFrustumCulled) collectFieldAll(frame.viewports[FIXED_VIEWPORT]);
+   else
+   {
+      viewFrusta(view, frusta);
+      collectFieldCulled(frusta, FRAME_VIEWPORTS, frame.viewports, frame.cullStats);
+   }
+   frame.cullTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+   frame.quadtreeLines.vertices.clear();
+   for (k = 0; k < NUM_NODE_OUTCOMES; k++) frame.quadtreeLines.numNodes[k] = 0;
+   if (view.isFrustumCulled && view.isQuadtreeShown && streamedField == NULL && isQuadtreePublished.load(memory_order_acquire))
+      makeQuadtreeLines(asteroidsQuadtree, frusta, FRAME_VIEWPORTS, nodeVisits, frame.quadtreeLines);
+}
+
+// Return the first asteroid, of the field or of a streamed field, touched by a sphere moving from 
+// start to end (see Quadtree::sweepSphere).
+SweepHit sweepField(const glm::vec3 &start, const glm::vec3 &end, float radius)
+{
+   TRACE_SCOPE("sweepField");
+   if (streamedField != NULL) return streamedField->sweepSphere(start, end, radius);
+   if (!isQuadtreePublished.load(memory_order_acquire)) return sweepSphereBruteForce(start, end, radius);
+   refreshQuadtree();
+   return asteroidsQuadtree.sweepSphere(start, end, radius);
+}
+
+// Routine to move the drifting asteroids one tick on. If gravity is on the velocities are first
+// changed by the mutual attraction of the asteroids, computed with the quadtree (built for the 
+// current positions) or by direct summation. Asteroids bounce off the sides of the square bounding
+// the field and off each other: the sweep-and-prune broad phase finds the intersecting pairs, and
+// each pair still approaching swaps the components of their velocities along the line of centers
+// (an elastic collision of equal masses). The quadtree is left stale, to be rebuilt when next used.
+void moveAsteroids(void)
+{
+   TRACE_SCOPE("moveAsteroids");
+   int i, n = asteroids.size(), numThreads;
+
+   // The asteroids must not move under the build of the quadtree at start-up.
+   finishQuadtreeBuild();
+
+   // The first time round give each asteroid a random velocity.
+   if ((int)driftVelocityX.size() != n)
+   {
+      for (i = 0; i < n; i++)
+	  {
+		 driftVelocityX.push_back( DRIFT_SPEED * (rand() % 201 - 100) / 100.0 );
+		 driftVelocityZ.push_back( DRIFT_SPEED * (rand() % 201 - 100) / 100.0 );
+	  }
+	  driftPositions.resize(n); driftAccelerations.resize(n); driftMasses.resize(n);
+   }
+   numThreads = numberThreads();
+
+   if (gravityMode != GRAVITY_OFF)
+   {
+      for (i = 0; i < n; i++)
+	  {
+	     driftPositions[i] = glm::vec3(asteroids.cx[i], asteroids.cy[i], asteroids.cz[i]);
+		 driftMasses[i] = asteroids.getMass(i);
+	  }
+	  if (gravityMode == GRAVITY_BARNES_HUT)
+	  {
+	     refreshQuadtree();
+	     asteroidsQuadtree.computeAccelerations(driftPositions.data(), n, BARNES_HUT_THETA, GRAVITY_CONSTANT,
+			 GRAVITY_SOFTENING, driftAccelerations.data(), numThreads);
+	  }
+	  else
+	     computeAccelerationsDirect(driftPositions.data(), driftMasses.data(), n, GRAVITY_CONSTANT,
+			 GRAVITY_SOFTENING, driftAccelerations.data(), numThreads);
+	  for (i = 0; i < n; i++)
+	  {
+	     driftVelocityX[i] += driftAccelerations[i].x;
+		 driftVelocityZ[i] += driftAccelerations[i].z;
+	  }
+   }
+
+   // Straight over the arrays of the store, with no branches but the selects of the bounces, so
+   // the compiler can vectorise the loop.
+   float *x = asteroids.cx, *z = asteroids.cz, *r = asteroids.r;
+   float *velocityX = driftVelocityX.data(), *velocityZ = driftVelocityZ.data();
+   for (i = 0; i < n; i++)
+   {
+	  x[i] += velocityX[i];
+	  z[i] += velocityZ[i];
+	  velocityX[i] = (x[i] - r[i] < fieldX || x[i] + r[i] > fieldX + fieldSize) ? -velocityX[i] : velocityX[i];
+	  velocityZ[i] = (z[i] + r[i] > fieldZ || z[i] - r[i] < fieldZ - fieldSize) ? -velocityZ[i] : velocityZ[i];
+   }
+
+   asteroidsBroadPhase.update(x, asteroids.cy, z, r, n);
+   asteroidsBroadPhase.findCollisions(asteroidCollisions, numThreads);
+
+   for (i = 0; i < (int)asteroidCollisions.size(); i++)
+   {
+      int a = asteroidCollisions[i].first, b = asteroidCollisions[i].second;
+	  float normalX = x[b] - x[a], normalZ = z[b] - z[a];
+	  float relative = (driftVelocityX[b] - driftVelocityX[a]) * normalX + (driftVelocityZ[b] - driftVelocityZ[a]) * normalZ;
+	  float lengthSquared = normalX * normalX + normalZ * normalZ;
+	  if (relative < 0.0 && lengthSquared > 0.0)
+	  {
+	     float impulse = relative / lengthSquared;
+		 driftVelocityX[a] += impulse * normalX; driftVelocityZ[a] += impulse * normalZ;
+		 driftVelocityX[b] -= impulse * normalX; driftVelocityZ[b] -= impulse * normalZ;
+	  }
+   }
+
+   isQuadtreeStale = 1;
+}
+
+// Return the center of the spacecraft's bounding sphere when the center of the base of the craft
+// is at (x, 0, z) and it is aligned at an angle a to the -z direction.
+glm::vec3 craftBoundingCenter(float x, float z, float a)
+{
+   return glm::vec3(x - 5 * sin((PI / 180.0) * a), 0.0, z - 5 * cos((PI / 180.0) * a));
 }
 
 // function taken from glu
@@ -425,269 +664,706 @@ float centery, float centerz, float upx, float upy, float upz)
 	m[1][2] = -forward[1];
 	m[2][2] = -forward[2];
 
-	glMultMatrixf((const GLfloat *)m[0]);
-	glTranslated(-eyex, -eyey, -eyez);
+	renderer->multMatrix((const GLfloat *)m[0]);
+	renderer->translate(-eyex, -eyey, -eyez);
 }
 
 
-// Drawing routine.
-void drawScene(void)
+// Routine to draw the text over both viewports, in one draw call: whether culling is on and any
+// collision at the top of each, and, unless hidden, the performance counters at the bottom.
+void drawOverlay(const FrameCommands &frame)
+{
+   static const char *viewportNames[FRAME_VIEWPORTS] = { "Fixed camera", "Spacecraft" };
+   const FrameCounters &shown = counterAverages.getAverages();
+   char text[256];
+   int k;
+
+   overlay.clear();
+   for (k = 0; k < FRAME_VIEWPORTS; k++)
+   {
+      float left = k * width / 2.0 + TEXT_LINE_HEIGHT;
+	  overlay.addText(left, TEXT_LINE_HEIGHT, frame.view.isFrustumCulled ? "Frustum culling on." : "Frustum culling off.",
+		  255, 255, 255);
+	  if (isCollision) overlay.addText(left, 2 * TEXT_LINE_HEIGHT, "Cannot - will crash!", 255, 0, 0);
+   }
+
+   // The key to the colors of the squares, with how many there are of each.
+   if (!frame.quadtreeLines.vertices.empty())
+   {
+      float left = TEXT_LINE_HEIGHT;
+	  for (k = 0; k < NUM_NODE_OUTCOMES; k++)
+	  {
+	     const unsigned char *rgb = nodeOutcomeColors[k];
+	     snprintf(text, sizeof(text), "%d %s", frame.quadtreeLines.numNodes[k], nodeOutcomeNames[k]);
+		 overlay.addText(left, 3 * TEXT_LINE_HEIGHT, text, rgb[0], rgb[1], rgb[2]);
+		 left += (strlen(text) + 1) * TEXT_GLYPH_WIDTH * TEXT_SCALE;
+	  }
+   }
+
+   if (isCountersShown)
+   {
+      snprintf(text, sizeof(text), "Frame %.2f ms (%.0f fps)\nCull %.3f ms: %.0f nodes, %.0f tests\nText: %d draw call, %.1f KB",
+	     shown.frameTime, shown.frameTime > 0.0 ? 1000.0 / shown.frameTime : 0.0, shown.cullTime, shown.nodesVisited,
+		 shown.tests, overlay.numberDrawCalls(), overlay.bytesUploaded() / 1024.0);
+	  overlay.addText(TEXT_LINE_HEIGHT, height - 5 * TEXT_LINE_HEIGHT, text, 255, 255, 0);
+	  for (k = 0; k < FRAME_VIEWPORTS; k++)
+	  {
+	     snprintf(text, sizeof(text), "%s: %.0f asteroids, %.0f draw calls, %.1f KB", viewportNames[k],
+		    shown.asteroidsDrawn[k], shown.drawCalls[k], shown.bytesUploaded[k] / 1024.0);
+		 overlay.addText(k * width / 2.0 + TEXT_LINE_HEIGHT, height - 2 * TEXT_LINE_HEIGHT, text, 255, 255, 0);
+	  }
+   }
+   overlay.draw(*renderer, width, height);
+}
+
+// Drawing routine: the frame as culled by the frame pipeline, for the view it was culled for.
+void drawScene(const FrameCommands &frame)
 { 
-   int i, j;
-   glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+   TRACE_SCOPE("drawScene");
+   const ViewState &view = frame.view;
+
+   renderer->clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
    // Use the buffer and shader for each circle.
-   glUseProgram(myShaderProgram);
-   glBindBuffer(GL_ARRAY_BUFFER, myBuffer);
+   renderer->useProgram(myShaderProgram);
+   renderer->bindBuffer(GL_ARRAY_BUFFER, myBuffer);
 
    // Initialize the vertex position attribute from the vertex shader.
-   GLuint loc = glGetAttribLocation(myShaderProgram, "vPosition");
-   glEnableVertexAttribArray(loc);
-   glVertexAttribPointer(loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
-   // copy over global points array in case anything has changed
-   // very slow when points is just HUGE
-   glBindBuffer(GL_ARRAY_BUFFER, myBuffer);
-   glBufferData(GL_ARRAY_BUFFER, sizeof(points), points, GL_STATIC_DRAW);
+   GLuint loc = renderer->getAttribLocation(myShaderProgram, "vPosition");
+   renderer->enableVertexAttribArray(loc);
+   renderer->vertexAttribPointer(loc, 3, GL_FLOAT, GL_FALSE, 0, 0);
 
    // Begin left viewport.
-   glViewport (0, 0, width/2.0,  height); 
-   glLoadIdentity();
-   
-   // Write text in isolated (i.e., before gluLookAt) translate block.
-   // DOES NOT WORK WITHOUT GLUT 
-   //glPushMatrix();
-   //glColor3f(1.0, 1.0, 1.0);
-   //glRasterPos3f(5.0, 25.0, -30.0);
-   //if (isFrustumCulled) writeBitmapString((void*)font, "Frustum culling on!");
-   //else writeBitmapString((void*)font, "Frustum culling off!");
-   //glColor3f(1.0, 0.0, 0.0);
-   //glRasterPos3f(-28.0, 25.0, -30.0);
-   //if (isCollision) writeBitmapString((void*)font, "Cannot - will crash!");
-   //glPopMatrix();
+   renderer->viewport(0, 0, width/2.0,  height); 
+   renderer->loadIdentity();
    
    // Fixed camera 
    lookAt(0.0, 10.0, 20.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0);
 
-   if (!isFrustumCulled)
+   // Draw all the asteroids, or only those in leaf squares of the quadtree that intersect the 
+   // fixed frustum with apex at the origin.
    {
-	   // Draw all the asteroids in arrayAsteroids.
-	   for (i = 0; i < ROWS; i++)
-	   {
-		   for (j = 0; j < COLUMNS; j++)
-		   {
-				arrayAsteroids[i][j].draw();
-		   }
-	   }
-   }
-   else
-   {
-	   // Draw only asteroids in leaf squares of the quadtree that intersect the fixed frustum
-	   // with apex at the origin.
-	   asteroidsQuadtree.drawAsteroids(-5.0, -5.0, -250.0, -250.0, 250.0, -250.0, 5.0, -5.0);
+      TRACE_SCOPE("draw fixed viewport");
+      AsteroidStore::draw(*renderer, frame.viewports[FIXED_VIEWPORT], sphere_index);
    }
 
-   glViewport(0, 0, width / 2.0, height);
-   glLoadIdentity();
+   renderer->viewport(0, 0, width / 2.0, height);
+   renderer->loadIdentity();
 
    lookAt(0.0, 10.0, 20.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0);
 
    // off is white spaceship and on it red
-   if (isFrustumCulled)
-	glColor3f(1.0, 0.0, 0.0);
+   if (view.isFrustumCulled)
+	renderer->color3f(1.0, 0.0, 0.0);
    else 
-	glColor3f(1.0, 1.0, 1.0);
+	renderer->color3f(1.0, 1.0, 1.0);
 
    // spacecraft moves and so we translate/rotate according to the movement
-   glPushMatrix();
-   glTranslatef(xVal, 0, zVal);
-   glRotatef(angle, 0.0, 1.0, 0.0);
+   renderer->pushMatrix();
+   renderer->translate(view.x, 0, view.z);
+   renderer->rotate(view.angle, 0.0, 1.0, 0.0);
 
-   glPushMatrix();
-   glRotatef(-90.0, 1.0, 0.0, 0.0); // To make the spacecraft point down the $z$-axis initially.
+   renderer->pushMatrix();
+   renderer->rotate(-90.0, 1.0, 0.0, 0.0); // To make the spacecraft point down the $z$-axis initially.
 
    // Turn on wireframe mode
-   glPolygonMode(GL_FRONT, GL_LINE);
-   glPolygonMode(GL_BACK, GL_LINE);
-   glDrawArrays(GL_TRIANGLE_FAN, cone_index, CONE_VERTEX_COUNT);
+   renderer->polygonMode(GL_FRONT, GL_LINE);
+   renderer->polygonMode(GL_BACK, GL_LINE);
+   renderer->drawArrays(GL_TRIANGLE_FAN, cone_index, CONE_VERTEX_COUNT);
    // Turn off wireframe mode
-   glPolygonMode(GL_FRONT, GL_FILL);
-   glPolygonMode(GL_BACK, GL_FILL);
-   glPopMatrix();
+   renderer->polygonMode(GL_FRONT, GL_FILL);
+   renderer->polygonMode(GL_BACK, GL_FILL);
+   renderer->popMatrix();
+   renderer->popMatrix();
    // End left viewport.
    
    // Begin right viewport.
-   glViewport(width/2.0, 0, width/2.0, height);
-   glLoadIdentity();
-
-   // Write text in isolated (i.e., before gluLookAt) translate block.
-   // DOES NOT WORK WITHOUT GLUT
-   //glPushMatrix();
-   //glColor3f(1.0, 1.0, 1.0);
-   //glRasterPos3f(5.0, 25.0, -30.0);
-   //if (isFrustumCulled)  writeBitmapString((void*)font, "Frustum culling on.");
-   //else writeBitmapString((void*)font, "Frustum culling off.");
-   //glColor3f(1.0, 0.0, 0.0);
-   //glRasterPos3f(-28.0, 25.0, -30.0);
-   //if (isCollision)  writeBitmapString((void*)font, "Cannot - will crash!");
-   //glPopMatrix();
+   renderer->viewport(width/2.0, 0, width/2.0, height);
+   renderer->loadIdentity();
 
    // draw the line in the middle to separate the two viewports
-   glPushMatrix();
-   glTranslatef(-6, 0, 0);
-   glColor3f(1.0, 1.0, 1.0);
-   glLineWidth(2.0);
-   glDrawArrays(GL_LINE_STRIP, line_index, LINE_VERTEX_COUNT);
-   glLineWidth(1.0);
-   glPopMatrix();
+   renderer->pushMatrix();
+   renderer->translate(-6, 0, 0);
+   renderer->color3f(1.0, 1.0, 1.0);
+   renderer->lineWidth(2.0);
+   renderer->drawArrays(GL_LINE_STRIP, line_index, LINE_VERTEX_COUNT);
+   renderer->lineWidth(1.0);
+   renderer->popMatrix();
 
    // Locate the camera at the tip of the cone and pointing in the direction of the cone.
-   lookAt(xVal - 10 * sin( (PI/180.0) * angle), 0.0, zVal - 10 * cos( (PI/180.0) * angle), xVal - 11 * sin( (PI/180.0) * angle), 0.0,
-             zVal - 11 * cos( (PI/180.0) * angle), 0.0, 1.0, 0.0);
+   lookAt(view.x - 10 * sin( (PI/180.0) * view.angle), 0.0, view.z - 10 * cos( (PI/180.0) * view.angle), 
+	      view.x - 11 * sin( (PI/180.0) * view.angle), 0.0, view.z - 11 * cos( (PI/180.0) * view.angle), 0.0, 1.0, 0.0);
 
-   if (!isFrustumCulled)
+   // Draw all the asteroids, or only those in leaf squares of the quadtree that intersect the
+   // frustum "carried" by the spacecraft.
    {
-	   // Draw all the asteroids in arrayAsteroids.
-	   for (i = 0; i < ROWS; i++)
-	   {
-		   for (j = 0; j < COLUMNS; j++)
-		   {
-			   arrayAsteroids[i][j].draw();
-		   }
-	   }
+      TRACE_SCOPE("draw spacecraft viewport");
+      AsteroidStore::draw(*renderer, frame.viewports[view.isFrustumCulled ? CRAFT_VIEWPORT : FIXED_VIEWPORT], sphere_index);
    }
-   else
+   // End right viewport.
+
+   // Draw the squares the culling visited, and the frusta, over the left viewport.
+   if (!frame.quadtreeLines.vertices.empty())
    {
-	   // Draw only asteroids in leaf squares of the quadtree that intersect the frustum
-	   // "carried" by the spacecraft with apex at its tip and oriented with its axis
-	   // along the spacecraft's axis.
-
-	   float sinAnglePlu = sin((PI / 180.0) * (45.0 + angle));
-	   float cosAnglePlu = cos((PI / 180.0) * (45.0 + angle));
-	   float sinAngleMin = sin((PI / 180.0) * (45.0 - angle));
-	   float cosAngleMin = cos((PI / 180.0) * (45.0 - angle));
-
-	   asteroidsQuadtree.drawAsteroids(xVal - 7.072 * sinAnglePlu,
-		   zVal - 7.072 * cosAnglePlu,
-		   xVal - 353.6 * sinAnglePlu,
-		   zVal - 353.6 * cosAnglePlu,
-		   xVal + 353.6 * sinAngleMin,
-		   zVal - 353.6 * cosAngleMin,
-		   xVal + 7.072 * sinAngleMin,
-		   zVal - 7.072 * cosAngleMin
-		   );
+      renderer->viewport(0, 0, width / 2.0, height);
+	  renderer->loadIdentity();
+	  lookAt(0.0, 10.0, 20.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0);
+	  quadtreeView.draw(*renderer, frame.quadtreeLines);
    }
-   // End right viewport.
 
+   drawOverlay(frame);
+   renderer->endFrame();
+}
+
+// Routine to write the key events recorded, if they are, to the recording file; return 1 if done
+// or not wanted, or report the problem and return 0.
+int saveRecording(void)
+{
+	if (config.recordFile.empty()) return 1;
+	inputRecording.setNumTicks(tickCount);
+	if (!inputRecording.save(config.recordFile.c_str(), config)) return 0;
+	cout << "Recorded " << inputRecording.numberEvents() << " key events over " << tickCount << " ticks to "
+		 << config.recordFile << "." << endl;
+	return 1;
 }
 
+// Routine to write the trace, if one is being recorded, to the trace file; return 1 if done or not
+// wanted, or report the problem and return 0. The threads traced must have stopped.
+int finishTrace(void)
+{
+	if (config.traceFile.empty()) return 1;
+	if (!writeTrace(config.traceFile.c_str())) return 0;
+	cout << "Trace written to " << config.traceFile << "." << endl;
+	return 1;
+}
+
+// Key callback: escape quits at once; every other key event is queued for the next simulation
+// tick, so that the simulation advances at its own fixed rate whatever the key-repeat rate. In a
+// replay the keys are those recorded, and the keyboard's are ignored.
 void keyInput(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
-	float tempxVal = xVal, tempzVal = zVal, tempAngle = angle;
-	switch (key) {
-      case GLFW_KEY_ESCAPE:
-		exit(0);
-		break;
-	  case GLFW_KEY_SPACE:
-		// only want this to get called once and so call when key
-		// is released
-		if (action == GLFW_RELEASE) {
-			  isFrustumCulled = 1 - isFrustumCulled;
+	if (key == GLFW_KEY_ESCAPE)
+	{
+		stopThreads();
+		int isSaved = saveRecording();
+		exit(finishTrace() && isSaved ? 0 : -1);
+	}
+	if (config.replayFile.empty()) inputQueue.push(key, action);
+}
+
+// Routine to advance the simulation by one tick: the queued key events are applied, the spacecraft
+// turns and moves according to the arrow keys held down, and drifting asteroids move.
+void simulationTick(void)
+{
+	TRACE_SCOPE("simulationTick");
+	InputEvent event;
+	if (!config.replayFile.empty()) inputRecording.replay(tickCount, inputQueue);
+	while (inputQueue.pop(event))
+	{
+		if (!config.recordFile.empty()) inputRecording.record(tickCount, event);
+		int isHeld = (event.action != GLFW_RELEASE);
+		switch (event.key) {
+		  case GLFW_KEY_SPACE:
+			// only want this to get called once and so call when key
+			// is released
+			if (event.action == GLFW_RELEASE) {
+				  isFrustumCulled = 1 - isFrustumCulled;
+			}
+			break;
+		  case GLFW_KEY_M:
+			if (event.action == GLFW_RELEASE) {
+				  isAsteroidsMoving = 1 - isAsteroidsMoving;
+			}
+			break;
+		  case GLFW_KEY_C:
+			if (event.action == GLFW_RELEASE) {
+				  isCountersShown = 1 - isCountersShown;
+			}
+			break;
+		  case GLFW_KEY_Q:
+			if (event.action == GLFW_RELEASE) {
+				  isQuadtreeShown = 1 - isQuadtreeShown;
+			}
+			break;
+		  case GLFW_KEY_G:
+			if (event.action == GLFW_RELEASE) {
+				  gravityMode = (gravityMode + 1) % 3;
+				  if (gravityMode == GRAVITY_OFF) cout << "Gravity off." << endl;
+				  else if (gravityMode == GRAVITY_BARNES_HUT) cout << "Gravity on (Barnes-Hut)." << endl;
+				  else cout << "Gravity on (direct summation)." << endl;
+			}
+			break;
+		  case GLFW_KEY_LEFT: 
+			isLeftHeld = isHeld;
+			break;
+		  case GLFW_KEY_RIGHT: 
+			isRightHeld = isHeld;
+			break;
+		  case GLFW_KEY_UP:
+			isUpHeld = isHeld;
+			break;
+		  case GLFW_KEY_DOWN:
+			isDownHeld = isHeld;
+			break;
+		  default:
+			break;
 		}
-		break;
-	  case GLFW_KEY_LEFT: 
-		tempAngle = angle + 5.0;
-		break;
-	  case GLFW_KEY_RIGHT: 
-		tempAngle = angle - 5.0;
-		break;
-	  case GLFW_KEY_UP:
-		tempxVal = xVal - sin(angle * PI / 180.0);
-		tempzVal = zVal - cos(angle * PI / 180.0);
-		break;
-	  case GLFW_KEY_DOWN:
-		tempxVal = xVal + sin(angle * PI / 180.0);
-		tempzVal = zVal + cos(angle * PI / 180.0);
-		break;
-	  default:
-		break;
-   }
+	}
 
-  // Angle correction.
-  if (tempAngle > 360.0) tempAngle -= 360.0;
-  if (tempAngle < 0.0) tempAngle += 360.0;
+	previousCraft = craft;
 
-  // Move spacecraft to next position only if there will not be collision with an asteroid.
-  if (!asteroidCraftCollision(tempxVal, tempzVal, tempAngle))
-  {
-	  isCollision = 0;
-	  xVal = tempxVal;
-	  zVal = tempzVal;
-	  angle = tempAngle;
-  }
-  else isCollision = 1;
+	if (isLeftHeld || isRightHeld || isUpHeld || isDownHeld)
+	{
+		float tempAngle = craft.angle + (isLeftHeld - isRightHeld) * CRAFT_TURN_RATE * SIMULATION_TICK;
+		float step = (isDownHeld - isUpHeld) * CRAFT_SPEED * SIMULATION_TICK;
+		float tempxVal = craft.x + step * sin(craft.angle * PI / 180.0);
+		float tempzVal = craft.z + step * cos(craft.angle * PI / 180.0);
+
+		// Angle correction.
+		if (tempAngle > 360.0) tempAngle -= 360.0;
+		if (tempAngle < 0.0) tempAngle += 360.0;
+
+		// Sweep the bounding sphere from the current to the next position in a single query, so that
+		// a step of any length cannot pass through an asteroid; a turn sweeps the chord of the arc.
+		SweepHit sweep = sweepField(craftBoundingCenter(craft.x, craft.z, craft.angle),
+			craftBoundingCenter(tempxVal, tempzVal, tempAngle), CRAFT_RADIUS);
+
+		// Move spacecraft to next position only if there will not be collision with an asteroid.
+		if (sweep.asteroid < 0)
+		{
+			isCollision = 0;
+			craft.x = tempxVal;
+			craft.z = tempzVal;
+			craft.angle = tempAngle;
+		}
+		else
+		{
+			isCollision = 1;
 
+			// A straight move is taken up to just short of the point of contact.
+			if (tempAngle == craft.angle && step != 0.0)
+			{
+				float fraction = sweep.timeOfImpact - CONTACT_GAP / fabs(step);
+				if (fraction > 0.0)
+				{
+					craft.x += fraction * (tempxVal - craft.x);
+					craft.z += fraction * (tempzVal - craft.z);
+				}
+			}
+		}
+	}
+
+	if (streamedField != NULL) streamedField->update(craft.x, craft.z, craft.angle);
+	else if (isAsteroidsMoving) moveAsteroids();
+	tickCount++;
+}
+
+// Routine to run the simulation for the given number of ticks without a window, as fast as it
+// will go, with the asteroids drifting; the simulated time is reported against the time taken.
+void runHeadless(int ticks)
+{
+	int i;
+	isAsteroidsMoving = 1;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (i = 0; i < ticks; i++) simulationTick();
+	double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	cout << "Simulated " << ticks << " ticks (" << ticks * SIMULATION_TICK << " s) in " << elapsed << " s: "
+		 << (elapsed > 0.0 ? ticks * SIMULATION_TICK / elapsed : 0.0) << " times real time." << endl;
+}
+
+// Routine to fly the spacecraft straight ahead through an unbounded field for the given number of
+// ticks without a window, to watch the streaming of chunks. The spacecraft sweeps for asteroids
+// each tick as in the interactive program, but passes through them rather than stopping. The
+// chunks generated and the most memory held are reported, with the mean and longest tick.
+void runStreamedFlight(int ticks)
+{
+	int i, numContacts = 0, maxResident = 0;
+	size_t maxBytes = 0;
+	double longest = 0.0, total = 0.0;
+	float step = CRAFT_SPEED * SIMULATION_TICK;
+
+	craft.angle = 30.0; // Across the rows and columns of chunks both.
+	for (i = 0; i < ticks; i++)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		previousCraft = craft;
+		craft.x -= step * sin(craft.angle * PI / 180.0);
+		craft.z -= step * cos(craft.angle * PI / 180.0);
+		SweepHit sweep = streamedField->sweepSphere(craftBoundingCenter(previousCraft.x, previousCraft.z, previousCraft.angle),
+			craftBoundingCenter(craft.x, craft.z, craft.angle), CRAFT_RADIUS);
+		if (sweep.asteroid >= 0) numContacts++;
+		streamedField->update(craft.x, craft.z, craft.angle);
+		double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		total += elapsed;
+		longest = max(longest, elapsed);
+		maxResident = max(maxResident, streamedField->numberChunksResident());
+		maxBytes = max(maxBytes, streamedField->memoryUsed());
+	}
+
+	cout << "Flew " << ticks * step << " units in " << ticks << " ticks, touching asteroids in " << numContacts << " ticks." << endl
+		 << "Chunks generated: " << streamedField->numberChunksGenerated() << ", of which late: " 
+		 << streamedField->numberChunksGeneratedLate() << "." << endl
+		 << "Most chunks resident: " << maxResident << " (" << maxBytes / 1024 << " KB); now " 
+		 << streamedField->numberChunksResident() << " (" << streamedField->memoryUsed() / 1024 << " KB)." << endl
+		 << "Tick: mean " << (ticks > 0 ? total / ticks * 1000.0 : 0.0) << " ms, longest " << longest * 1000.0 << " ms." << endl;
+}
+
+// Routine to print the mean and percentiles of the sorted frame times, which add up to total.
+void printFrameTimes(const vector<double> &frameTimes, double total)
+{
+	if (frameTimes.empty()) return;
+	cout << "Frame time: mean " << total / frameTimes.size() << " ms, p50 " << percentile(frameTimes, 0.50)
+		 << ", p90 " << percentile(frameTimes, 0.90) << ", p99 " << percentile(frameTimes, 0.99)
+		 << ", max " << frameTimes.back() << "." << endl;
+}
+
+// Routine to report the end of a replay: where the spacecraft got to, to compare with other runs
+// of the recording, and the time of each frame drawn.
+void printReplay(vector<double> &frameTimes)
+{
+	double total = 0.0;
+	for (int i = 0; i < (int)frameTimes.size(); i++) total += frameTimes[i];
+	sort(frameTimes.begin(), frameTimes.end());
+
+	cout << "Replayed " << tickCount << " ticks in " << frameTimes.size() << " frames, " << total / 1000.0 << " s; "
+		 << "the spacecraft ended at (" << craft.x << ", " << craft.z << "), angle " << craft.angle << "." << endl;
+	printFrameTimes(frameTimes, total);
+}
+
+// Routine to report the end of a run offscreen: the frames drawn and the time of each.
+void printOffscreen(vector<double> &frameTimes)
+{
+	double total = 0.0;
+	for (int i = 0; i < (int)frameTimes.size(); i++) total += frameTimes[i];
+	sort(frameTimes.begin(), frameTimes.end());
+
+	cout << "Drew " << frameTimes.size() << " frames offscreen in " << total / 1000.0 << " s, "
+		 << (total > 0.0 ? frameTimes.size() * 1000.0 / total : 0.0) << " frames a second." << endl;
+	printFrameTimes(frameTimes, total);
 }
 
 // Routine to output interaction instructions to the C++ window.
 void printInteraction(void)
 {
-   cout << "ALERT: The OpenGL window may take a while to come up because" << endl
-		<< "of the time to build the quadtree!" << endl
+   cout << "ALERT: Frustum culling may be slow until the quadtree is ready!" << endl
 		<<  endl;
    cout << "Interaction:" << endl;
    cout << "Press the left/right arrow keys to turn the craft." << endl
         << "Press the up/down arrow keys to move the craft." << endl
-		<< "Press space to toggle between frustum culling enabled and disabled." << endl;
-   cout << "Total Asteroids: " << ROWS * COLUMNS << endl;
+		<< "Press space to toggle between frustum culling enabled and disabled." << endl
+		<< "Press m to toggle between the asteroids drifting and standing still." << endl
+		<< "Press g to cycle gravity between drifting asteroids through off, Barnes-Hut and direct." << endl
+		<< "Press c to show or hide the performance counters." << endl
+		<< "Press q to show or hide the squares of the quadtree that culling visits." << endl;
+}
+
+// Routine to set up the field and report what it is and how long it took; return 1 if done, 0 if not.
+int setupFieldTimed(void)
+{
+   chrono::steady_clock::time_point start = chrono::steady_clock::now();
+   if (!setupField()) return 0;
+   double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+   if (config.isStreamed) cout << "Asteroid field: unbounded, streamed in chunks within " << config.budget << " MB, ";
+   else cout << "Asteroid field: " << config.rows << " rows by " << config.columns << " columns, ";
+   cout << config.fillProbability << "% filled, " << config.spacing << " apart, seed " << config.seed << "." << endl;
+   cout << "Set up " << (config.loadFile.empty() ? "" : "from snapshot ") << "in " << elapsed * 1000.0 << " ms." << endl;
+   return 1;
 }
 
 // Main routine.
 int main(int argc, char **argv) 
 {
 
-	srand((unsigned)time(0));
-	printInteraction();
+	int i;
+	if (!parseCommandLine(config, argc, argv))
+		return -1;
+	if (config.isAllocationTracked) startAllocationTracking();
+	if (!config.traceFile.empty())
+	{
+		startTracing();
+		nameTraceThread("Main");
+	}
+	if (!config.replayFile.empty())
+	{
+		if (!config.recordFile.empty() || config.headlessTicks > 0 || config.benchmarkFrames > 0)
+		{
+			cerr << "A replay is of the interactive program, and is not recorded again." << endl;
+			return -1;
+		}
+		if (!inputRecording.load(config.replayFile.c_str(), config)) return -1;
+	}
+	else if (config.isUnthrottled)
+	{
+		cerr << "Only a replay can be unthrottled." << endl;
+		return -1;
+	}
+	Config recorded = config; // Settings of the field of the replay, if any.
+	gravityMode = config.gravityMode;
+	isQuadtreeShown = config.isQuadtreeShown;
+
+	if (config.microbenchmarkInputs > 0)
+	{
+		MicrobenchmarkReport report;
+		runMicrobenchmarks(config.microbenchmarkInputs, config.seed, report);
+		printMicrobenchmarks(report);
+		if (!config.reportFile.empty())
+		{
+			if (!writeMicrobenchmarkReport(report, config.reportFile.c_str())) return -1;
+			cout << "Report written to " << config.reportFile << "." << endl;
+		}
+		if (numberDegenerateMismatches(report) > 0)
+			cout << "The accelerated routines disagree with the originals on " << numberDegenerateMismatches(report) 
+				 << " degenerate inputs." << endl;
+		if (numberMismatches(report) > 0)
+		{
+			cerr << "The accelerated routines differ from the originals on " << numberMismatches(report) << " inputs." << endl;
+			return -1;
+		}
+		return 0;
+	}
 
-	// set up the window
-	GLFWwindow* window;
+	if (!config.regressionDir.empty())
+	{
+		RegressionReport report;
+		if (config.isStreamed || !config.loadFile.empty())
+		{
+			cerr << "The regression suite generates bounded fields of its own." << endl;
+			return -1;
+		}
+		runRegression(numberThreads(), report);
+		readBaselines(config.regressionDir, report);
+		int numFailed = judgeRegression(report);
+		printRegression(report);
+		if (!config.reportFile.empty())
+		{
+			if (!writeRegressionReport(report, config.reportFile.c_str())) return -1;
+			cout << "Report written to " << config.reportFile << "." << endl;
+		}
+		if (config.isRebaselined)
+		{
+			if (!writeBaselines(config.regressionDir, report)) return -1;
+			cout << "Baselines written to " << config.regressionDir << "." << endl;
+			return 0;
+		}
+		if (numFailed > 0)
+		{
+			cerr << numFailed << " metrics regressed, changed or have no baseline." << endl;
+			return -1;
+		}
+		return 0;
+	}
+	else if (config.isRebaselined)
+	{
+		cerr << "Only the regression suite can be rebaselined." << endl;
+		return -1;
+	}
+
+	if (config.benchmarkFrames > 0)
+	{
+		BenchmarkReport report;
+		if (config.isStreamed || !config.loadFile.empty())
+		{
+			cerr << "A benchmark generates a bounded field of its own." << endl;
+			return -1;
+		}
+		runBenchmark(config, numberThreads(), report);
+		printBenchmark(report);
+		if (!config.reportFile.empty())
+		{
+			if (!writeBenchmarkReport(report, config.reportFile.c_str())) return -1;
+			cout << "Report written to " << config.reportFile << "." << endl;
+		}
+		if (numberMissed(report) > 0)
+		{
+			cerr << "The quadtree missed " << numberMissed(report) << " asteroids brute force found." << endl;
+			return -1;
+		}
+		if (numberOverdrawnFrames(report) > 0)
+		{
+			cerr << numberOverdrawnFrames(report) << " frames issued more draw commands than asteroids visible." << endl;
+			return -1;
+		}
+		if (numberAllocatingFrames(report) > 0)
+		{
+			cerr << numberAllocatingFrames(report) << " frames after the warm-up allocated memory." << endl;
+			return -1;
+		}
+		return finishTrace() ? 0 : -1;
+	}
+
+	if (config.headlessTicks > 0)
+	{
+		if (!setupFieldTimed()) return -1;
+		beginAllocationPhase(ALLOCATION_FRAMES);
+		if (streamedField != NULL) runStreamedFlight(config.headlessTicks);
+		else runHeadless(config.headlessTicks);
+		stopThreads();
+		if (config.isAllocationTracked) printAllocations(config.headlessTicks);
+		return finishTrace() ? 0 : -1;
+	}
 
-	// Initialize the library 
-	if (!glfwInit())
+	// set up the window, or in its place a context drawing offscreen
+	GLFWwindow* window = NULL;
+	OffscreenContext offscreen;
+	int isOffscreen = config.offscreenFrames > 0;
+	if (config.backend == RENDER_NULL) renderer = &nullBackend;
+	else if (config.backend == RENDER_RECORD) renderer = &recordingBackend;
+	if (isOffscreen)
+	{
+		// The null and recording backends need no OpenGL, so for them there is no context, and
+		// none of the OpenGL setting up is done.
+		if (config.backend == RENDER_GL)
+		{
+			if (!offscreen.create(WINDOW_X, WINDOW_Y)) return -1;
+			resize(NULL, WINDOW_X, WINDOW_Y);
+		}
+		else
+		{
+			width = WINDOW_X;
+			height = WINDOW_Y;
+		}
+		if (!config.callsFile.empty() && !recordingBackend.open(config.callsFile.c_str())) return -1;
+	}
+	else if (config.backend != RENDER_GL)
+	{
+		cerr << "Only a run offscreen can draw through the null or recording backend." << endl;
 		return -1;
+	}
+	else
+	{
+		printInteraction();
+
+		// Initialize the library 
+		if (!glfwInit())
+			return -1;
+
+		// Create a windowed mode window and its OpenGL context 
+		window = glfwCreateWindow(WINDOW_X, WINDOW_Y, "spaceTravelFrustumCulled.cpp", nullptr, nullptr);
+		resize(window, WINDOW_X, WINDOW_Y);
+		glfwSetWindowSizeCallback(window, resize);
+		glfwSetKeyCallback(window, keyInput);
+		if (!window)
+		{
+			glfwTerminate();
+			return -1;
+		}
+
+		// Make the window's context current 
+		glfwMakeContextCurrent(window);
+
+		// Init GLEW 
+		glewInit();
+	}
 
-	// Create a windowed mode window and its OpenGL context 
-	window = glfwCreateWindow(WINDOW_X, WINDOW_Y, "spaceTravelFrustumCulled.cpp", nullptr, nullptr);
-	resize(window, WINDOW_X, WINDOW_Y);
-	glfwSetWindowSizeCallback(window, resize);
-	glfwSetKeyCallback(window, keyInput);
-	if (!window)
+	// init the graphics and rest of the app
+	if (!setupFieldTimed())
+	{
+		glfwTerminate();
+		return -1;
+	}
+	if (!config.replayFile.empty() && (config.rows != recorded.rows || config.columns != recorded.columns ||
+		config.fillProbability != recorded.fillProbability || config.spacing != recorded.spacing || config.seed != recorded.seed))
 	{
+		cerr << "The snapshot is not of the field the replay was recorded over." << endl;
 		glfwTerminate();
 		return -1;
 	}
+	if (config.backend == RENDER_GL) setupGraphics();
+
+	// run! The simulation advances in fixed ticks for the time since the last frame, and the
+	// frame shows the spacecraft interpolated between the last two ticks. Each frame is culled on
+	// the pipeline's thread while the frame before is drawn, so what is drawn lags a frame behind;
+	// the ticks wait until the culling is done, as they move what it reads. An unthrottled replay
+	// runs a tick a frame, with no interpolation and no waiting for the display, and so does a run
+	// offscreen, which, unless it is a replay, flies the benchmark's scripted flight with culling on.
+	int isReplaying = !config.replayFile.empty();
+	int isUnthrottled = config.isUnthrottled || isOffscreen;
+	int numFrames = 0;
+	long long numDrawsCounted = 0; // Draw calls of the frames by the counters, checked against those recorded.
+	vector<double> frameTimes;
+	vector<ViewState> flight;
+	if (isOffscreen && !isReplaying) scriptedFlight(config.offscreenFrames, flight);
+	if (config.isUnthrottled && !isOffscreen) glfwSwapInterval(0);
+	beginAllocationPhase(ALLOCATION_FRAMES);
+	framePipeline.start(cullFrame);
+	double lastTime = isUnthrottled ? 0.0 : glfwGetTime();
+	chrono::steady_clock::time_point frameStart = chrono::steady_clock::now();
+	while ((isOffscreen ? numFrames < config.offscreenFrames : !glfwWindowShouldClose(window)) && 
+		   !(isReplaying && inputRecording.isFinished(tickCount)))
+	{
+		const FrameCommands &frame = framePipeline.collect();
 
-	// Make the window's context current 
-	glfwMakeContextCurrent(window);
+		double time = isUnthrottled ? 0.0 : glfwGetTime();
+		int ticks = isUnthrottled ? 1 : simulationClock.advance(time - lastTime);
+		lastTime = time;
+		for (i = 0; i < ticks && !(isReplaying && inputRecording.isFinished(tickCount)); i++) simulationTick();
+		if (!flight.empty())
+		{
+			previousCraft = craft;
+			craft.x = flight[numFrames].x; craft.z = flight[numFrames].z; craft.angle = flight[numFrames].angle;
+			isFrustumCulled = 1;
+		}
 
-	// Init GLEW 
-	glewInit();
+		CraftState drawn = interpolateCraft(previousCraft, craft, isUnthrottled ? 1.0 : simulationClock.alpha());
+		ViewState view = { drawn.x, drawn.z, drawn.angle, isFrustumCulled, isQuadtreeShown };
+		framePipeline.request(view);
 
-	// init the graphics and rest of the app
-	setup();
+		drawScene(frame);
+		if (isOffscreen && config.backend == RENDER_GL)
+		{
+			TRACE_SCOPE("glFinish");
+			offscreen.finish();
+		}
+		else
+		{
+			{
+				TRACE_SCOPE("glfwSwapBuffers");
+				glfwSwapBuffers(window);
+			}
 
-	// run!
-	while (!glfwWindowShouldClose(window))
-	{
-		drawScene();
-		glfwSwapBuffers(window);
+			// Poll for and process events 
+			glfwPollEvents();
+		}
 
-		// Poll for and process events 
-		glfwPollEvents();
+		FrameCounters counters;
+		chrono::steady_clock::time_point frameEnd = chrono::steady_clock::now();
+		countFrame(frame, counters);
+		numDrawsCounted += (long long)(counters.drawCalls[FIXED_VIEWPORT] + counters.drawCalls[CRAFT_VIEWPORT]) + 2 +
+			overlay.numberDrawCalls() + (frame.quadtreeLines.vertices.empty() ? 0 : 1); // The spacecraft and the line
+			                                                                             // between the viewports as well.
+		counters.frameTime = chrono::duration<double, milli>(frameEnd - frameStart).count();
+		counterAverages.add(counters);
+		if (isReplaying || isOffscreen) frameTimes.push_back(counters.frameTime);
+		frameStart = frameEnd;
+		numFrames++;
 	}
 
-	glfwTerminate();
+	stopThreads();
+	if (isOffscreen) offscreen.destroy();
+	else glfwTerminate();
+	if (isReplaying) printReplay(frameTimes);
+	else if (isOffscreen) printOffscreen(frameTimes);
+	if (config.isAllocationTracked) printAllocations(numFrames);
+	int isChecked = 1;
+	if (config.backend == RENDER_RECORD)
+	{
+		recordingBackend.printCounts();
+		if (!recordingBackend.close()) isChecked = 0;
+		else if (!config.callsFile.empty()) cout << "Calls written to " << config.callsFile << "." << endl;
+		if (recordingBackend.numberCalls(CALL_DRAW_ARRAYS) != numDrawsCounted)
+		{
+			cerr << "Recorded " << recordingBackend.numberCalls(CALL_DRAW_ARRAYS) << " draw calls, but the counters counted "
+				 << numDrawsCounted << "." << endl;
+			isChecked = 0;
+		}
+	}
 
-	return 0;
+	int isSaved = saveRecording();
+	return finishTrace() && isSaved && isChecked ? 0 : -1;
 
 }
 
@@ -0,0 +1,8 @@
+#version 120
+uniform sampler2D atlas;
+varying vec2 texCoord;
+void
+main()
+{
+	gl_FragColor = vec4(gl_Color.rgb, gl_Color.a * texture2D(atlas, texCoord).a);
+}
\ No newline at end of file
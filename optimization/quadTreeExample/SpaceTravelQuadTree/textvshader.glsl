@@ -0,0 +1,13 @@
+#version 120
+attribute vec2 vPosition;
+attribute vec2 vTexCoord;
+attribute vec4 vColor;
+uniform vec2 screenSize;
+varying vec2 texCoord;
+void main()
+{
+    // Pixels from the top left of the window to clip co-ordinates.
+    gl_Position = vec4(2.0 * vPosition.x / screenSize.x - 1.0, 1.0 - 2.0 * vPosition.y / screenSize.y, 0.0, 1.0);
+    gl_FrontColor = vColor;
+    texCoord = vTexCoord;
+}
\ No newline at end of file
@@ -1,5 +1,5 @@
 #version 120
-in vec4 vPosition;
+attribute vec4 vPosition;
 void main()
 {
     gl_Position    = gl_ModelViewProjectionMatrix * vPosition;